@@ -0,0 +1,95 @@
+#include "api_router.h"
+
+namespace http_handler {
+
+namespace {
+
+// Сегменты и имена параметров короткие: посимвольное сравнение дешевле вызова memcmp
+bool ShortEquals(std::string_view lhs, std::string_view rhs) noexcept {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs[i] != rhs[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+std::optional<ApiRouteMatch> MatchApiRoute(std::string_view target) {
+    using detail::API_ROUTE_TRIE;
+
+    ApiRouteMatch match;
+    int node = 0;
+    size_t pos = 0;
+    // Путь разбирается посимвольно до '?': сегмент ищется среди детей текущего узла
+    while (pos < target.size() && target[pos] != '?') {
+        if (target[pos] == '/') {
+            ++pos;
+            continue;
+        }
+        const size_t begin = pos;
+        while (pos < target.size() && target[pos] != '/' && target[pos] != '?') {
+            ++pos;
+        }
+        const std::string_view segment = target.substr(begin, pos - begin);
+
+        // Точное совпадение сегмента важнее "*"
+        int wildcard = -1;
+        int child = API_ROUTE_TRIE[node].first_child;
+        while (child != -1 && !ShortEquals(API_ROUTE_TRIE[child].segment, segment)) {
+            if (ShortEquals(API_ROUTE_TRIE[child].segment, detail::WILDCARD)) {
+                wildcard = child;
+            }
+            child = API_ROUTE_TRIE[child].next_sibling;
+        }
+        if (child == -1) {
+            if (wildcard == -1) {
+                return std::nullopt;
+            }
+            child = wildcard;
+            match.wildcard = segment;
+        }
+        node = child;
+    }
+    if (API_ROUTE_TRIE[node].route == -1) {
+        return std::nullopt;
+    }
+    match.spec = &API_ROUTES[API_ROUTE_TRIE[node].route];
+
+    // Параметры a=1&b=2 после '?'
+    while (pos < target.size()) {
+        const size_t begin = ++pos;
+        size_t eq = std::string_view::npos;
+        while (pos < target.size() && target[pos] != '&') {
+            if (target[pos] == '=' && eq == std::string_view::npos) {
+                eq = pos;
+            }
+            ++pos;
+        }
+        if (eq == std::string_view::npos) {
+            continue;
+        }
+        const std::string_view name = target.substr(begin, eq - begin);
+        for (size_t i = 0; i < QUERY_PARAMETER_NAMES.size(); ++i) {
+            if (ShortEquals(QUERY_PARAMETER_NAMES[i], name)) {
+                if (match.parameters[i].data() == nullptr) {
+                    match.parameters[i] = target.substr(eq + 1, pos - eq - 1);
+                }
+                break;
+            }
+        }
+    }
+    return match;
+}
+
+bool IsApiTarget(std::string_view target) noexcept {
+    const size_t begin = std::min(target.find_first_not_of('/'), target.size());
+    const size_t end = std::min(target.find_first_of("/?"sv, begin), target.size());
+    return ShortEquals(target.substr(begin, end - begin), ApiTokens::API);
+}
+
+}  // namespace http_handler
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "handler_constants.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <boost/beast/http/verb.hpp>
+
+namespace http_handler {
+
+namespace http = boost::beast::http;
+
+enum class ApiRoute {
+    AllMaps,
+    SingleMap,
+    Join,
+    Players,
+    State,
+    PlayerAction,
+    Batch,
+    Tick,
+    Records,
+    StateStream,
+    Events,
+};
+
+// Параметры строки запроса, которые разбирает маршрутизатор. Порядок совпадает с QUERY_PARAMETER_NAMES
+enum class QueryParameter {
+    Since,
+    Wait,
+    Radius,
+    Bbox,
+    Start,
+    MaxItems,
+    AuthToken,
+};
+
+inline constexpr std::array QUERY_PARAMETER_NAMES{
+    Constants::SINCE,
+    Constants::WAIT,
+    Constants::RADIUS,
+    Constants::BBOX,
+    Constants::START,
+    Constants::MAX_ITEMS,
+    Constants::AUTH_TOKEN,
+};
+
+// Шаблон пути состоит из сегментов через '/', сегмент "*" совпадает с любым сегментом
+struct ApiRouteSpec {
+    std::string_view pattern;
+    ApiRoute route;
+    std::array<http::verb, 2> methods;  // свободные места заполнены http::verb::unknown
+};
+
+inline constexpr auto GET_HEAD_METHODS = std::array{http::verb::get, http::verb::head};
+inline constexpr auto POST_METHODS = std::array{http::verb::post, http::verb::unknown};
+
+inline constexpr std::array API_ROUTES{
+    ApiRouteSpec{"/api/v1/maps"sv,               ApiRoute::AllMaps,      GET_HEAD_METHODS},
+    ApiRouteSpec{"/api/v1/maps/*"sv,             ApiRoute::SingleMap,    GET_HEAD_METHODS},
+    ApiRouteSpec{"/api/v1/game/join"sv,          ApiRoute::Join,         POST_METHODS},
+    ApiRouteSpec{"/api/v1/game/players"sv,       ApiRoute::Players,      GET_HEAD_METHODS},
+    ApiRouteSpec{"/api/v1/game/state"sv,         ApiRoute::State,        GET_HEAD_METHODS},
+    ApiRouteSpec{"/api/v1/game/player/action"sv, ApiRoute::PlayerAction, POST_METHODS},
+    ApiRouteSpec{"/api/v1/game/batch"sv,         ApiRoute::Batch,        POST_METHODS},
+    ApiRouteSpec{"/api/v1/game/tick"sv,          ApiRoute::Tick,         POST_METHODS},
+    ApiRouteSpec{"/api/v1/game/records"sv,       ApiRoute::Records,      GET_HEAD_METHODS},
+    // Открываются только через Upgrade: WebSocket с состоянием сеанса и Server-Sent Events
+    ApiRouteSpec{"/api/v1/game/ws"sv,            ApiRoute::StateStream,  GET_HEAD_METHODS},
+    ApiRouteSpec{"/api/v1/game/events"sv,        ApiRoute::Events,       GET_HEAD_METHODS},
+};
+
+// Результат разбора цели запроса. Строки указывают внутрь разобранной цели
+struct ApiRouteMatch {
+    const ApiRouteSpec* spec = nullptr;
+    std::string_view wildcard;  // сегмент пути на месте "*"
+    // Значения параметров; data() == nullptr у отсутствующих, у пустых значений data() указывает в цель
+    std::array<std::string_view, QUERY_PARAMETER_NAMES.size()> parameters{};
+
+    ApiRoute Route() const noexcept {
+        return spec->route;
+    }
+
+    bool IsMethodAllowed(http::verb method) const noexcept {
+        return method != http::verb::unknown
+            && (spec->methods[0] == method || spec->methods[1] == method);
+    }
+
+    std::optional<std::string_view> Parameter(QueryParameter parameter) const noexcept {
+        const std::string_view value = parameters[static_cast<size_t>(parameter)];
+        if (value.data() == nullptr) {
+            return std::nullopt;
+        }
+        return value;
+    }
+};
+
+namespace detail {
+
+// Узел префиксного дерева по сегментам пути. Дети узла образуют список через next_sibling
+struct RouteTrieNode {
+    std::string_view segment;
+    int first_child = -1;
+    int next_sibling = -1;
+    int route = -1;  // индекс в API_ROUTES
+};
+
+inline constexpr std::string_view WILDCARD = "*"sv;
+
+// Вызывает fn для каждого непустого сегмента пути: повторные и крайние '/' пропускаются.
+// Обход прекращается, если fn вернула false
+template <typename Fn>
+constexpr void ForEachSegment(std::string_view path, Fn&& fn) {
+    while (!path.empty()) {
+        const size_t end = std::min(path.find('/'), path.size());
+        if (end != 0 && !fn(path.substr(0, end))) {
+            return;
+        }
+        path.remove_prefix(std::min(end + 1, path.size()));
+    }
+}
+
+template <size_t RouteCount>
+constexpr size_t RouteTrieCapacity(const std::array<ApiRouteSpec, RouteCount>& routes) {
+    size_t capacity = 1;  // корень
+    for (const auto& spec : routes) {
+        ForEachSegment(spec.pattern, [&capacity](std::string_view) {
+            ++capacity;
+            return true;
+        });
+    }
+    return capacity;
+}
+
+template <size_t Capacity, size_t RouteCount>
+constexpr std::array<RouteTrieNode, Capacity> BuildRouteTrie(const std::array<ApiRouteSpec, RouteCount>& routes) {
+    std::array<RouteTrieNode, Capacity> nodes{};
+    int size = 1;
+    for (size_t route = 0; route < RouteCount; ++route) {
+        int node = 0;
+        ForEachSegment(routes[route].pattern, [&](std::string_view segment) {
+            int child = nodes[node].first_child;
+            int last = -1;
+            while (child != -1 && nodes[child].segment != segment) {
+                last = child;
+                child = nodes[child].next_sibling;
+            }
+            if (child == -1) {
+                child = size++;
+                nodes[child].segment = segment;
+                (last == -1 ? nodes[node].first_child : nodes[last].next_sibling) = child;
+            }
+            node = child;
+            return true;
+        });
+        if (nodes[node].route != -1) {
+            throw "Duplicate API route";  // в constexpr-контексте - ошибка компиляции
+        }
+        nodes[node].route = static_cast<int>(route);
+    }
+    return nodes;
+}
+
+inline constexpr auto API_ROUTE_TRIE = BuildRouteTrie<RouteTrieCapacity(API_ROUTES)>(API_ROUTES);
+
+}  // namespace detail
+
+// Находит маршрут по декодированной цели запроса (путь и, после '?', параметры)
+// за один проход без выделения памяти. nullopt, если такого маршрута нет.
+// Параметр, указанный несколько раз, берётся из первого вхождения
+std::optional<ApiRouteMatch> MatchApiRoute(std::string_view target);
+
+// Первый сегмент пути - "api". Такие запросы обслуживает ApiHandler, остальные - раздача файлов
+bool IsApiTarget(std::string_view target) noexcept;
+
+}  // namespace http_handler
@@ -0,0 +1,83 @@
+#include "binary_format.h"
+
+#include "../util/binary_writer.h"
+
+namespace http_handler {
+
+static void WriteHeader(util::BinaryWriter& writer, uint8_t kind) {
+    writer.U8(BinaryFormat::MAGIC_0).U8(BinaryFormat::MAGIC_1).U8(BinaryFormat::VERSION).U8(kind);
+}
+
+static uint8_t DirectionCode(model::Dog::Direction dir) {
+    switch (dir) {
+        case model::Dog::Direction::NORTH: return 0;
+        case model::Dog::Direction::SOUTH: return 1;
+        case model::Dog::Direction::WEST:  return 2;
+        case model::Dog::Direction::EAST:  return 3;
+        case model::Dog::Direction::STOP:  return 4;
+    }
+    return 4;
+}
+
+std::string EncodeGameState(const service::UseCaseGetGameState::GameState& state) {
+    std::string body;
+    util::BinaryWriter writer{body};
+    WriteHeader(writer, BinaryFormat::KIND_GAME_STATE);
+
+    writer.VarUint(state.players.size());
+    for (const auto& player : state.players) {
+        writer.VarUint(*player.id);
+        writer.Float32(static_cast<float>(player.pos.x)).Float32(static_cast<float>(player.pos.y));
+        writer.Float32(static_cast<float>(player.speed.x)).Float32(static_cast<float>(player.speed.y));
+        writer.U8(DirectionCode(player.dir));
+        writer.VarUint(player.bag.size());
+        for (const auto& loot_item : player.bag) {
+            writer.VarUint(loot_item.id).VarUint(loot_item.type);
+        }
+        writer.VarUint(player.scores);
+    }
+
+    writer.VarUint(state.loot_objects.size());
+    for (const auto& loot_object : state.loot_objects) {
+        writer.VarUint(*loot_object.id).VarUint(loot_object.type);
+        writer.Float32(static_cast<float>(loot_object.pos.x)).Float32(static_cast<float>(loot_object.pos.y));
+    }
+    return body;
+}
+
+std::string EncodeMap(const model::Map& map, const extra_data::ExtraData& extra_data) {
+    std::string body;
+    util::BinaryWriter writer{body};
+    WriteHeader(writer, BinaryFormat::KIND_MAP);
+
+    writer.String(*map.GetId()).String(map.GetName());
+    writer.String(extra_data.map_id_to_loot_types.at(map.GetId()));
+
+    writer.VarUint(map.GetRoads().size());
+    for (const auto& road : map.GetRoads()) {
+        geom::Point start = road.GetStart();
+        geom::Point end = road.GetEnd();
+        writer.VarInt(start.x).VarInt(start.y);
+        if (road.IsHorizontal()) {
+            writer.U8(1).VarInt(end.x);
+        } else {
+            writer.U8(0).VarInt(end.y);
+        }
+    }
+
+    writer.VarUint(map.GetBuildings().size());
+    for (const auto& building : map.GetBuildings()) {
+        const model::Rectangle& rect = building.GetBounds();
+        writer.VarInt(rect.position.x).VarInt(rect.position.y).VarInt(rect.size.width).VarInt(rect.size.height);
+    }
+
+    writer.VarUint(map.GetOffices().size());
+    for (const auto& office : map.GetOffices()) {
+        geom::Point position = office.GetPosition();
+        model::Offset offset = office.GetOffset();
+        writer.String(*office.GetId()).VarInt(position.x).VarInt(position.y).VarInt(offset.dx).VarInt(offset.dy);
+    }
+    return body;
+}
+
+}  // namespace http_handler
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../service/service.h"
+#include "../loader/extra_data.h"
+
+#include <cstdint>
+#include <string>
+
+namespace http_handler {
+
+/*
+ *  Двоичный формат ответов (Accept: application/x-bloodhound-bin), версия 1.
+ *  Все числа little-endian. uint - varint без знака (LEB128), sint - varint после zigzag,
+ *  f32 - IEEE 754 float, str - uint длина и байты UTF-8.
+ *
+ *  Заголовок: u8 'B', u8 'H', u8 версия, u8 вид (1 - состояние игры, 2 - карта).
+ *
+ *  Состояние игры (/api/v1/game/state):
+ *      uint число собак, для каждой:
+ *          uint id, f32 x, f32 y, f32 vx, f32 vy,
+ *          u8 направление (0 - U, 1 - D, 2 - L, 3 - R, 4 - стоит),
+ *          uint число предметов в рюкзаке, для каждого: uint id, uint тип,
+ *          uint очки
+ *      uint число потерянных предметов, для каждого: uint id, uint тип, f32 x, f32 y
+ *
+ *  Карта (/api/v1/maps/{id}):
+ *      str id, str название, str типы трофеев (JSON-массив из конфигурации, как в JSON-ответе),
+ *      uint число дорог, для каждой: sint x0, sint y0, u8 1 - горизонтальная / 0 - вертикальная,
+ *          sint x1 для горизонтальной или y1 для вертикальной
+ *      uint число зданий, для каждого: sint x, sint y, sint w, sint h
+ *      uint число офисов, для каждого: str id, sint x, sint y, sint offsetX, sint offsetY
+ *
+ *  Новые поля добавляются только с повышением версии.
+ */
+struct BinaryFormat {
+    BinaryFormat() = delete;
+    static constexpr uint8_t MAGIC_0 = 'B';
+    static constexpr uint8_t MAGIC_1 = 'H';
+    static constexpr uint8_t VERSION = 1;
+    static constexpr uint8_t KIND_GAME_STATE = 1;
+    static constexpr uint8_t KIND_MAP = 2;
+};
+
+std::string EncodeGameState(const service::UseCaseGetGameState::GameState& state);
+
+std::string EncodeMap(const model::Map& map, const extra_data::ExtraData& extra_data);
+
+}  // namespace http_handler
@@ -0,0 +1,216 @@
+#include "event_stream.h"
+
+#include "handler_constants.h"
+#include "../util/json_writer.h"
+
+namespace http_handler {
+
+using namespace std::literals;
+
+/* EventStreamSession */
+
+EventStreamSession::EventStreamSession(beast::tcp_stream&& stream)
+    : stream_{std::move(stream)} {
+}
+
+void EventStreamSession::Start(unsigned http_version) {
+    // Поток событий бесконечен, таймаут чтения HTTP-сессии к нему не относится
+    stream_.expires_never();
+    header_.version(http_version);
+    header_.result(http::status::ok);
+    header_.set(http::field::content_type, "text/event-stream");
+    header_.set(http::field::cache_control, "no-cache");
+    // Тело без длины заканчивается закрытием соединения
+    header_.keep_alive(false);
+    serializer_.emplace(header_);
+    http::async_write_header(stream_, *serializer_,
+                             beast::bind_front_handler(&EventStreamSession::OnHeaderWritten, shared_from_this()));
+}
+
+void EventStreamSession::Reject(http::response<http::string_body>&& response) {
+    auto safe_response = std::make_shared<http::response<http::string_body>>(std::move(response));
+    safe_response->keep_alive(false);
+    closed_ = true;
+    http::async_write(stream_, *safe_response,
+                      [self = shared_from_this(), safe_response](beast::error_code, std::size_t) {
+                          self->Close();
+                      });
+}
+
+void EventStreamSession::Push(std::shared_ptr<const std::string> events) {
+    net::dispatch(stream_.get_executor(), [self = shared_from_this(), events = std::move(events)]() mutable {
+        if (self->closed_) {
+            return;
+        }
+        if (self->pending_.size() >= MAX_PENDING) {
+            // Пропускать события нельзя, а очередь не должна расти без предела
+            return self->Close();
+        }
+        self->pending_.push_back(std::move(events));
+        if (self->started_ && !self->writing_) {
+            self->WriteNext();
+        }
+    });
+}
+
+void EventStreamSession::OnHeaderWritten(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    if (ec) {
+        return Close();
+    }
+    started_ = true;
+    Read();
+    if (!pending_.empty()) {
+        WriteNext();
+    }
+}
+
+void EventStreamSession::Read() {
+    stream_.async_read_some(net::buffer(&read_byte_, 1),
+                            beast::bind_front_handler(&EventStreamSession::OnRead, shared_from_this()));
+}
+
+void EventStreamSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    if (ec) {
+        return Close();
+    }
+    Read();
+}
+
+void EventStreamSession::WriteNext() {
+    writing_ = true;
+    net::async_write(stream_, net::buffer(*pending_.front()),
+                     beast::bind_front_handler(&EventStreamSession::OnWrite, shared_from_this()));
+}
+
+void EventStreamSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    writing_ = false;
+    // Close оставляет отправляемую строку в очереди, освобождается она только здесь
+    pending_.pop_front();
+    if (ec) {
+        return Close();
+    }
+    if (!closed_ && !pending_.empty()) {
+        WriteNext();
+    }
+}
+
+void EventStreamSession::Close() {
+    closed_ = true;
+    // Буфер незавершённой записи должен дожить до OnWrite
+    pending_.erase(writing_ ? std::next(pending_.begin()) : pending_.begin(), pending_.end());
+    beast::error_code ec;
+    stream_.socket().shutdown(net::ip::tcp::socket::shutdown_both, ec);
+    stream_.socket().close(ec);
+}
+
+/* EventBroadcaster */
+
+EventBroadcaster::EventBroadcaster(service::Service& service) {
+    events_connection_ = service.DoOnTickEvents([this](std::chrono::milliseconds time_delta,
+                                                       const service::Service::TickEvents& events) {
+        OnTickEvents(time_delta, events);
+    });
+}
+
+void EventBroadcaster::Subscribe(const std::shared_ptr<EventStreamSession>& subscriber) {
+    std::lock_guard lock{mutex_};
+    subscribers_.push_back(subscriber);
+}
+
+void EventBroadcaster::OnTickEvents(std::chrono::milliseconds time_delta, const service::Service::TickEvents& events) {
+    std::vector<std::shared_ptr<EventStreamSession>> live;
+    {
+        std::lock_guard lock{mutex_};
+        std::erase_if(subscribers_, [&live](const std::weak_ptr<EventStreamSession>& weak_subscriber) {
+            auto subscriber = weak_subscriber.lock();
+            if (subscriber) {
+                live.push_back(std::move(subscriber));
+            }
+            return !subscriber;
+        });
+    }
+    if (live.empty()) {
+        return;
+    }
+    auto encoded = std::make_shared<const std::string>(EncodeTickEvents(time_delta, events));
+    for (const auto& subscriber : live) {
+        subscriber->Push(encoded);
+    }
+}
+
+/* Кодирование событий */
+
+struct EventNames {
+    EventNames() = delete;
+    static constexpr std::string_view JOIN            = "join"sv;
+    static constexpr std::string_view LOOT_COLLECTED  = "lootCollected"sv;
+    static constexpr std::string_view LOOT_DROPPED    = "lootDropped"sv;
+    static constexpr std::string_view RETIRE          = "retire"sv;
+    static constexpr std::string_view TICK            = "tick"sv;
+};
+
+// Одно событие: "event: <name>\ndata: <JSON>\n\n". Данные пишутся writer'ом прямо в out
+template <typename Fn>
+static void AppendEvent(std::string& out, std::string_view name, Fn&& write_data) {
+    out.append("event: "sv).append(name).append("\ndata: "sv);
+    util::JsonWriter writer{out};
+    writer.StartObject();
+    write_data(writer);
+    writer.EndObject();
+    out.append("\n\n"sv);
+}
+
+static void AppendSessionEvent(std::string& out, const service::Service::SessionTickEvents& session,
+                               const model::SessionEvent& event) {
+    auto write_common = [&session, &event](util::JsonWriter& writer) {
+        writer.Key(Constants::SESSION).Value(*session.session);
+        writer.Key(Constants::MAP_ID).Value(*session.map);
+        writer.Key(Constants::DOG).Value(*event.dog);
+    };
+    switch (event.type) {
+        case model::SessionEvent::Type::JOIN:
+            return AppendEvent(out, EventNames::JOIN, [&](util::JsonWriter& writer) {
+                write_common(writer);
+                writer.Key(Constants::NAME).Value(event.name);
+            });
+        case model::SessionEvent::Type::LOOT_COLLECTED:
+            return AppendEvent(out, EventNames::LOOT_COLLECTED, [&](util::JsonWriter& writer) {
+                write_common(writer);
+                writer.Key(Constants::LOOT_ID).Value(*event.loot);
+                writer.Key(Constants::TYPE).Value(event.loot_type);
+            });
+        case model::SessionEvent::Type::LOOT_DROPPED:
+            return AppendEvent(out, EventNames::LOOT_DROPPED, [&](util::JsonWriter& writer) {
+                write_common(writer);
+                writer.Key(Constants::ITEMS).Value(event.items);
+                writer.Key(Constants::SCORE_CHANGE).Value(event.score_change);
+            });
+        case model::SessionEvent::Type::RETIRE:
+            return AppendEvent(out, EventNames::RETIRE, write_common);
+    }
+}
+
+std::string EncodeTickEvents(std::chrono::milliseconds time_delta, const service::Service::TickEvents& events) {
+    std::string out;
+    for (const auto& session : events) {
+        for (const auto& event : session.events) {
+            AppendSessionEvent(out, session, event);
+        }
+    }
+    AppendEvent(out, EventNames::TICK, [&](util::JsonWriter& writer) {
+        writer.Key(Constants::TIME_DELTA).Value(time_delta.count());
+        writer.Key(Constants::SESSIONS).StartArray();
+        for (const auto& session : events) {
+            writer.StartObject();
+            writer.Key(Constants::SESSION).Value(*session.session);
+            writer.Key(Constants::MAP_ID).Value(*session.map);
+            writer.Key(Constants::DOGS).Value(session.dogs);
+            writer.Key(Constants::LOST_OBJECTS).Value(session.loot_objects);
+            writer.EndObject();
+        }
+        writer.EndArray();
+    });
+    return out;
+}
+
+}  // namespace http_handler
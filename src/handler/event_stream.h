@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../service/service.h"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace http_handler {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+
+/*
+ *  Поток событий игры в формате Server-Sent Events (text/event-stream).
+ *  Ответ не имеет длины: события пишутся в тело, пока клиент не закроет соединение.
+ *  Клиент, у которого накопилось больше MAX_PENDING неотправленных тиков, отключается.
+ */
+class EventStreamSession : public std::enable_shared_from_this<EventStreamSession> {
+public:
+    static constexpr size_t MAX_PENDING = 64;
+
+    explicit EventStreamSession(beast::tcp_stream&& stream);
+
+    // Отправляет заголовок ответа, после него - события
+    void Start(unsigned http_version);
+
+    // Отвечает на запрос обычным HTTP-ответом и закрывает соединение
+    void Reject(http::response<http::string_body>&& response);
+
+    // События одного тика, уже закодированные. Можно вызывать из любого потока
+    void Push(std::shared_ptr<const std::string> events);
+
+private:
+    void OnHeaderWritten(beast::error_code ec, std::size_t bytes_written);
+    void Read();
+    void OnRead(beast::error_code ec, std::size_t bytes_read);
+    void WriteNext();
+    void OnWrite(beast::error_code ec, std::size_t bytes_written);
+    void Close();
+
+    beast::tcp_stream stream_;
+    http::response<http::empty_body> header_;
+    std::optional<http::response_serializer<http::empty_body>> serializer_;
+    // Клиент ничего не присылает, чтение только замечает закрытие соединения
+    char read_byte_ = 0;
+
+    bool started_ = false;
+    bool closed_ = false;
+    bool writing_ = false;
+    // Пока writing_, первая строка отправляется и не удаляется из очереди
+    std::deque<std::shared_ptr<const std::string>> pending_;
+};
+
+/*
+ *  Рассылает события сеансов после каждого тика всем подписчикам /api/v1/game/events.
+ *  События тика кодируются один раз, и одна строка отдаётся всем подписчикам.
+ */
+class EventBroadcaster {
+public:
+    explicit EventBroadcaster(service::Service& service);
+
+    EventBroadcaster(const EventBroadcaster&) = delete;
+    EventBroadcaster& operator=(const EventBroadcaster&) = delete;
+
+    void Subscribe(const std::shared_ptr<EventStreamSession>& subscriber);
+
+private:
+    void OnTickEvents(std::chrono::milliseconds time_delta, const service::Service::TickEvents& events);
+
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<EventStreamSession>> subscribers_;
+
+    boost::signals2::scoped_connection events_connection_;
+};
+
+// События тика в формате text/event-stream: по событию на каждое событие сеансов и итоговое событие tick
+std::string EncodeTickEvents(std::chrono::milliseconds time_delta, const service::Service::TickEvents& events);
+
+}  // namespace http_handler
@@ -1,318 +1,496 @@
 #include "handler_api.h"
 
 #include "../loader/json_loader.h"
+#include "binary_format.h"
+#include "state_json.h"
+
+#include <atomic>
+#include <charconv>
+#include <cmath>
 
 namespace http_handler{
 
 using ErrorCode = http_request::ErrorBuilder::ErrorCode;
 
-const fs::path ApiTokens::api_root = fs::path{"/"} / ApiTokens::API;
-
 ApiHandler::ApiHandler(service::Service& service, const extra_data::ExtraData& extra_data) 
                                         : service_{service}
                                         , extra_data_{extra_data} {}
 
-StringResponse ApiHandler::ResponseApiError(ErrorCode ec) const {
-    return ErrorBuilder::MakeErrorResponse(ec, req_data_);
+StringResponse ApiHandler::ResponseApiError(const ApiRequest& req, ErrorCode ec) const {
+    return ErrorBuilder::MakeErrorResponse(ec, req.data);
 }
 
-StringResponse ApiHandler::HandleMapsRequest(std::string_view version) const {
-    if (version != ApiTokens::V1){
-        return ErrorBuilder::MakeErrorResponse(ErrorCode::BadRequest, req_data_);
+void ApiHandler::HandleRequest(const ApiRequest& req, ApiResponder respond) const {
+    HandleRoute(req, std::move(respond));
+    if (IsMutatingRequest(req)) {
+        // Если тики приходят через API, команды запроса выполняются здесь же, в api_strand,
+        // и все присоединения пакета попадают в один снимок
+        service_.FlushCommands();
     }
-
-    auto action = [this, version]() {
-        return req_tokens_.empty()
-            ? HandleAllMapsRequest(version)
-            : HandleSingleMapRequest(version);
-    };
-    return ExecuteAllowedMethods(std::move(action), http::verb::get, http::verb::head);
 }
 
-StringResponse ApiHandler::HandleAllMapsRequest(std::string_view version) const {
-    const auto& maps = service_.GetMaps();
-    json::array json_maps;
+void ApiHandler::HandleRoute(const ApiRequest& req, ApiResponder respond) const {
+    if (!req.data.decoded_uri.has_value()) {
+        return respond(ResponseApiError(req, ErrorCode::InvalidURI));
+    }
+    if (!req.route) {
+        return respond(ResponseApiError(req, ErrorCode::BadRequest));
+    }
+    if (!req.route->IsMethodAllowed(req.data.method)) {
+        return respond(MakeInvalidMethodResponse(req, *req.route->spec));
+    }
+
+    switch (req.route->Route()) {
+    case ApiRoute::AllMaps:
+        return respond(HandleAllMapsRequest(req));
+    case ApiRoute::SingleMap:
+        return respond(VaryByAccept(HandleSingleMapRequest(req)));
+    case ApiRoute::Join:
+        return HandlePlayerJoin(req, std::move(respond));
+    case ApiRoute::Players:
+        return respond(HandlePlayersRequest(req));
+    case ApiRoute::State:
+        return respond(VaryByAccept(HandleStateRequest(req)));
+    case ApiRoute::PlayerAction:
+        return respond(HandlePlayerActionRequest(req));
+    case ApiRoute::Batch:
+        return HandleBatchRequest(req, std::move(respond));
+    case ApiRoute::Tick:
+        return respond(HandleTickRequest(req));
+    case ApiRoute::Records:
+        return respond(HandleRecordsRequest(req));
+    case ApiRoute::StateStream:
+    case ApiRoute::Events:
+        // Без Upgrade эти пути не обслуживаются
+        break;
+    }
+    respond(ResponseApiError(req, ErrorCode::BadRequest));
+}
 
-    std::transform(make_move_iterator(maps.begin()), make_move_iterator(maps.end()), std::inserter(json_maps, json_maps.end()), 
-                 [&](auto& map) {
-                   return json_loader::MapAsJsonObject(map,extra_data_, true);
-                 });
+ApiResponse ApiHandler::VaryByAccept(ApiResponse&& response) {
+    // Ответ выбирается по Accept между JSON и двоичным форматом, кэши должны это учитывать
+    std::visit([](auto& result) {
+        result.set(http::field::vary, "Accept"sv);
+    }, response);
+    return std::move(response);
+}
 
-    auto body = json::serialize(json_maps);
-    return MakeStringResponse(http::status::ok, body, req_data_, ContentType::APPLICATION_JSON);
+StringResponse ApiHandler::MakeInvalidMethodResponse(const ApiRequest& req, const ApiRouteSpec& spec) const {
+    std::string methods;
+    for (http::verb method : spec.methods) {
+        if (method == http::verb::unknown) {
+            continue;
+        }
+        if (!methods.empty()) {
+            methods += ", "sv;
+        }
+        methods += Methods::method_to_str.at(method);
+    }
+    auto response = ErrorBuilder::MakeErrorResponse(ErrorCode::InvalidMethod, req.data, methods);
+    response.set(http::field::allow, methods);
+    return response;
 }
 
-StringResponse ApiHandler::HandleSingleMapRequest(std::string_view version) const {
-    std::string_view map_id = req_tokens_.front(); req_tokens_.pop();
-    if (!req_tokens_.empty()) {
-        return ResponseApiError(ErrorCode::BadRequest);
+StringResponse ApiHandler::HandleAllMapsRequest(const ApiRequest& req) const {
+    std::string body;
+    util::JsonWriter writer{body};
+    writer.StartArray();
+    for (const auto& map : service_.GetMaps()) {
+        json_loader::WriteMap(writer, map, extra_data_, true);
     }
-    model::Map::Id id{std::string{map_id}};
+    writer.EndArray();
+    return MakeStringResponse(http::status::ok, std::move(body), req.data, ContentType::APPLICATION_JSON);
+}
+
+StringResponse ApiHandler::HandleSingleMapRequest(const ApiRequest& req) const {
+    model::Map::Id id{std::string{req.route->wildcard}};
     const model::Map* map = service_.FindMap(id);
     if (!map) {
-        return ResponseApiError(ErrorCode::MapNotFound);
+        return ResponseApiError(req, ErrorCode::MapNotFound);
+    }
+    if (req.data.accept_binary) {
+        return MakeStringResponse(http::status::ok, EncodeMap(*map, extra_data_), req.data, ContentType::APPLICATION_BLOODHOUND_BIN);
     }
-    auto body = json::serialize(json_loader::MapAsJsonObject(*map, extra_data_));
-    return MakeStringResponse(http::status::ok, body, req_data_, ContentType::APPLICATION_JSON);
+    std::string body;
+    util::JsonWriter writer{body};
+    json_loader::WriteMap(writer, *map, extra_data_);
+    return MakeStringResponse(http::status::ok, std::move(body), req.data, ContentType::APPLICATION_JSON);
 }
 
 
-StringResponse ApiHandler::HandleGameRequest(std::string_view version) const {
-    if (version != ApiTokens::V1){
-        return ResponseApiError(ErrorCode::BadRequest);
-    }
-    if (req_tokens_.empty()) {
-        return ResponseApiError(ErrorCode::BadRequest);
+void ApiHandler::HandlePlayerJoin(const ApiRequest& req, ApiResponder respond) const {
+    if (req.data.content_type != ContentType::APPLICATION_JSON) {
+        return respond(ResponseApiError(req, ErrorCode::BadRequest));
     }
-    auto api_token = req_tokens_.front(); req_tokens_.pop();
-    if (api_token == ApiTokens::JOIN && req_tokens_.empty()) {
-        return HandlePlayerJoin(version);
+    std::error_code ec;
+    json::value content = json::parse(req.data.body.value(), ec);
+    if (ec) {
+        return respond(ResponseApiError(req, ErrorCode::JoinGameParse));
     }
-    if (api_token == ApiTokens::PLAYERS && req_tokens_.empty()) {
-        return HandlePlayersRequest(version);
+    if (!content.is_object() ||
+        !content.as_object().contains(Constants::USER_NAME) ||
+        !content.as_object().contains(Constants::MAP_ID) ||
+        !content.as_object().at(Constants::USER_NAME).is_string() ||
+        !content.as_object().at(Constants::MAP_ID).is_string() ||
+        content.as_object().at(Constants::USER_NAME).as_string().empty()) {
+        return respond(ResponseApiError(req, ErrorCode::JoinGameParse));
     }
-    if (api_token == ApiTokens::STATE && req_tokens_.empty()) {
-        return HandleStateRequest(version);
-    }
-    if (api_token == ApiTokens::PLAYER) {
-        api_token = req_tokens_.front(); req_tokens_.pop();
-        if (api_token == ApiTokens::ACTION && req_tokens_.empty()) {
-            return HandlePlayerActionRequest(version);
-        }
-    }
-    if (api_token == ApiTokens::TICK && req_tokens_.empty()) {
-        return HandleTickRequest(version);
-    }
-    if (api_token.starts_with(ApiTokens::RECORDS)) {
-        return HandleRecordsRequest(api_token, version);
-    }    
-    return ResponseApiError(ErrorCode::BadRequest);
-}
-
-StringResponse ApiHandler::HandlePlayerJoin(std::string_view version) const {
-    auto action = [this]() {
-        if (req_data_.content_type != ContentType::APPLICATION_JSON) {
-            return ResponseApiError(ErrorCode::BadRequest);
+    std::string dog_name = content.as_object().at(Constants::USER_NAME).as_string().c_str();
+    std::string map_id = content.as_object().at(Constants::MAP_ID).as_string().c_str();
+    // Ответ отправляется после тика, в котором игрок добавлен; api_strand его не ждёт
+    auto on_joined = [this, &req, respond = std::move(respond)](service::UseCaseJoinPlayer::Result result,
+                                                                 std::exception_ptr error) {
+        if (error) {
+            return respond(ResponseApiError(req, ErrorCode::ServerError));
         }
-        std::error_code ec;
-        json::value content = json::parse(req_data_.body.value(), ec);
-        if (ec) {
-            return ResponseApiError(ErrorCode::JoinGameParse);
-        }
-        if (!content.is_object() ||
-            !content.as_object().contains(Constants::USER_NAME) ||
-            !content.as_object().contains(Constants::MAP_ID) ||
-            !content.as_object().at(Constants::USER_NAME).is_string() ||
-            !content.as_object().at(Constants::MAP_ID).is_string() ||
-            content.as_object().at(Constants::USER_NAME).as_string().empty()) {
-            return ResponseApiError(ErrorCode::JoinGameParse);
-        }
-        std::string dog_name = content.as_object().at(Constants::USER_NAME).as_string().c_str();
-        std::string map_id = content.as_object().at(Constants::MAP_ID).as_string().c_str();
-        auto result = service_.JoinPlayer(model::Map::Id{map_id}, dog_name);
         if (!result.has_value()) {
-            return ResponseApiError(ErrorCode::MapNotFound);
+            return respond(ResponseApiError(req, ErrorCode::MapNotFound));
         }
         json::object player;
-        player.emplace(Constants::AUTH_TOKEN, *result->first);
+        player.emplace(Constants::AUTH_TOKEN, result->first.ToString());
         player.emplace(Constants::PLAYER_ID, *result->second);
         auto body = json::serialize(player);
-        return MakeStringResponse(http::status::ok, body, req_data_, ContentType::APPLICATION_JSON);
+        respond(MakeStringResponse(http::status::ok, body, req.data, ContentType::APPLICATION_JSON));
     };
+    service_.JoinPlayer(model::Map::Id{map_id}, std::move(dog_name), std::move(on_joined));
+}
 
-    return ExecuteAllowedMethods(std::move(action), http::verb::post);
+StringResponse ApiHandler::HandlePlayersRequest(const ApiRequest& req) const {
+    return ExecuteAuthorized(req, [this, &req](const service::Token& token) {
+        auto players = service_.GetPlayers(token);
+        if (!players) {
+            return ResponseApiError(req, ErrorCode::PlayerTokenNotFound);
+        }
 
+        std::string body;
+        util::JsonWriter writer{body};
+        writer.StartObject();
+        for (const auto& [id, name] : *players) {
+            writer.Key(*id).StartObject();
+            writer.Key(Constants::NAME).Value(name);
+            writer.EndObject();
+        }
+        writer.EndObject();
+        return MakeStringResponse(http::status::ok, std::move(body), req.data, ContentType::APPLICATION_JSON);
+    });
 }
 
-StringResponse ApiHandler::HandlePlayersRequest(std::string_view version) const {
-    auto action = [this]() {
-        return ExecuteAuthorized([this](const service::Token& token) {
-            auto players = service_.GetPlayers(token);
-            if (!players.has_value()) {
-                return ResponseApiError(ErrorCode::PlayerTokenNotFound);
-            }
+// Конечное число во всю строку
+static std::optional<double> ParseCoordinate(std::string_view value) {
+    double result = 0.;
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc{} || end != value.data() + value.size() || !std::isfinite(result)) {
+        return std::nullopt;
+    }
+    return result;
+}
 
-            json::object json_players;
-            for (const auto [id, name] : players.value()) {
-                json::object player;
-                player.emplace(Constants::NAME, name);
-                json_players.emplace(std::to_string(*id), player);
-            }
-            auto body = json::serialize(json_players);
-            return MakeStringResponse(http::status::ok, body, req_data_, ContentType::APPLICATION_JSON);
-        });
-    };
-    return ExecuteAllowedMethods(std::move(action), http::verb::get, http::verb::head);
+// Целое число во всю строку
+template <typename T>
+static std::optional<T> ParseInteger(std::string_view value) {
+    T result{};
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc{} || end != value.data() + value.size()) {
+        return std::nullopt;
+    }
+    return result;
 }
 
-StringResponse ApiHandler::HandleStateRequest(std::string_view version) const{
-    auto action = [this]() {
-        return ExecuteAuthorized([this](const service::Token& token) {
-            auto state = service_.GetGameState(token);
-            if (!state.has_value()) {
-                return ResponseApiError(ErrorCode::PlayerTokenNotFound);
+// radius=<r> или bbox=<x0>,<y0>,<x1>,<y1>. Возвращает false, если параметр задан неверно
+static bool ParseArea(const ApiRouteMatch& route, std::optional<service::UseCaseGetGameState::Area>& area) {
+    using GameState = service::UseCaseGetGameState;
+    if (const auto& value = route.Parameter(QueryParameter::Radius)) {
+        auto radius = ParseCoordinate(*value);
+        if (!radius || *radius < 0.) {
+            return false;
+        }
+        area = GameState::Radius{*radius};
+        return true;
+    }
+    if (const auto& value = route.Parameter(QueryParameter::Bbox)) {
+        double coords[4];
+        std::string_view rest = *value;
+        for (size_t i = 0; i < 4; ++i) {
+            auto comma = rest.find(',');
+            // Ровно четыре числа через запятую
+            if ((comma == std::string_view::npos) != (i == 3)) {
+                return false;
+            }
+            auto coord = ParseCoordinate(rest.substr(0, comma));
+            if (!coord) {
+                return false;
             }
+            coords[i] = *coord;
+            rest.remove_prefix(i == 3 ? rest.size() : comma + 1);
+        }
+        area = GameState::Box{{std::min(coords[0], coords[2]), std::min(coords[1], coords[3])},
+                              {std::max(coords[0], coords[2]), std::max(coords[1], coords[3])}};
+    }
+    return true;
+}
 
-            static const std::unordered_map<model::Dog::Direction, std::string_view> direction_map{
-                {model::Dog::Direction::NORTH, "U"sv},
-                {model::Dog::Direction::SOUTH, "D"sv},
-                {model::Dog::Direction::WEST,  "L"sv},
-                {model::Dog::Direction::EAST,  "R"sv}
-            };            
-
-            json::object json_players_state;
-            for (const auto& player : state->players) {
-                json::object json_player;
-                json_player.emplace(Constants::POSITION, json::array{player.pos.x, player.pos.y});
-                json_player.emplace(Constants::SPEED, json::array{player.speed.x, player.speed.y});
-                json_player.emplace(Constants::DIRECTION, direction_map.at(player.dir));
-                json::array json_bag;
-                for (auto loot_item : player.bag) {
-                    json::object json_loot_item;
-                    json_loot_item.emplace(Constants::ID, loot_item.id);
-                    json_loot_item.emplace(Constants::TYPE, loot_item.type);
-                    json_bag.emplace_back(std::move(json_loot_item));
-                }
-                json_player.emplace(Constants::BAG, std::move(json_bag));
-                json_player.emplace(Constants::SCORE, std::move(player.scores));
-                json_players_state.emplace(std::to_string(*player.id), std::move(json_player));
+ApiResponse ApiHandler::HandleStateRequest(const ApiRequest& req) const {
+    std::optional<service::UseCaseGetGameState::Area> area;
+    if (!ParseArea(*req.route, area)) {
+        return ResponseApiError(req, ErrorCode::BadRequest);
+    }
+
+    std::optional<uint64_t> since;
+    if (const auto& value = req.route->Parameter(QueryParameter::Since)) {
+        since = ParseInteger<uint64_t>(*value);
+        if (!since) {
+            return ResponseApiError(req, ErrorCode::BadRequest);
+        }
+    }
+    // Изменения хранятся для всего сеанса, с областью интереса они не сочетаются
+    if (since && area) {
+        return ResponseApiError(req, ErrorCode::BadRequest);
+    }
+
+    return ExecuteAuthorized(req, [this, &req, since, &area](const service::Token& token) -> ApiResponse {
+        if (area) {
+            auto state = service_.GetGameState(token, *area);
+            if (!state) {
+                return ResponseApiError(req, ErrorCode::PlayerTokenNotFound);
+            }
+            if (req.data.accept_binary) {
+                return MakeStringResponse(http::status::ok, EncodeGameState(*state), req.data,
+                                          ContentType::APPLICATION_BLOODHOUND_BIN);
             }
+            return MakeStringResponse(http::status::ok, SerializeGameState(*state), req.data, ContentType::APPLICATION_JSON);
+        }
+
+        auto state = service_.GetGameState(token);
+        if (!state) {
+            return ResponseApiError(req, ErrorCode::PlayerTokenNotFound);
+        }
+
+        if (req.data.accept_binary) {
+            // Изменений в двоичном формате нет: since игнорируется, отдаётся полное состояние
+            auto [body, hit] = state->serialized_binary.Get([&state] {
+                return EncodeGameState(*state);
+            });
+            ++(hit ? state_cache_stats_.hits : state_cache_stats_.misses);
+            return MakeSharedResponse(http::status::ok, std::move(body), req.data, ContentType::APPLICATION_BLOODHOUND_BIN);
+        }
+
+        auto get_full_state = [this, &state] {
+            auto [body, hit] = state->serialized.Get([&state] {
+                return SerializeGameState(*state);
+            });
+            ++(hit ? state_cache_stats_.hits : state_cache_stats_.misses);
+            return std::move(body);
+        };
+        if (!since) {
+            return MakeSharedResponse(http::status::ok, get_full_state(), req.data, ContentType::APPLICATION_JSON);
+        }
+
+        if (auto delta = state->ChangesSince(*since)) {
+            return MakeStringResponse(http::status::ok, SerializeStateDelta(*delta), req.data, ContentType::APPLICATION_JSON);
+        }
 
-            json::object json_loot_objects_state;
-            for (const auto& loot_object : state->loot_objects) {
-                json::object json_loot_object;
-                json_loot_object.emplace(Constants::TYPE, loot_object.type);
-                json_loot_object.emplace(Constants::POSITION, json::array{loot_object.pos.x, loot_object.pos.y});
-                json_loot_objects_state.emplace(std::to_string(*loot_object.id), json_loot_object);
-            }            
-
-            json::object json_game_state;
-            json_game_state.emplace(Constants::PLAYERS, std::move(json_players_state));
-            json_game_state.emplace(Constants::LOST_OBJECTS, std::move(json_loot_objects_state));
-
-            auto body = json::serialize(json_game_state);
-            return MakeStringResponse(http::status::ok, body, req_data_, ContentType::APPLICATION_JSON);
-        });
+        // Клиент отстал дальше хранимой истории: полное состояние из кэша с номером тика
+        return MakeStringResponse(http::status::ok, SerializeGameStateWithTick(state->tick, *get_full_state()),
+                                  req.data, ContentType::APPLICATION_JSON);
+    });
+}
+
+static std::optional<model::Dog::Direction> ParseDirection(std::string_view move) {
+    static const std::unordered_map<std::string_view, model::Dog::Direction> direction_map{
+        {"U"sv, model::Dog::Direction::NORTH},
+        {"D"sv, model::Dog::Direction::SOUTH},
+        {"L"sv, model::Dog::Direction::WEST},
+        {"R"sv, model::Dog::Direction::EAST},
+        {""sv,  model::Dog::Direction::STOP},
     };
-    return ExecuteAllowedMethods(std::move(action), http::verb::get, http::verb::head);
+    if (auto it = direction_map.find(move); it != direction_map.end()) {
+        return it->second;
+    }
+    return std::nullopt;
 }
 
-StringResponse ApiHandler::HandlePlayerActionRequest(std::string_view version) const{
-    const auto action = [this](const service::Token& token){
-        if (req_data_.content_type != ContentType::APPLICATION_JSON) {
-            return ResponseApiError(ErrorCode::BadContentType);
+StringResponse ApiHandler::HandlePlayerActionRequest(const ApiRequest& req) const {
+    const auto action = [this, &req](const service::Token& token){
+        if (req.data.content_type != ContentType::APPLICATION_JSON) {
+            return ResponseApiError(req, ErrorCode::BadContentType);
         }
 
         std::error_code ec;
-        json::value content = json::parse(req_data_.body.value(), ec);
+        json::value content = json::parse(req.data.body.value(), ec);
         if (ec) {
-            return ResponseApiError(ErrorCode::ActionParse);
+            return ResponseApiError(req, ErrorCode::ActionParse);
         }
 
         if (!content.is_object() ||
             !content.as_object().contains(Constants::MOVE)) {
-            return ResponseApiError(ErrorCode::ActionParse);
+            return ResponseApiError(req, ErrorCode::ActionParse);
         }
-        static const std::unordered_map<std::string_view, model::Dog::Direction> direction_map{
-            {"U"sv, model::Dog::Direction::NORTH},
-            {"D"sv, model::Dog::Direction::SOUTH},
-            {"L"sv, model::Dog::Direction::WEST},
-            {"R"sv, model::Dog::Direction::EAST},
-            {""sv,  model::Dog::Direction::STOP},
-        };
         std::string dir = content.as_object().at(Constants::MOVE).as_string().c_str();
-        if (!direction_map.contains(dir)) {
-            return ResponseApiError(ErrorCode::JoinGameParse);
+        auto direction = ParseDirection(dir);
+        if (!direction) {
+            return ResponseApiError(req, ErrorCode::JoinGameParse);
         }
-        if (!service_.GameAction(token, direction_map.at(dir))) {
-            return ResponseApiError(ErrorCode::PlayerTokenNotFound);
+        if (!service_.GameAction(token, *direction)) {
+            return ResponseApiError(req, ErrorCode::PlayerTokenNotFound);
         }
-        return MakeStringResponse(http::status::ok, {}, req_data_, ContentType::APPLICATION_JSON);
+        return MakeStringResponse(http::status::ok, std::string{}, req.data, ContentType::APPLICATION_JSON);
     };
 
-    return ExecuteAllowedMethods([this, &action](){
-        return ExecuteAuthorized([&action](const service::Token& token) {
-            return action(token);
-        });
-    }, http::verb::post);
+    return ExecuteAuthorized(req, action);
 }
 
-StringResponse ApiHandler::HandleTickRequest(std::string_view version) const{
-    auto action = [this]() {
-        if (req_data_.content_type != ContentType::APPLICATION_JSON) {
-            return ResponseApiError(ErrorCode::BadRequest);
+void ApiHandler::HandleBatchRequest(const ApiRequest& req, ApiResponder respond) const {
+    if (req.data.content_type != ContentType::APPLICATION_JSON) {
+        return respond(ResponseApiError(req, ErrorCode::BadContentType));
+    }
+    std::error_code ec;
+    json::value content = json::parse(req.data.body.value(), ec);
+    if (ec || !content.is_array()) {
+        return respond(ResponseApiError(req, ErrorCode::BadRequest));
+    }
+    const json::array& operations = content.as_array();
+
+    // Действия сразу ставятся в очередь команд, присоединения завершаются в потоке
+    // симуляции после тика. Ответ на весь пакет отправляет тот, кто завершил последнюю операцию
+    struct Batch {
+        explicit Batch(size_t size)
+            : results(size, ErrorCode::Ok)
+            , joined(size) {
         }
-        std::error_code ec;
-        json::value content = json::parse(req_data_.body.value(), ec);
-        if (ec) {
-            return ResponseApiError(ErrorCode::TickParse);
+        std::vector<ErrorCode> results;
+        std::vector<service::UseCaseJoinPlayer::Result> joined;
+        // Незавершённые присоединения и ещё одна единица, пока пакет не разобран
+        std::atomic_size_t pending{1};
+    };
+    auto batch = std::make_shared<Batch>(operations.size());
+    auto complete = [this, &req, batch, respond = std::move(respond)] {
+        if (batch->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            respond(MakeBatchResponse(req, batch->results, batch->joined));
         }
-        if (!content.is_object() ||
-            !content.as_object().contains(Constants::TIME_DELTA) ||
-            !content.as_object().at(Constants::TIME_DELTA).is_int64()) {
-            return ResponseApiError(ErrorCode::TickParse);
+    };
+    for (size_t i = 0; i < operations.size(); ++i) {
+        const json::object* operation = operations[i].if_object();
+        if (!operation) {
+            batch->results[i] = ErrorCode::BadRequest;
+        } else if (operation->contains(Constants::MOVE)) {
+            batch->results[i] = ApplyBatchMove(*operation);
+        } else {
+            const json::value* dog_name = operation->if_contains(Constants::USER_NAME);
+            const json::value* map_id = operation->if_contains(Constants::MAP_ID);
+            if (!dog_name || !map_id || !dog_name->is_string() || !map_id->is_string() || dog_name->as_string().empty()) {
+                batch->results[i] = ErrorCode::JoinGameParse;
+                continue;
+            }
+            batch->pending.fetch_add(1, std::memory_order_relaxed);
+            auto on_joined = [batch, i, complete](service::UseCaseJoinPlayer::Result result, std::exception_ptr error) {
+                if (error) {
+                    batch->results[i] = ErrorCode::ServerError;
+                } else if (!result) {
+                    batch->results[i] = ErrorCode::MapNotFound;
+                } else {
+                    batch->joined[i] = std::move(result);
+                }
+                complete();
+            };
+            service_.JoinPlayer(model::Map::Id{std::string{map_id->as_string()}},
+                                std::string{dog_name->as_string()}, std::move(on_joined));
         }
-        auto timeDelta = content.as_object().at(Constants::TIME_DELTA).as_int64();
-        if (timeDelta < 0) {
-            return ResponseApiError(ErrorCode::TickParse);
-        }        
-
-        auto tick = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<size_t, std::milli>(timeDelta));
-        if (service_.TimeTick(tick)) {
-            return MakeStringResponse(http::status::ok, {}, req_data_, ContentType::APPLICATION_JSON);
+    }
+    complete();
+}
+
+StringResponse ApiHandler::MakeBatchResponse(const ApiRequest& req, const std::vector<ErrorCode>& results,
+                                             const std::vector<service::UseCaseJoinPlayer::Result>& joined) const {
+    std::string body;
+    util::JsonWriter writer{body};
+    writer.StartArray();
+    for (size_t i = 0; i < results.size(); ++i) {
+        writer.StartObject();
+        if (joined[i]) {
+            writer.Key(Constants::STATUS).Value(static_cast<unsigned>(http::status::ok));
+            writer.Key(Constants::AUTH_TOKEN).Value(joined[i]->first.ToString());
+            writer.Key(Constants::PLAYER_ID).Value(*joined[i]->second);
+        } else if (results[i] == ErrorCode::Ok) {
+            writer.Key(Constants::STATUS).Value(static_cast<unsigned>(http::status::ok));
+        } else {
+            auto [status, error] = ErrorBuilder::MakeErrorBody(results[i]);
+            writer.Key(Constants::STATUS).Value(static_cast<unsigned>(status));
+            writer.Key(Constants::ERROR).RawValue(error);
         }
-        return ResponseApiError(ErrorCode::TickError);
-    };
+        writer.EndObject();
+    }
+    writer.EndArray();
+    return MakeStringResponse(http::status::ok, std::move(body), req.data, ContentType::APPLICATION_JSON);
+}
 
-    return ExecuteAllowedMethods(std::move(action), http::verb::post);
+ErrorCode ApiHandler::ApplyBatchMove(const json::object& operation) const {
+    const json::value* token = operation.if_contains(Constants::AUTH_TOKEN);
+    auto player_token = token && token->is_string() ? service::Token::FromString(token->as_string()) : std::nullopt;
+    if (!player_token) {
+        return ErrorCode::InvalidAuthHeader;
+    }
+    const json::value& move = operation.at(Constants::MOVE);
+    auto direction = move.is_string() ? ParseDirection(move.as_string()) : std::nullopt;
+    if (!direction) {
+        return ErrorCode::ActionParse;
+    }
+    if (!service_.GameAction(*player_token, *direction)) {
+        return ErrorCode::PlayerTokenNotFound;
+    }
+    return ErrorCode::Ok;
 }
 
-int ExtractParameterValue(std::string_view api_token, std::string_view parameter) {
-    size_t start = api_token.find(parameter);
-    if (start == std::string::npos) {
-        return 0;
+StringResponse ApiHandler::HandleTickRequest(const ApiRequest& req) const {
+    if (req.data.content_type != ContentType::APPLICATION_JSON) {
+        return ResponseApiError(req, ErrorCode::BadRequest);
+    }
+    std::error_code ec;
+    json::value content = json::parse(req.data.body.value(), ec);
+    if (ec) {
+        return ResponseApiError(req, ErrorCode::TickParse);
     }
-    start += parameter.size();
-    if (start == api_token.size() || api_token[start] != '=') {
-        throw std::runtime_error("Value not found");
+    if (!content.is_object() ||
+        !content.as_object().contains(Constants::TIME_DELTA) ||
+        !content.as_object().at(Constants::TIME_DELTA).is_int64()) {
+        return ResponseApiError(req, ErrorCode::TickParse);
     }
-    size_t end = api_token.find_first_of('&', start);
-    if (end == std::string::npos) {
-        end = api_token.size();
+    auto timeDelta = content.as_object().at(Constants::TIME_DELTA).as_int64();
+    if (timeDelta < 0) {
+        return ResponseApiError(req, ErrorCode::TickParse);
+    }        
+
+    auto tick = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<size_t, std::milli>(timeDelta));
+    if (service_.TimeTick(tick)) {
+        return MakeStringResponse(http::status::ok, std::string{}, req.data, ContentType::APPLICATION_JSON);
     }
-    return std::stoi(std::string{api_token.substr(start + 1, end - start)});
+    return ResponseApiError(req, ErrorCode::TickError);
 }
 
-StringResponse ApiHandler::HandleRecordsRequest(std::string_view api_token, std::string_view version) const {
-    const auto action = [this, api_token](){
-        int start, max_items;
-        try {
-            start     = ExtractParameterValue(api_token, Constants::START);
-            max_items = ExtractParameterValue(api_token, Constants::MAX_ITEMS);
-        } catch (...) {
-            return ResponseApiError(ErrorCode::BadRequest);
-        }
-        if (max_items > 100) {
-            return ResponseApiError(ErrorCode::BadRequest);
-        }
-        if (max_items == 0) {
-            max_items = 100;
-        }
-        auto players = service_.Records(start, max_items);
-        json::array json_players;
-        for (const auto& player : players) {
-            json::object json_player;
-            json_player.emplace(Constants::NAME, player.GetName());
-            json_player.emplace(Constants::SCORE, player.GetScore());
-            json_player.emplace(Constants::PLAY_TIME, player.PlayTime()*1./1000);
-            json_players.push_back(std::move(json_player));
-        }
-        return MakeStringResponse(http::status::ok, json::serialize(json_players), req_data_, ContentType::APPLICATION_JSON);
-    };
+// Значение целого параметра; 0, если параметр не задан
+static std::optional<int> ParseIntegerParameter(const ApiRouteMatch& route, QueryParameter parameter) {
+    const auto& value = route.Parameter(parameter);
+    return value ? ParseInteger<int>(*value) : 0;
+}
 
-    return ExecuteAllowedMethods([this, &action](){
-        return action();
-    }, http::verb::get, http::verb::head);
+StringResponse ApiHandler::HandleRecordsRequest(const ApiRequest& req) const {
+    auto start = ParseIntegerParameter(*req.route, QueryParameter::Start);
+    auto max_items = ParseIntegerParameter(*req.route, QueryParameter::MaxItems);
+    if (!start || !max_items || *max_items > 100) {
+        return ResponseApiError(req, ErrorCode::BadRequest);
+    }
+    if (*max_items == 0) {
+        *max_items = 100;
+    }
+    auto players = service_.Records(*start, *max_items);
+    json::array json_players;
+    for (const auto& player : players) {
+        json::object json_player;
+        json_player.emplace(Constants::NAME, player.GetName());
+        json_player.emplace(Constants::SCORE, player.GetScore());
+        json_player.emplace(Constants::PLAY_TIME, player.PlayTime()*1./1000);
+        json_players.push_back(std::move(json_player));
+    }
+    return MakeStringResponse(http::status::ok, json::serialize(json_players), req.data, ContentType::APPLICATION_JSON);
 }
 
 }
\ No newline at end of file
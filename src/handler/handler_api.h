@@ -5,9 +5,14 @@
 #include "../loader/json_loader.h"
 #include "../loader/extra_data.h"
 
+#include "api_router.h"
 #include "handler_constants.h"
 #include "response.h"
 
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <variant>
 #include <vector>
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
@@ -26,114 +31,92 @@ using namespace http_request;
 
 using ErrorCode = http_request::ErrorBuilder::ErrorCode;
 using StringResponse = http::response<http::string_body>;
+using SharedResponse = http_request::SharedResponse;
+using ApiResponse = std::variant<StringResponse, SharedResponse>;
+
+// Запрос к API: разобранный запрос и найденный по нему маршрут.
+// Создаётся один раз в RequestHandler, строки маршрута указывают в data.decoded_uri
+struct ApiRequest {
+    explicit ApiRequest(const http_request::RequestData& data)
+        : data(data) {
+        if (data.decoded_uri) {
+            route = MatchApiRoute(*data.decoded_uri);
+        }
+    }
+
+    ApiRequest(const ApiRequest&) = delete;
+    ApiRequest& operator=(const ApiRequest&) = delete;
 
+    const http_request::RequestData& data;
+    // nullopt, если цель не декодируется или такого маршрута нет
+    std::optional<ApiRouteMatch> route;
+};
+
+// Не хранит состояния запроса: один обработчик может одновременно
+// обслуживать запросы из разных потоков
 class ApiHandler {
 
 public:
     explicit ApiHandler(service::Service& service, const extra_data::ExtraData& extra_data);
 
-    template <typename Body, typename Allocator>
-    StringResponse  HandleRequest( const http::request<Body, http::basic_fields<Allocator>>& req) {
-
-        req_data_.SetData(req);
+    // Попадания и промахи кэша сериализованного состояния игры
+    const util::CacheStats& GetStateCacheStats() const noexcept {
+        return state_cache_stats_;
+    }
 
-        if (!req_data_.decoded_uri.has_value()) {
-            return ResponseApiError(ErrorBuilder::ErrorCode::InvalidURI);
-        }
-        req_tokens_ = util::SplitIntoTokens(*req_data_.decoded_uri, '/');
-        if (req_tokens_.empty() || req_tokens_.front() != ApiTokens::API) {
-            return ResponseApiError(ErrorBuilder::ErrorCode::BadRequest);
-        }
-        req_tokens_.pop();
-        if (req_tokens_.empty()) {
-            return ResponseApiError(ErrorBuilder::ErrorCode::BadRequest);
-        }
-        auto version = req_tokens_.front(); req_tokens_.pop();
-        
-        if (version != ApiTokens::V1) {
-            return ResponseApiError(ErrorBuilder::ErrorCode::BadRequest);
-        }
-        if (req_tokens_.empty()) {
-            return ResponseApiError(ErrorBuilder::ErrorCode::BadRequest);
-        }
-        auto token = req_tokens_.front(); req_tokens_.pop();
-        if (token == ApiTokens::MAPS) {
-            return HandleMapsRequest(version);
-        }
-        if (token == ApiTokens::GAME) {
-            return HandleGameRequest(version);
-        }        
-        return ResponseApiError(ErrorBuilder::ErrorCode::BadRequest);
+    // Изменяет ли запрос состояние игры. Только такие запросы выполняются в api_strand
+    static bool IsMutatingRequest(const ApiRequest& req) noexcept {
+        // Все изменяющие обработчики принимают только POST, остальные методы
+        // либо читают данные, либо получат ответ 405 без обращения к игре
+        return req.data.method != http::verb::get && req.data.method != http::verb::head;
     }
 
-private:
-    StringResponse ResponseApiError(ErrorBuilder::ErrorCode ec) const;
+    // Получает ответ ровно один раз: сразу или, для присоединения, из потока симуляции
+    // после тика. Ответ строится по данным запроса, поэтому req должен жить, пока respond не вызван
+    using ApiResponder = std::function<void(ApiResponse&& response)>;
 
-    StringResponse HandleMapsRequest(std::string_view version) const;
-    StringResponse HandleAllMapsRequest(std::string_view version) const;
-    StringResponse HandleSingleMapRequest(std::string_view version) const;
+    // Проверяет маршрут и метод и вызывает обработчик маршрута
+    void HandleRequest(const ApiRequest& req, ApiResponder respond) const;
 
-    StringResponse HandleGameRequest(std::string_view version) const;
-    StringResponse HandlePlayerJoin(std::string_view version) const;
-    StringResponse HandlePlayersRequest(std::string_view version) const;
-    StringResponse HandleStateRequest(std::string_view version) const;
-    StringResponse HandlePlayerActionRequest(std::string_view version) const;
+private:
+    void HandleRoute(const ApiRequest& req, ApiResponder respond) const;
+
+    StringResponse ResponseApiError(const ApiRequest& req, ErrorBuilder::ErrorCode ec) const;
+    // 405 с заголовком Allow из таблицы маршрутов
+    StringResponse MakeInvalidMethodResponse(const ApiRequest& req, const ApiRouteSpec& spec) const;
+    // Добавляет Vary: Accept к ответу маршрута, у которого есть двоичный формат
+    static ApiResponse VaryByAccept(ApiResponse&& response);
+
+    StringResponse HandleAllMapsRequest(const ApiRequest& req) const;
+    StringResponse HandleSingleMapRequest(const ApiRequest& req) const;
+
+    void HandlePlayerJoin(const ApiRequest& req, ApiResponder respond) const;
+    StringResponse HandlePlayersRequest(const ApiRequest& req) const;
+    // since=<tick> запрашивает только изменения с этого тика, radius и bbox - область интереса
+    ApiResponse HandleStateRequest(const ApiRequest& req) const;
+    StringResponse HandlePlayerActionRequest(const ApiRequest& req) const;
+    // Массив операций {authToken, move} и {userName, mapId}, результат - массив по одному элементу на операцию
+    void HandleBatchRequest(const ApiRequest& req, ApiResponder respond) const;
+    StringResponse MakeBatchResponse(const ApiRequest& req, const std::vector<ErrorCode>& results,
+                                     const std::vector<service::UseCaseJoinPlayer::Result>& joined) const;
+    ErrorCode ApplyBatchMove(const json::object& operation) const;
     
-    StringResponse HandleTickRequest(std::string_view version) const;
+    StringResponse HandleTickRequest(const ApiRequest& req) const;
     
-    StringResponse HandleRecordsRequest(std::string_view api_token, std::string_view version) const;
-
-
-    template <typename... Args>
-    StringResponse MakeInvalidMethodResponse(const Args&... args) const {
-        std::ostringstream methods;
-        PrintMethods(methods, args...);
-        auto response = ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::InvalidMethod, req_data_, methods.str());
-        response.set(http::field::allow, methods.str());
-        return response;
-    }     
-
-    template <typename Arg, typename... Args>
-    bool IsMethodOneOfAllowed(const Arg& arg, const Args&... args) const {
-        if (req_data_.method == arg)
-            return true;
-        if constexpr (sizeof...(args) != 0) {
-            return IsMethodOneOfAllowed(args...);
-        }
-        return false;
-    }
-
-    template <typename Fn, typename... Args>
-    StringResponse ExecuteAllowedMethods(Fn&& action, const Args&... allowed_methods) const {
-        if (!IsMethodOneOfAllowed(allowed_methods...)) {
-            return MakeInvalidMethodResponse(allowed_methods...);
-        }
-        return action();
-    }
-
-    template <typename Arg, typename... Args>
-    void PrintMethods(std::ostream& out, const Arg& arg, const Args&... args) const {
-        out << Methods::method_to_str.at(arg);
-        if constexpr (sizeof...(args) != 0) {
-            out << ", "sv;
-            PrintMethods(out, args...);
-        }
-    } 
+    StringResponse HandleRecordsRequest(const ApiRequest& req) const;
 
     template <typename Fn>
-    StringResponse ExecuteAuthorized(Fn&& action) const {
-        if (!req_data_.auth_token.has_value()) {
-            return ResponseApiError(ErrorCode::InvalidAuthHeader);
+    std::invoke_result_t<Fn, const service::Token&> ExecuteAuthorized(const ApiRequest& req, Fn&& action) const {
+        if (!req.data.auth_token.has_value()) {
+            return ResponseApiError(req, ErrorCode::InvalidAuthHeader);
         }
-        return action(req_data_.auth_token.value());
+        return action(req.data.auth_token.value());
     }    
 
 private:
     service::Service & service_;
     const extra_data::ExtraData& extra_data_;
-
-    http_request::RequestData req_data_;
-    mutable std::queue<std::string_view> req_tokens_;
+    mutable util::CacheStats state_cache_stats_;
 };
 
 }
@@ -21,7 +21,9 @@ struct ApiTokens {
     static constexpr std::string_view ACTION    = "action"sv;
     static constexpr std::string_view TICK      = "tick"sv;
     static constexpr std::string_view RECORDS   = "records"sv;
-    static const fs::path api_root;
+    static constexpr std::string_view WS        = "ws"sv;
+    static constexpr std::string_view EVENTS    = "events"sv;
+    static constexpr std::string_view BATCH     = "batch"sv;
 };
 
 struct Constants {
@@ -45,6 +47,23 @@ struct Constants {
     static constexpr std::string_view START         = "start"sv;
     static constexpr std::string_view MAX_ITEMS     = "maxItems"sv;
     static constexpr std::string_view PLAY_TIME     = "playTime"sv;    
+    static constexpr std::string_view SINCE         = "since"sv;
+    static constexpr std::string_view WAIT          = "wait"sv;
+    static constexpr std::string_view RADIUS        = "radius"sv;
+    static constexpr std::string_view BBOX          = "bbox"sv;
+    static constexpr std::string_view TICK          = "tick"sv;
+    static constexpr std::string_view FULL          = "full"sv;
+    static constexpr std::string_view REMOVED_PLAYERS       = "removedPlayers"sv;
+    static constexpr std::string_view REMOVED_LOST_OBJECTS  = "removedLostObjects"sv;
+    static constexpr std::string_view SESSION       = "session"sv;
+    static constexpr std::string_view SESSIONS      = "sessions"sv;
+    static constexpr std::string_view DOG           = "dog"sv;
+    static constexpr std::string_view DOGS          = "dogs"sv;
+    static constexpr std::string_view LOOT_ID       = "lootId"sv;
+    static constexpr std::string_view ITEMS         = "items"sv;
+    static constexpr std::string_view SCORE_CHANGE  = "scoreChange"sv;
+    static constexpr std::string_view STATUS        = "status"sv;
+    static constexpr std::string_view ERROR         = "error"sv;
 };
 
 }
\ No newline at end of file
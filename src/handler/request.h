@@ -4,7 +4,6 @@
 #include <boost/beast/http.hpp>
 
 #include <optional>
-#include <regex>
 
 #include "../service/service.h"
 #include "../util/util.h" 
@@ -41,6 +40,8 @@ struct ContentType {
     static constexpr std::string_view IMAGE_SVG         = "image/svg+xml"sv;
     static constexpr std::string_view AUDIO_MP3         = "audio/mpeg"sv;
     static constexpr std::string_view APPLICATION_OCTED = "application/octet-stream"sv;
+    // Двоичный формат состояния игры и карт, см. binary_format.h
+    static constexpr std::string_view APPLICATION_BLOODHOUND_BIN = "application/x-bloodhound-bin"sv;
 
     static std::string_view FromFileExt(std::string_view ext) {
         if (ext_to_content.contains(ext)) {
@@ -53,6 +54,9 @@ private:
 };
 
 
+// Разобранный запрос: создаётся один раз и передаётся всем слоям обработчика.
+// Строки указывают в буферы запроса, поэтому запрос должен жить дольше RequestData,
+// а сам объект не копируется: decoded_uri может указывать в decoded_storage_
 struct RequestData {
     RequestData() = default;
 
@@ -61,14 +65,16 @@ struct RequestData {
         SetData(req);
     }
 
+    RequestData(const RequestData&) = delete;
+    RequestData& operator=(const RequestData&) = delete;
+
     template <typename Body, typename Allocator>
     void SetData(const http::request<Body, http::basic_fields<Allocator>>& req) {
         http_version = req.version();
         keep_alive = req.keep_alive();
         method = req.method();
         raw_uri = req.target();
-        decoded_uri = util::DecodeURI(req.target());
-        //decoded_uri = req.target();
+        DecodeUri();
         if (method == http::verb::post) {
             body = req.body();
             content_type = req[http::field::content_type];
@@ -78,35 +84,60 @@ struct RequestData {
         }
         if (req.count(http::field::authorization)) {
             auth_token = ParseAuthToken(req);
-        }        
+        } else {
+            auth_token.reset();
+        }
+        const auto accept = req[http::field::accept];
+        accept_binary = PrefersBinary({accept.data(), accept.size()});
     } 
 
     unsigned http_version{};
     bool keep_alive{};
     http::verb method{};
     std::string_view raw_uri;
-    std::optional<std::string> decoded_uri;
+    // nullopt, если цель запроса не декодируется
+    std::optional<std::string_view> decoded_uri;
     std::optional<std::string_view> body;
     std::optional<std::string_view> content_type;
     std::optional<service::Token> auth_token;    
+    // Клиент запросил двоичный формат вместо JSON
+    bool accept_binary{};
 
 private:
+    // Двоичный формат отдаётся только клиенту, который назвал его явно и оценил не ниже JSON
+    static bool PrefersBinary(std::string_view accept) {
+        const auto binary = util::GetAcceptWeight(accept, ContentType::APPLICATION_BLOODHOUND_BIN);
+        const auto json = util::GetAcceptWeight(accept, ContentType::APPLICATION_JSON);
+        return binary.exact && binary.q > 0. && binary.q >= json.q;
+    }
+
+    // Цель без '%' и '+' совпадает с декодированной: обычный запрос к API обходится без копии
+    void DecodeUri() {
+        if (raw_uri.find_first_of("%+"sv) == std::string_view::npos) {
+            decoded_uri = raw_uri;
+            return;
+        }
+        if (auto decoded = util::DecodeURI(raw_uri)) {
+            decoded_storage_ = std::move(*decoded);
+            decoded_uri = decoded_storage_;
+        } else {
+            decoded_uri.reset();
+        }
+    }
+
     template <typename Body, typename Allocator>
     std::optional<service::Token> ParseAuthToken(const http::request<Body, http::basic_fields<Allocator>>& req) {
-        const std::string req_field = req[http::field::authorization];
-        static const std::string auth_token_pattern = "[0-9a-fA-F]{32}"s;
-        static const auto full_r = std::regex("^Bearer "s.append(auth_token_pattern).append("$"));
-        if (!std::regex_match(req_field, full_r)) {
+        static constexpr std::string_view bearer = "Bearer "sv;
+        const auto field = req[http::field::authorization];
+        const std::string_view value{field.data(), field.size()};
+        if (!value.starts_with(bearer)) {
             return std::nullopt;
         }
-        static const auto token_r = std::regex(auth_token_pattern);
-        std::sregex_iterator begin{ req_field.cbegin(), req_field.cend(), token_r };
-        std::sregex_iterator end{};
-        if (std::distance(begin, end) != 1) {
-            return std::nullopt;
-        }
-        return service::Token{std::move(begin->str())};
+        // Ровно 32 шестнадцатеричные цифры после "Bearer "
+        return service::Token::FromString(value.substr(bearer.size()));
     }    
+
+    std::string decoded_storage_;
 };
 
 }
\ No newline at end of file
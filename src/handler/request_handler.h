@@ -7,6 +7,9 @@
 #include "handler_api.h"
 #include "response.h"
 #include "request.h"
+#include "event_stream.h"
+#include "state_stream.h"
+#include "tick_waiters.h"
 
 #include <boost/asio/strand.hpp>
 
@@ -32,14 +35,37 @@ using StringResponse = http::response<http::string_body>;
 using FileResponse = http::response<http::file_body>;
 
 
+// Запрос вместе с его разбором. Разбор ссылается на буферы запроса, поэтому объект
+// не копируется и не перемещается, а между потоками передаётся по указателю
+template <typename Body, typename Allocator>
+struct ParsedRequest {
+    explicit ParsedRequest(http::request<Body, http::basic_fields<Allocator>>&& req)
+        : request(std::move(req))
+        , data(request)
+        , api(data) {
+    }
+
+    ParsedRequest(const ParsedRequest&) = delete;
+    ParsedRequest& operator=(const ParsedRequest&) = delete;
+
+    const http::request<Body, http::basic_fields<Allocator>> request;
+    const http_request::RequestData data;
+    const ApiRequest api;
+};
+
+
 class RequestHandler : public std::enable_shared_from_this<RequestHandler>{
 public:
     using Strand = net::strand<net::io_context::executor_type>;
 
     typedef void (Handler) (StringRequest& request);
 
-    explicit RequestHandler(ApiHandler& api_handler, Strand api_strand, fs::path basePath) 
+    explicit RequestHandler(ApiHandler& api_handler, StateBroadcaster& state_broadcaster, EventBroadcaster& event_broadcaster,
+                            TickWaiters& tick_waiters, Strand api_strand, fs::path basePath) 
             : api_handler_{api_handler}
+            , state_broadcaster_{state_broadcaster}
+            , event_broadcaster_{event_broadcaster}
+            , tick_waiters_{tick_waiters}
             , api_strand_{api_strand}
             , rootPath_{std::move(fs::weakly_canonical(basePath))} { }
 
@@ -48,58 +74,192 @@ public:
 
     template <typename Body, typename Allocator, typename Send>
     void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-        // Обработать запрос request и отправить ответ, используя send
+        // Обработать запрос request и отправить ответ, используя send.
+        // HandleRequest перемещает req, поэтому поля ответа об ошибке запоминаются заранее
+        http_request::RequestData error_data;
+        error_data.http_version = req.version();
+        error_data.keep_alive = req.keep_alive();
+        error_data.method = req.method();
         try {
             HandleRequest(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
-        } catch (...) {         
-            http_request::RequestData data(req);
-            send(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::ServerError, data));
+        } catch (...) {
+            send(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::ServerError, error_data));
+        }
+    }
+
+    // WebSocket на любой путь (неверный путь получит отказ) или поток событий /api/v1/game/events.
+    // Остальные запросы с Accept: text/event-stream обслуживаются как обычные
+    template <typename Body, typename Allocator>
+    static bool IsUpgradeRequest(const http::request<Body, http::basic_fields<Allocator>>& req) {
+        if (websocket::is_upgrade(req)) {
+            return true;
+        }
+        // EventSource всегда запрашивает text/event-stream
+        if (req.method() != http::verb::get
+            || req[http::field::accept].find("text/event-stream"sv) == std::string_view::npos) {
+            return false;
+        }
+        const auto target = req.target();
+        auto route = MatchApiRoute(std::string_view{target.data(), target.size()});
+        return route && route->Route() == ApiRoute::Events;
+    }
+
+    // Запрос, после которого соединение не возвращается HTTP-сессии: WebSocket или поток событий
+    template <typename Body, typename Allocator>
+    void Upgrade(beast::tcp_stream&& stream, http::request<Body, http::basic_fields<Allocator>>&& req) {
+        if (websocket::is_upgrade(req)) {
+            return OpenStateStream(std::move(stream), std::move(req));
         }
+        OpenEventStream(std::move(stream), std::move(req));
     }
 
 private:
 
+    // WebSocket: подписка на состояние сеанса игрока.
+    // Токен передаётся в заголовке Authorization или параметром authToken, так как браузер не умеет задавать заголовки WebSocket
+    template <typename Body, typename Allocator>
+    void OpenStateStream(beast::tcp_stream&& stream, http::request<Body, http::basic_fields<Allocator>>&& req) {
+        auto session = std::make_shared<StateStreamSession>(std::move(stream));
+        http_request::RequestData data(req);
+        ApiRequest api_req(data);
+        if (!data.decoded_uri.has_value()) {
+            return session->Reject(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::InvalidURI, data));
+        }
+        if (!api_req.route || api_req.route->Route() != ApiRoute::StateStream) {
+            return session->Reject(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::BadRequest, data));
+        }
+
+        std::optional<service::Token> token = data.auth_token;
+        if (auto value = api_req.route->Parameter(QueryParameter::AuthToken); !token && value) {
+            token = service::Token::FromString(*value);
+        }
+        if (!token) {
+            return session->Reject(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::InvalidAuthHeader, data));
+        }
+        if (!state_broadcaster_.Subscribe(*token, session)) {
+            return session->Reject(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::PlayerTokenNotFound, data));
+        }
+        session->Accept(std::move(req));
+    }
+
+    // Server-Sent Events для наблюдателей: события всех сеансов, без авторизации
+    template <typename Body, typename Allocator>
+    void OpenEventStream(beast::tcp_stream&& stream, http::request<Body, http::basic_fields<Allocator>>&& req) {
+        auto session = std::make_shared<EventStreamSession>(std::move(stream));
+        http_request::RequestData data(req);
+        ApiRequest api_req(data);
+        if (!data.decoded_uri.has_value()) {
+            return session->Reject(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::InvalidURI, data));
+        }
+        if (!api_req.route || api_req.route->Route() != ApiRoute::Events) {
+            return session->Reject(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::BadRequest, data));
+        }
+        event_broadcaster_.Subscribe(session);
+        session->Start(req.version());
+    }
+
     template <typename Body, typename Allocator, typename Send>
     void HandleRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-        auto version = req.version();
-        auto keep_alive = req.keep_alive();
-
-        // Обработать запрос request и отправить ответ, используя send
-        if (IsApiRequest(req)) {
-            auto handle = [self = shared_from_this(), send, req = std::forward<decltype(req)>(req)]() {
-                try {
-                    send(self->api_handler_.HandleRequest(req));
-                } catch (...) {
-                    http_request::RequestData data(req);
-                    send(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::ServerError, data));
-                }
+        // Запрос разбирается один раз, разбор ссылается на буферы запроса.
+        // Оба живут в куче, пока обработчик в другом потоке или ожидании не отправит ответ
+        auto parsed = std::make_shared<const ParsedRequest<Body, Allocator>>(std::move(req));
+        if (!parsed->data.decoded_uri || !IsApiTarget(*parsed->data.decoded_uri)) {
+            return std::visit(
+                [&send](auto&& result) {
+                    send(std::forward<decltype(result)>(result));
+                },
+                MakeFileResponse(parsed->data, rootPath_)
+            );
+        }
+
+        if (IsLongPollRequest(parsed->api)) {
+            // wait=1: ответ строится из снимка, опубликованного следующим тиком.
+            // Пока запрос ждёт, он не занимает ни поток, ни api_strand
+            auto respond = [self = shared_from_this(), send, parsed]() mutable {
+                self->HandleApiRequest(parsed, send);
             };
-            return net::dispatch(api_strand_, handle);
+            return tick_waiters_.AsyncWait(api_strand_.get_inner_executor(), LONG_POLL_TIMEOUT, std::move(respond));
+        }
+        if (!ApiHandler::IsMutatingRequest(parsed->api)) {
+            // Карты неизменны, состояние игры читается из опубликованного снимка, а рекорды -
+            // из базы через пул соединений, поэтому такие запросы выполняются сразу
+            // в потоке ввода-вывода и не ждут в очереди api_strand за тиком
+            return HandleApiRequest(parsed, send);
+        }
+        auto handle = [self = shared_from_this(), send, parsed]() mutable {
+            self->HandleApiRequest(parsed, send);
+        };
+        net::dispatch(api_strand_, std::move(handle));
+    }
+
+    // Ответ может прийти позже из потока симуляции, поэтому отвечающий держит запрос и send у себя
+    template <typename Request, typename Send>
+    void HandleApiRequest(const std::shared_ptr<Request>& parsed, Send& send) const {
+        try {
+            api_handler_.HandleRequest(parsed->api, [parsed, send](ApiResponse&& response) mutable {
+                SendApiResponse(std::move(response), send);
+            });
+        } catch (...) {
+            send(ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::ServerError, parsed->data));
         }
-        return std::visit(
+    }
+
+    template <typename Send>
+    static void SendApiResponse(ApiResponse&& response, Send& send) {
+        std::visit(
             [&send](auto&& result) {
                 send(std::forward<decltype(result)>(result));
             },
-            MakeFileResponse(std::forward<decltype(req)>(req),rootPath_)
+            std::move(response)
         );
     }
 
-
-
-    template <typename Body, typename Allocator>
-    bool IsApiRequest(const http::request<Body, http::basic_fields<Allocator>>& req) const {
-        auto decoded_uri = util::DecodeURI(req.target());
-        if (!decoded_uri.has_value()) {
+    // GET /api/v1/game/state?wait=1
+    static bool IsLongPollRequest(const ApiRequest& req) {
+        if (req.data.method != http::verb::get && req.data.method != http::verb::head) {
             return false;
         }
-        fs::path uri(decoded_uri.value());
-        return util::IsSubPath(uri, http_handler::ApiTokens::api_root);
+        return req.route && req.route->Route() == ApiRoute::State
+            && req.route->Parameter(QueryParameter::Wait) == "1"sv;
     }
 
 private:
+    // Дольше тика запрос ждёт, только если тики прекратились.
+    // Заметно меньше тайм-аута соединения (30 с), чтобы ответ успел уйти клиенту
+    static constexpr std::chrono::milliseconds LONG_POLL_TIMEOUT{25'000};
+
     fs::path rootPath_;
     Strand api_strand_;
     ApiHandler& api_handler_;
+    StateBroadcaster& state_broadcaster_;
+    EventBroadcaster& event_broadcaster_;
+    TickWaiters& tick_waiters_;
+};
+
+// Копируемая ссылка на RequestHandler: http_server и логирующий декоратор хранят обработчик по значению
+class SharedRequestHandler {
+public:
+    explicit SharedRequestHandler(std::shared_ptr<RequestHandler> handler)
+        : handler_{std::move(handler)} {
+    }
+
+    template <typename Request, typename Send>
+    void operator()([[maybe_unused]] const tcp::endpoint& endpoint, Request&& req, Send&& send) {
+        (*handler_)(std::forward<Request>(req), std::forward<Send>(send));
+    }
+
+    template <typename Request>
+    bool IsUpgradeRequest(const Request& req) const {
+        return RequestHandler::IsUpgradeRequest(req);
+    }
+
+    template <typename Request>
+    void Upgrade([[maybe_unused]] const tcp::endpoint& endpoint, beast::tcp_stream&& stream, Request&& req) {
+        handler_->Upgrade(std::move(stream), std::forward<Request>(req));
+    }
+
+private:
+    std::shared_ptr<RequestHandler> handler_;
 };
 
 
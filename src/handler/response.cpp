@@ -37,6 +37,10 @@ const std::unordered_map<http::verb, std::string_view> Methods::method_to_str =
 };
 
 StringResponse MakeStringResponse(http::status status, std::string_view body, const http_request::RequestData& req_data, std::string_view content_type) {
+    return MakeStringResponse(status, std::string{body}, req_data, content_type);
+}
+
+StringResponse MakeStringResponse(http::status status, std::string&& body, const http_request::RequestData& req_data, std::string_view content_type) {
     StringResponse response(status, req_data.http_version);
     response.set(http::field::content_type, content_type);
     response.set(http::field::cache_control, ConstantsResponse::NO_CACHE);
@@ -47,11 +51,91 @@ StringResponse MakeStringResponse(http::status status, std::string_view body, co
         response.body() = ConstantsResponse::EMPTY_JSON;
         response.content_length(ConstantsResponse::EMPTY_JSON.size());
     } else {
-        response.body() = body;
         response.content_length(body.size());
+        response.body() = std::move(body);
+    }
+    response.keep_alive(req_data.keep_alive);
+    return response;
+}
+
+SharedResponse MakeSharedResponse(http::status status, std::shared_ptr<const std::string> body,
+                                  const http_request::RequestData& req_data, std::string_view content_type) {
+    SharedResponse response(status, req_data.http_version);
+    response.set(http::field::content_type, content_type);
+    response.set(http::field::cache_control, ConstantsResponse::NO_CACHE);
+
+    const size_t size = SharedStringBody::size(body);
+    if (req_data.method != http::verb::head) {
+        response.body() = std::move(body);
     }
+    response.content_length(size);
     response.keep_alive(req_data.keep_alive);
     return response;
 }
 
+std::variant<StringResponse, FileResponse> MakeFileResponse(const http_request::RequestData& data, const fs::path& rootPath){
+    if (data.method != http::verb::get) {
+        auto response = ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::InvalidMethod, data);
+        response.set(http::field::allow, Methods::GET);
+        return response;
+    }
+
+    http::response<http::file_body> response;
+    response.version(11);  // HTTP/1.1
+    response.result(http::status::ok);
+
+    if (!data.decoded_uri){
+        return ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::BadRequest, data);
+    }
+    std::string_view decoded_uri = data.decoded_uri.value();
+
+    fs::path static_content{rootPath};
+    if (!util::IsSubPath(static_content,rootPath)){
+        return ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::BadRequest, data);
+    }
+
+    fs::path default_path{ConstantsResponse::INDEX_HTML};
+    if(decoded_uri.empty() || decoded_uri == "/") {
+        static_content = fs::weakly_canonical(static_content / default_path);
+    } else {
+        std::string_view pathStr = decoded_uri.substr(1, decoded_uri.size() - 1);
+        fs::path rel_path{pathStr};
+        static_content = fs::weakly_canonical(static_content / rel_path);
+
+        if(fs::is_directory(static_content)) {
+            static_content = fs::weakly_canonical(static_content / default_path);
+        }        
+    }
+
+    if (!fs::exists(static_content)){
+        StringResponse error = ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::FileNotFound, data);
+        error.body().append(data.decoded_uri.value());
+        error.content_length(error.body().size());
+        return error;
+    }
+
+    std::string_view content = ContentType::FromFileExt(
+                boost::algorithm::to_lower_copy(static_content.extension().string())
+            );
+
+    response.insert(http::field::content_type, content);
+    
+    http::file_body::value_type file;
+
+    if (sys::error_code ec; file.open(static_content.c_str(), beast::file_mode::read, ec), ec) {
+        StringResponse error = ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::FileNotFound, data);
+        error.body().append(data.decoded_uri.value());
+        error.content_length(error.body().size());
+        return error;
+    } else {
+        response.body() = std::move(file);
+    }
+
+    // Метод prepare_payload заполняет заголовки Content-Length и Transfer-Encoding
+    // в зависимости от свойств тела сообщения
+    response.prepare_payload();
+
+    return response;
+}
+
 }
\ No newline at end of file
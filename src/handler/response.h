@@ -6,6 +6,7 @@
 #include <boost/algorithm/string/case_conv.hpp>
 
 #include <filesystem>
+#include <memory>
 #include <optional>
 #include <string_view>
 #include <unordered_map>
@@ -29,6 +30,42 @@ using namespace std::literals;
 using StringResponse = http::response<http::string_body>;
 using FileResponse = http::response<http::file_body>;
 
+// Тело ответа, разделяющее неизменяемую строку с другими ответами без копирования
+struct SharedStringBody {
+    using value_type = std::shared_ptr<const std::string>;
+
+    static std::uint64_t size(const value_type& body) {
+        return body ? body->size() : 0;
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template <bool isRequest, typename Fields>
+        writer(const http::header<isRequest, Fields>&, const value_type& body)
+            : body_{body} {
+        }
+
+        void init(beast::error_code& ec) {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+            ec = {};
+            if (!body_ || body_->empty()) {
+                return boost::none;
+            }
+            return {{const_buffers_type{body_->data(), body_->size()}, false}};
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
+
+using SharedResponse = http::response<SharedStringBody>;
+
 struct ConstantsResponse {
     ConstantsResponse() = delete;
     static constexpr std::string_view NO_CACHE      = "no-cache"sv;
@@ -38,6 +75,12 @@ struct ConstantsResponse {
 
 StringResponse MakeStringResponse(http::status status, std::string_view body, const http_request::RequestData& req_data,
                                   std::string_view content_type);
+// Перемещает готовое тело в ответ без копирования
+StringResponse MakeStringResponse(http::status status, std::string&& body, const http_request::RequestData& req_data,
+                                  std::string_view content_type);
+
+SharedResponse MakeSharedResponse(http::status status, std::shared_ptr<const std::string> body,
+                                  const http_request::RequestData& req_data, std::string_view content_type);
 
 
 class ErrorBuilder {
@@ -64,7 +107,13 @@ public:
 
     static StringResponse MakeErrorResponse(ErrorCode ec, const http_request::RequestData& req_data, std::optional<std::string_view> param = std::nullopt) {
         auto [status, body, content_type] = Error(ec, param);
-        return MakeStringResponse(status, body, req_data, content_type);
+        return MakeStringResponse(status, std::move(body), req_data, content_type);
+    }
+
+    // Статус и тело ошибки без HTTP-ответа: результат отдельной операции пакетного запроса
+    static std::pair<http::status, std::string> MakeErrorBody(ErrorCode ec) {
+        auto [status, body, content_type] = Error(ec, std::nullopt);
+        return {status, std::move(body)};
     }
 
 private:
@@ -101,6 +150,8 @@ private:
             return {http::status::bad_request, SerializeError(Codes::InvalidArgument, Messages::TickParse), ContentType::APPLICATION_JSON};            
         case ErrorCode::TickError:
             return {http::status::bad_request, SerializeError(Codes::BadRequest, Messages::TickError), ContentType::APPLICATION_JSON};            
+        case ErrorCode::ServerError:
+            return {http::status::internal_server_error, SerializeError(Codes::ServerError, Messages::ServerError), ContentType::APPLICATION_JSON};
         case ErrorCode::InvalidMethod: {
             std::ostringstream message;
             message << Messages::InvalidMethod;
@@ -116,73 +167,7 @@ private:
     }
 };
 
-template <typename Body, typename Allocator>
-std::variant<StringResponse, FileResponse> MakeFileResponse( http::request<Body, http::basic_fields<Allocator>>&& req, const fs::path& rootPath){
-    http_request::RequestData data(req);
-
-    if (data.method != http::verb::get) {
-        auto response = ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::InvalidMethod, data);
-        response.set(http::field::allow, Methods::GET);
-        return response;
-    }
-
-    http::response<http::file_body> response;
-    response.version(11);  // HTTP/1.1
-    response.result(http::status::ok);
-
-    auto target = util::DecodeURI(req.target());
-    if (!target){
-        return ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::BadRequest, data);
-    }
-    std::string_view decoded_uri = target.value();
-
-    fs::path static_content{rootPath};
-    if (!util::IsSubPath(static_content,rootPath)){
-        return ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::BadRequest, data);
-    }
-
-    fs::path default_path{ConstantsResponse::INDEX_HTML};
-    if(decoded_uri.empty() || decoded_uri == "/") {
-        static_content = fs::weakly_canonical(static_content / default_path);
-    } else {
-        std::string_view pathStr = decoded_uri.substr(1, decoded_uri.size() - 1);
-        fs::path rel_path{pathStr};
-        static_content = fs::weakly_canonical(static_content / rel_path);
-
-        if(fs::is_directory(static_content)) {
-            static_content = fs::weakly_canonical(static_content / default_path);
-        }        
-    }
-
-    if (!fs::exists(static_content)){
-        StringResponse error = ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::FileNotFound, data);
-        error.body().append(data.decoded_uri.value());
-        error.content_length(error.body().size());
-        return error;
-    }
-
-    std::string_view content = ContentType::FromFileExt(
-                boost::algorithm::to_lower_copy(static_content.extension().string())
-            );
-
-    response.insert(http::field::content_type, content);
-    
-    http::file_body::value_type file;
-
-    if (sys::error_code ec; file.open(static_content.c_str(), beast::file_mode::read, ec), ec) {
-        StringResponse error = ErrorBuilder::MakeErrorResponse(ErrorBuilder::ErrorCode::FileNotFound, data);
-        error.body().append(data.decoded_uri.value());
-        error.content_length(error.body().size());
-        return error;
-    } else {
-        response.body() = std::move(file);
-    }
-
-    // Метод prepare_payload заполняет заголовки Content-Length и Transfer-Encoding
-    // в зависимости от свойств тела сообщения
-    response.prepare_payload();
-
-    return response;
-};
+// Статический файл из каталога rootPath по декодированному пути запроса
+std::variant<StringResponse, FileResponse> MakeFileResponse(const http_request::RequestData& data, const fs::path& rootPath);
 
 }
\ No newline at end of file
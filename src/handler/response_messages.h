@@ -16,6 +16,7 @@ struct Codes {
     static constexpr std::string_view InvalidArgument = "invalidArgument"sv;
     static constexpr std::string_view InvalidAuth = "invalidToken"sv;
     static constexpr std::string_view InvalidToken = "unknownToken"sv;
+    static constexpr std::string_view ServerError = "internalError"sv;
     
 };
 
@@ -33,6 +34,7 @@ struct Messages {
     static constexpr std::string_view ActionParse       = "Failed to parse action"sv;
     static constexpr std::string_view TickParse         = "Failed to parse tick request JSON"sv;
     static constexpr std::string_view TickError         = "Failed error set tick"sv;
+    static constexpr std::string_view ServerError       = "Internal server error"sv;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "state_json.h"
+
+#include "handler_constants.h"
+#include "../util/json_writer.h"
+
+#include <unordered_map>
+
+namespace http_handler {
+
+using namespace std::literals;
+
+static void WritePlayers(util::JsonWriter& writer, const std::vector<service::UseCaseGetGameState::PlayerState>& players) {
+    static const std::unordered_map<model::Dog::Direction, std::string_view> direction_map{
+        {model::Dog::Direction::NORTH, "U"sv},
+        {model::Dog::Direction::SOUTH, "D"sv},
+        {model::Dog::Direction::WEST,  "L"sv},
+        {model::Dog::Direction::EAST,  "R"sv}
+    };            
+
+    writer.Key(Constants::PLAYERS).StartObject();
+    for (const auto& player : players) {
+        writer.Key(*player.id).StartObject();
+        writer.Key(Constants::POSITION).StartArray().Value(player.pos.x).Value(player.pos.y).EndArray();
+        writer.Key(Constants::SPEED).StartArray().Value(player.speed.x).Value(player.speed.y).EndArray();
+        writer.Key(Constants::DIRECTION).Value(direction_map.at(player.dir));
+        writer.Key(Constants::BAG).StartArray();
+        for (auto loot_item : player.bag) {
+            writer.StartObject();
+            writer.Key(Constants::ID).Value(loot_item.id);
+            writer.Key(Constants::TYPE).Value(loot_item.type);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.Key(Constants::SCORE).Value(player.scores);
+        writer.EndObject();
+    }
+    writer.EndObject();
+}
+
+static void WriteLootObjects(util::JsonWriter& writer, const std::vector<service::UseCaseGetGameState::LootObjectState>& loot_objects) {
+    writer.Key(Constants::LOST_OBJECTS).StartObject();
+    for (const auto& loot_object : loot_objects) {
+        writer.Key(*loot_object.id).StartObject();
+        writer.Key(Constants::TYPE).Value(loot_object.type);
+        writer.Key(Constants::POSITION).StartArray().Value(loot_object.pos.x).Value(loot_object.pos.y).EndArray();
+        writer.EndObject();
+    }
+    writer.EndObject();
+}
+
+std::string SerializeGameState(const service::UseCaseGetGameState::GameState& state) {
+    std::string body;
+    util::JsonWriter writer{body};
+    writer.StartObject();
+    WritePlayers(writer, state.players);
+    WriteLootObjects(writer, state.loot_objects);
+    writer.EndObject();
+    return body;
+}
+
+std::string SerializeStateDelta(const service::UseCaseGetGameState::StateDelta& delta) {
+    std::string body;
+    util::JsonWriter writer{body};
+    writer.StartObject();
+    writer.Key(Constants::TICK).Value(delta.to_tick);
+    writer.Key(Constants::FULL).Value(false);
+    WritePlayers(writer, delta.players);
+    WriteLootObjects(writer, delta.loot_objects);
+    writer.Key(Constants::REMOVED_PLAYERS).StartArray();
+    for (const auto& id : delta.removed_players) {
+        writer.Value(*id);
+    }
+    writer.EndArray();
+    writer.Key(Constants::REMOVED_LOST_OBJECTS).StartArray();
+    for (const auto& id : delta.removed_loot_objects) {
+        writer.Value(*id);
+    }
+    writer.EndArray();
+    writer.EndObject();
+    return body;
+}
+
+std::string SerializeGameStateWithTick(uint64_t tick, std::string_view serialized_state) {
+    std::string body;
+    body.reserve(serialized_state.size() + 32);
+    util::JsonWriter writer{body};
+    writer.StartObject().Key(Constants::TICK).Value(tick).Key(Constants::FULL).Value(true);
+    // Поля состояния берутся из готовой строки без открывающей скобки
+    body.push_back(',');
+    body.append(serialized_state.substr(1));
+    return body;
+}
+
+}  // namespace http_handler
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../service/service.h"
+
+#include <string>
+#include <string_view>
+
+namespace http_handler {
+
+// Ответ /api/v1/game/state: {"players": {...}, "lostObjects": {...}}
+std::string SerializeGameState(const service::UseCaseGetGameState::GameState& state);
+
+// Изменения состояния: {"tick", "full": false, "players", "lostObjects", "removedPlayers", "removedLostObjects"}
+std::string SerializeStateDelta(const service::UseCaseGetGameState::StateDelta& delta);
+
+// Полное состояние с номером тика: {"tick", "full": true, "players", "lostObjects"}.
+// serialized_state - результат SerializeGameState
+std::string SerializeGameStateWithTick(uint64_t tick, std::string_view serialized_state);
+
+}  // namespace http_handler
@@ -0,0 +1,195 @@
+#include "state_stream.h"
+
+#include "state_json.h"
+
+namespace http_handler {
+
+using namespace std::literals;
+
+/* StateFrame */
+
+std::shared_ptr<const std::string> StateFrame::GetDelta() const {
+    return delta.Get([this] {
+        return SerializeStateDelta(*state->LatestChanges());
+    }).first;
+}
+
+std::shared_ptr<const std::string> StateFrame::GetFull() const {
+    return full.Get([this] {
+        auto [serialized, hit] = state->serialized.Get([this] {
+            return SerializeGameState(*state);
+        });
+        return SerializeGameStateWithTick(state->tick, *serialized);
+    }).first;
+}
+
+/* StateStreamSession */
+
+StateStreamSession::StateStreamSession(beast::tcp_stream&& stream)
+    : ws_{std::move(stream)} {
+}
+
+void StateStreamSession::Reject(http::response<http::string_body>&& response) {
+    auto safe_response = std::make_shared<http::response<http::string_body>>(std::move(response));
+    safe_response->keep_alive(false);
+    http::async_write(ws_.next_layer(), *safe_response,
+                      [self = shared_from_this(), safe_response](beast::error_code, std::size_t) {
+                          beast::error_code ec;
+                          self->ws_.next_layer().socket().shutdown(net::ip::tcp::socket::shutdown_send, ec);
+                      });
+}
+
+void StateStreamSession::Push(std::shared_ptr<const StateFrame> frame) {
+    net::dispatch(ws_.get_executor(), [self = shared_from_this(), frame = std::move(frame)]() mutable {
+        if (self->closed_) {
+            return;
+        }
+        self->pending_ = std::move(frame);
+        if (self->accepted_ && !self->writing_) {
+            self->WriteNext();
+        }
+    });
+}
+
+void StateStreamSession::Close() {
+    net::dispatch(ws_.get_executor(), [self = shared_from_this()] {
+        if (self->closed_) {
+            return;
+        }
+        self->closed_ = true;
+        self->pending_.reset();
+        // До окончания рукопожатия кадр закрытия отправит OnAccept
+        if (self->accepted_) {
+            self->SendClose();
+        }
+    });
+}
+
+void StateStreamSession::SendClose() {
+    ws_.async_close(websocket::close_code::normal, [self = shared_from_this()](beast::error_code) {});
+}
+
+void StateStreamSession::OnAccept(beast::error_code ec) {
+    if (ec) {
+        closed_ = true;
+        return;
+    }
+    accepted_ = true;
+    if (closed_) {
+        return SendClose();
+    }
+    ws_.text(true);
+    Read();
+    if (pending_) {
+        WriteNext();
+    }
+}
+
+void StateStreamSession::Read() {
+    // Сообщения клиента не нужны, но чтение обрабатывает ping и закрытие соединения
+    ws_.async_read(read_buffer_, beast::bind_front_handler(&StateStreamSession::OnRead, shared_from_this()));
+}
+
+void StateStreamSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    if (ec) {
+        closed_ = true;
+        pending_.reset();
+        return;
+    }
+    read_buffer_.consume(read_buffer_.size());
+    Read();
+}
+
+void StateStreamSession::WriteNext() {
+    auto frame = std::move(pending_);
+    pending_.reset();
+
+    const auto& deltas = frame->state->recent_deltas;
+    const bool has_previous_tick = last_sent_tick_ && !deltas.empty() && deltas.back()->FromTick() == *last_sent_tick_
+                                   && frame->state->LatestChanges();
+    writing_ = has_previous_tick ? frame->GetDelta() : frame->GetFull();
+    last_sent_tick_ = frame->state->tick;
+
+    ws_.async_write(net::buffer(*writing_), beast::bind_front_handler(&StateStreamSession::OnWrite, shared_from_this()));
+}
+
+void StateStreamSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    writing_.reset();
+    if (ec) {
+        closed_ = true;
+        pending_.reset();
+        return;
+    }
+    if (pending_) {
+        WriteNext();
+    }
+}
+
+/* StateBroadcaster */
+
+StateBroadcaster::StateBroadcaster(service::Service& service)
+    : service_{service} {
+    tick_connection_ = service_.DoOnTick([this](std::chrono::milliseconds) {
+        OnTick();
+    });
+}
+
+bool StateBroadcaster::Subscribe(const service::Token& token, const std::shared_ptr<StateStreamSession>& subscriber) {
+    auto session_id = service_.GetPlayerSession(token);
+    if (!session_id) {
+        return false;
+    }
+    {
+        std::lock_guard lock{mutex_};
+        subscribers_[*session_id].push_back({token, subscriber});
+    }
+    // Текущее состояние отправляется сразу, не дожидаясь тика
+    if (auto snapshot = service_.GetSessionSnapshot(*session_id)) {
+        auto frame = std::make_shared<StateFrame>();
+        frame->state = {snapshot, &snapshot->state};
+        subscriber->Push(std::move(frame));
+    }
+    return true;
+}
+
+size_t StateBroadcaster::SubscribersCount() const {
+    std::lock_guard lock{mutex_};
+    size_t count = 0;
+    for (const auto& [session_id, subscribers] : subscribers_) {
+        count += subscribers.size();
+    }
+    return count;
+}
+
+void StateBroadcaster::OnTick() {
+    std::lock_guard lock{mutex_};
+    for (auto it = subscribers_.begin(); it != subscribers_.end();) {
+        auto& [session_id, subscribers] = *it;
+        std::shared_ptr<StateFrame> frame;
+        if (auto snapshot = service_.GetSessionSnapshot(session_id)) {
+            frame = std::make_shared<StateFrame>();
+            frame->state = {snapshot, &snapshot->state};
+            // Изменения считаются до следующей публикации, пока предыдущее состояние ещё доступно
+            snapshot->state.LatestChanges();
+        }
+
+        std::erase_if(subscribers, [this, &frame, &session_id](const Subscriber& subscriber) {
+            auto session = subscriber.session.lock();
+            if (!session) {
+                return true;
+            }
+            // Сигнал tick подаётся тем же потоком, что удаляет игроков, поэтому токен проверяется без гонки
+            if (service_.GetPlayerSession(subscriber.token) != session_id) {
+                session->Close();
+                return true;
+            }
+            if (frame) {
+                session->Push(frame);
+            }
+            return false;
+        });
+        it = subscribers.empty() ? subscribers_.erase(it) : std::next(it);
+    }
+}
+
+}  // namespace http_handler
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "../service/service.h"
+#include "../util/once_cache.h"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace http_handler {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+
+// Состояние сеанса за один тик, общее для всех подписчиков сеанса.
+// Сообщения сериализуются при первой отправке и затем разделяются без копирования
+struct StateFrame {
+    std::shared_ptr<const service::UseCaseGetGameState::GameState> state;
+    // Изменения за последний тик, если state->LatestChanges() их вернул
+    util::OnceCache<std::string> delta;
+    // Полное состояние с номером тика, нужно новым и отставшим подписчикам
+    util::OnceCache<std::string> full;
+
+    std::shared_ptr<const std::string> GetDelta() const;
+    std::shared_ptr<const std::string> GetFull() const;
+};
+
+/*
+ *  WebSocket-соединение, в которое раз в тик отправляется состояние сеанса игрока.
+ *  Если клиент не успевает принимать сообщения, промежуточные кадры отбрасываются:
+ *  после записи отправляется только последний пришедший кадр. Изменения отправляются,
+ *  только если клиент получил предыдущий тик, иначе - полное состояние.
+ */
+class StateStreamSession : public std::enable_shared_from_this<StateStreamSession> {
+public:
+    explicit StateStreamSession(beast::tcp_stream&& stream);
+
+    // Принимает рукопожатие WebSocket и начинает чтение управляющих кадров
+    template <typename Body, typename Allocator>
+    void Accept(http::request<Body, http::basic_fields<Allocator>>&& req) {
+        // Таймауты tcp_stream заменяются таймаутами и ping самого WebSocket
+        beast::get_lowest_layer(ws_).expires_never();
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.async_accept(req, beast::bind_front_handler(&StateStreamSession::OnAccept, shared_from_this()));
+    }
+
+    // Отвечает на запрос обычным HTTP-ответом и закрывает соединение
+    void Reject(http::response<http::string_body>&& response);
+
+    // Можно вызывать из любого потока
+    void Push(std::shared_ptr<const StateFrame> frame);
+
+    // Отправляет кадр закрытия WebSocket, кадры после него не отправляются. Можно вызывать из любого потока
+    void Close();
+
+private:
+    void OnAccept(beast::error_code ec);
+    void SendClose();
+    void Read();
+    void OnRead(beast::error_code ec, std::size_t bytes_read);
+    void WriteNext();
+    void OnWrite(beast::error_code ec, std::size_t bytes_written);
+
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::flat_buffer read_buffer_;
+
+    bool accepted_ = false;
+    bool closed_ = false;
+    // Последний непосланный кадр, более старые отброшены
+    std::shared_ptr<const StateFrame> pending_;
+    // Сообщение, которое пишется сейчас
+    std::shared_ptr<const std::string> writing_;
+    std::optional<uint64_t> last_sent_tick_;
+};
+
+/*
+ *  Рассылает состояние сеансов подписанным WebSocket-соединениям после каждого тика.
+ *  Кадр создаётся один раз на сеанс и раздаётся всем его подписчикам.
+ */
+class StateBroadcaster {
+public:
+    explicit StateBroadcaster(service::Service& service);
+
+    StateBroadcaster(const StateBroadcaster&) = delete;
+    StateBroadcaster& operator=(const StateBroadcaster&) = delete;
+
+    // Подписывает соединение на сеанс игрока. false, если токен не найден.
+    // Когда токен перестаёт действовать (собака ушла на покой), соединение закрывается
+    bool Subscribe(const service::Token& token, const std::shared_ptr<StateStreamSession>& subscriber);
+
+    // Число подписанных соединений, включая закрытые после последнего тика
+    size_t SubscribersCount() const;
+
+private:
+    void OnTick();
+
+    service::Service& service_;
+
+    struct Subscriber {
+        service::Token token;
+        std::weak_ptr<StateStreamSession> session;
+    };
+    using Subscribers = std::vector<Subscriber>;
+    using SessionIdToSubscribers = std::unordered_map<model::GameSession::Id, Subscribers,
+                                                      util::TaggedHasher<model::GameSession::Id>>;
+    mutable std::mutex mutex_;
+    SessionIdToSubscribers subscribers_;
+
+    boost::signals2::scoped_connection tick_connection_;
+};
+
+}  // namespace http_handler
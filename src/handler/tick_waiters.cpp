@@ -0,0 +1,30 @@
+#include "tick_waiters.h"
+
+namespace http_handler {
+
+TickWaiters::TickWaiters(service::Service& service) {
+    // Сигнал tick подаётся после публикации снимка, поэтому разбуженные запросы видят новое состояние
+    tick_connection_ = service.DoOnTick([this](std::chrono::milliseconds) {
+        OnTick();
+    });
+}
+
+size_t TickWaiters::WaitersCount() const {
+    std::lock_guard lock{mutex_};
+    return timers_.size();
+}
+
+void TickWaiters::OnTick() {
+    // Отмена под мьютексом: AsyncWait не обращается к таймеру одновременно с ней
+    std::lock_guard lock{mutex_};
+    for (const auto& weak_timer : timers_) {
+        // Таймеры, сработавшие по времени, уже разрушены, и lock() вернёт nullptr
+        if (auto timer = weak_timer.lock()) {
+            timer->cancel();
+        }
+    }
+    timers_.clear();
+    prune_size_ = MIN_PRUNE_SIZE;
+}
+
+}  // namespace http_handler
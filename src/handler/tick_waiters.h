@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../service/service.h"
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace http_handler {
+
+namespace net = boost::asio;
+
+/*
+ *  Ожидание конца следующего тика без занятия потока.
+ *  Каждый ожидающий получает свой steady_timer, а после тика все таймеры отменяются,
+ *  и обработчики выполняются в executor таймера. Таймер ограничивает и время ожидания,
+ *  если тики прекратились.
+ */
+class TickWaiters {
+public:
+    using Timer = net::steady_timer;
+
+    explicit TickWaiters(service::Service& service);
+
+    TickWaiters(const TickWaiters&) = delete;
+    TickWaiters& operator=(const TickWaiters&) = delete;
+
+    // handler() вызывается один раз: после ближайшего тика или по истечении timeout
+    template <typename Executor, typename Handler>
+    void AsyncWait(const Executor& executor, std::chrono::milliseconds timeout, Handler&& handler) {
+        auto timer = std::make_shared<Timer>(executor, timeout);
+        std::lock_guard lock{mutex_};
+        if (timers_.size() >= prune_size_) {
+            // Таймеры, сработавшие по времени, уже разрушены: убираем их записи, чтобы список не рос без тиков.
+            // Следующая чистка - когда список снова удвоится, поэтому AsyncWait в среднем O(1)
+            std::erase_if(timers_, [](const std::weak_ptr<Timer>& weak_timer) {
+                return weak_timer.expired();
+            });
+            prune_size_ = std::max(MIN_PRUNE_SIZE, timers_.size() * 2);
+        }
+        // Таймер живёт, пока не выполнен его обработчик
+        timer->async_wait([timer, handler = std::forward<Handler>(handler)](const boost::system::error_code&) mutable {
+            handler();
+        });
+        timers_.push_back(std::move(timer));
+    }
+
+    // Число записей о таймерах, включая ещё не убранные сработавшие
+    size_t WaitersCount() const;
+
+    // Меньше этого числа записей сработавшие таймеры не убираются
+    static constexpr size_t MIN_PRUNE_SIZE = 16;
+
+private:
+    void OnTick();
+
+    mutable std::mutex mutex_;
+    std::vector<std::weak_ptr<Timer>> timers_;
+    size_t prune_size_ = MIN_PRUNE_SIZE;
+
+    boost::signals2::scoped_connection tick_connection_;
+};
+
+}  // namespace http_handler
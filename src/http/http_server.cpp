@@ -4,6 +4,7 @@
 
 #include <boost/asio/dispatch.hpp>
 #include <iostream>
+#include <utility>
 
 namespace http_server {
 
@@ -21,11 +22,16 @@ void SessionBase::Run(){
 }
 
 void SessionBase::Read() { 
-    using namespace std::literals;
+    if (reading_ || read_done_ || unsafe_request_ || pending_.size() >= MAX_PIPELINED_REQUESTS) {
+        // Чтение продолжится после отправки очередного ответа
+        return;
+    }
+    reading_ = true;
     // Очищаем запрос от прежнего значения (метод Read может быть вызван несколько раз)
     request_ = {};
-    stream_.expires_after(30s);
-    // Считываем request_ из stream_, используя buffer_ для хранения считанных данных
+    stream_.expires_after(STREAM_TIMEOUT);
+    // Считываем request_ из stream_, используя buffer_ для хранения считанных данных.
+    // Запросы, которые клиент отправил не дожидаясь ответов, уже лежат в buffer_
     http::async_read(stream_, buffer_, request_,
                         // По окончании операции будет вызван метод OnRead
                         beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));        
@@ -33,20 +39,68 @@ void SessionBase::Read() {
 
 void SessionBase::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
     using namespace std::literals;
+    reading_ = false;
     if (ec == http::error::end_of_stream) {
-        // Нормальная ситуация - клиент закрыл соединение
-        return Close();
+        // Нормальная ситуация - клиент закрыл соединение. Ответы на прочитанные запросы ещё отправляются
+        read_done_ = true;
+        return OnDrained();
     }
     if (ec) {
+        read_done_ = true;
         return ReportError(ec, "read"sv);
     }
-    HandleRequest(std::move(request_));
+    if (IsUpgradeRequest(request_)) {
+        // Дальше соединением владеет WebSocket-сессия или поток событий, HTTP-сессия больше не читает из него
+        read_done_ = true;
+        upgrade_request_ = std::move(request_);
+        return OnDrained();
+    }
+    if (!request_.keep_alive()) {
+        // После ответа соединение закроется, следующие запросы не читаем
+        read_done_ = true;
+    }
+    const RequestId id = first_pending_id_ + pending_.size();
+    pending_.emplace_back();
+    if (request_.method() != http::verb::get && request_.method() != http::verb::head) {
+        unsafe_request_ = id;
+    }
+    HandleRequest(std::move(request_), id);
+    Read();
+}
+
+void SessionBase::SetResponse(RequestId id, std::function<void()> write) {
+    if (closed_) {
+        return;
+    }
+    pending_[id - first_pending_id_] = std::move(write);
+    WriteNext();
+    if (unsafe_request_ == id) {
+        // Запрос с побочным эффектом обработан, можно читать следующие
+        unsafe_request_.reset();
+        Read();
+    }
+}
+
+void SessionBase::WriteNext() {
+    // Ответы пишутся по одному: следующий ждёт окончания записи предыдущего
+    if (writing_ || pending_.empty() || !pending_.front()) {
+        return;
+    }
+    writing_ = true;
+    auto write = std::move(pending_.front());
+    pending_.pop_front();
+    ++first_pending_id_;
+    // Срок, взведённый при чтении, мог почти истечь, пока ответ ждал тика
+    stream_.expires_after(STREAM_TIMEOUT);
+    write();
 }
 
 void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
     using namespace std::literals;
+    writing_ = false;
     if (ec) {
-        return ReportError(ec, "write"sv);
+        ReportError(ec, "write"sv);
+        return Close();
     }
 
     if (close) {
@@ -54,13 +108,34 @@ void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std
         return Close();
     }
 
-    // Считываем следующий запрос
+    WriteNext();
+    OnDrained();
+    // В очереди освободилось место: считываем следующий запрос
     Read();
 }
 
+void SessionBase::OnDrained() {
+    if (writing_ || !pending_.empty()) {
+        return;
+    }
+    if (upgrade_request_) {
+        auto request = std::move(*upgrade_request_);
+        upgrade_request_.reset();
+        return HandleUpgrade(std::move(request));
+    }
+    if (read_done_ && !reading_) {
+        Close();
+    }
+}
+
 void SessionBase::Close() {
+    if (std::exchange(closed_, true)) {
+        return;
+    }
+    // Отправки неготовых ответов держат указатель на сессию
+    pending_.clear();
     beast::error_code ec;
-    stream_.socket().shutdown(tcp::socket::shutdown_send);
+    stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
 }
 
 }  // namespace http_server
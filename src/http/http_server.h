@@ -4,16 +4,24 @@
 // boost.beast будет использовать std::string_view вместо boost::string_view
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket/rfc6455.hpp>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <optional>
 
 namespace http_server {
 
 namespace net = boost::asio;
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace websocket = beast::websocket;
 namespace sys = boost::system;
 
 using tcp = net::ip::tcp;
@@ -22,6 +30,13 @@ using namespace std::literals;
 
 void ReportError(beast::error_code ec, std::string_view what);
 
+/*
+ *  HTTP-сессия с конвейерной обработкой (HTTP/1.1 pipelining): следующий запрос читается,
+ *  пока предыдущие обрабатываются и отправляются, но в обработке не больше MAX_PIPELINED_REQUESTS.
+ *  Ответы приходят в любом порядке и из любых потоков, а отправляются в порядке запросов.
+ *  Параллельно обрабатываются только запросы без побочных эффектов.
+ *  Состояние сессии меняется только в executor потока stream_.
+ */
 class SessionBase {
 public:
     // Запрещаем копирование и присваивание объектов SessionBase и его наследников
@@ -31,6 +46,12 @@ public:
 
 protected:
     using HttpRequest = http::request<http::string_body>;
+    // Номер запроса в соединении, по нему ответ встаёт в очередь на своё место
+    using RequestId = std::size_t;
+
+    static constexpr std::size_t MAX_PIPELINED_REQUESTS = 16;
+    // Сколько соединение может ждать чтения или записи
+    static constexpr std::chrono::seconds STREAM_TIMEOUT{30};
 
     explicit SessionBase(tcp::socket&& socket)
         : stream_(std::move(socket)) {
@@ -39,27 +60,41 @@ protected:
     ~SessionBase() = default;
 
     template <typename Body, typename Fields>
-    void Write(http::response<Body, Fields>&& response) {
+    void Write(RequestId id, http::response<Body, Fields>&& response) {
         // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
         auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
 
         auto self = GetSharedThis();
-        http::async_write(stream_, *safe_response,
-                          [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-                              self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                          });
+        // Ответ может быть готов в другом потоке, например в api_strand
+        net::dispatch(stream_.get_executor(), [self, id, safe_response] {
+            self->SetResponse(id, [self, safe_response] {
+                http::async_write(self->stream_, *safe_response,
+                                  [self, safe_response](beast::error_code ec, std::size_t bytes_written) {
+                                      self->OnWrite(safe_response->need_eof(), ec, bytes_written);
+                                  });
+            });
+        });
     }
 
 private:
     void Read();
     void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
 
+    // Запоминает отправку ответа на запрос id и отправляет готовые ответы по порядку
+    void SetResponse(RequestId id, std::function<void()> write);
+    void WriteNext();
     void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
+    // Все ответы отправлены: передать соединение подклассу или закрыть его, если чтение закончено
+    void OnDrained();
 
     void Close();
 
-    // Обработку запроса делегируем подклассу
-    virtual void HandleRequest(HttpRequest&& request) = 0;
+    // Обработку запроса делегируем подклассу. Ответ передаётся в Write с тем же id
+    virtual void HandleRequest(HttpRequest&& request, RequestId id) = 0;
+    // Забирает ли запрос соединение у HTTP-сессии (WebSocket, поток событий). Решает обработчик запросов
+    virtual bool IsUpgradeRequest(const HttpRequest& request) = 0;
+    // Запрос на переход к WebSocket или на поток событий: соединение передаётся подклассу целиком
+    virtual void HandleUpgrade(HttpRequest&& request) = 0;
 
     virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
 
@@ -71,6 +106,21 @@ private:
     beast::flat_buffer buffer_;
     HttpRequest request_;
     boost::posix_time::ptime received_request_time_;
+
+    // Отправки ответов на запросы с номерами first_pending_id_, first_pending_id_ + 1, ...
+    // Пустая функция - ответ ещё не готов
+    std::deque<std::function<void()>> pending_;
+    RequestId first_pending_id_ = 0;
+    bool reading_ = false;
+    bool writing_ = false;
+    // Новых запросов не будет: клиент закрыл соединение, ошибка чтения, Connection: close или Upgrade
+    bool read_done_ = false;
+    bool closed_ = false;
+    // Запрос с побочным эффектом (не GET и не HEAD): следующие запросы не читаются, пока он не обработан,
+    // чтобы они видели его результат (RFC 7230, 6.3.2)
+    std::optional<RequestId> unsafe_request_;
+    // Upgrade выполняется, когда отправлены ответы на все предыдущие запросы
+    std::optional<HttpRequest> upgrade_request_;
 };
 
 
@@ -89,15 +139,23 @@ private:
         return this->shared_from_this();
     }
 
-    void HandleRequest(HttpRequest&& request) override  {
+    void HandleRequest(HttpRequest&& request, RequestId id) override  {
         // Захватываем умный указатель на текущий объект Session в лямбде,
         // чтобы продлить время жизни сессии до вызова лямбды.
         // Используется generic-лямбда функция, способная принять response произвольного типа
-        request_handler_(stream_.socket().remote_endpoint(),std::move(request), [self = this->shared_from_this()](auto&& response) {
-            self->Write(std::move(response));
+        request_handler_(stream_.socket().remote_endpoint(),std::move(request), [self = this->shared_from_this(), id](auto&& response) {
+            self->Write(id, std::move(response));
         });
     }
 
+    bool IsUpgradeRequest(const HttpRequest& request) override {
+        return request_handler_.IsUpgradeRequest(request);
+    }
+
+    void HandleUpgrade(HttpRequest&& request) override {
+        request_handler_.Upgrade(stream_.socket().remote_endpoint(), std::move(stream_), std::move(request));
+    }
+
 private:
     RequestHandler request_handler_;
 };
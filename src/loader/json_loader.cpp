@@ -64,6 +64,22 @@ static void AddOffice(const json::value& json_office, model::Map& map) {
     map.AddOffice(model::Office{model::Office::Id{std::move(id)}, position, offset});
 }
 
+// 0 - все игроки карты попадают в один сеанс
+static size_t GetMaxPlayersPerSession(const json::value& config) {
+    if (!config.as_object().contains(Fields::maxPlayersPerSession)) {
+        return 0;
+    }
+    // to_number отвергает отрицательные, дробные и слишком большие значения
+    std::error_code ec;
+    const size_t limit = config.at(Fields::maxPlayersPerSession).to_number<size_t>(ec);
+    if (ec) {
+        std::ostringstream os;
+        os << "Invalid "sv << Fields::maxPlayersPerSession << ": expected a non-negative integer"sv;
+        throw std::invalid_argument(os.str());
+    }
+    return limit;
+}
+
 json::value LoadJsonData(const std::filesystem::path& json_path) {
     // Загружаем модель игры из файла
     std::error_code ec;
@@ -101,7 +117,10 @@ std::pair<model::Game, extra_data::ExtraData> LoadGame(const std::filesystem::pa
         ? input_json.at(Fields::defaultBagCapacity).as_int64()
         : 3;        
 
+    const size_t max_players_per_session = GetMaxPlayersPerSession(input_json);
+
     game.SetDogRetirementTime(static_cast<size_t>(dog_retirement_time * 1000));
+    game.SetSessionPlayersLimit(max_players_per_session);
 
     game.SetLootGeneratorParams(
         input_json.at(Fields::lootGeneratorConfig).at(LootGeneratorFields::period).as_double(),
@@ -131,7 +150,7 @@ std::pair<model::Game, extra_data::ExtraData> LoadGame(const std::filesystem::pa
 
         
 
-        data.map_id_to_loot_types[map.GetId()] = std::move(loot_types);
+        data.map_id_to_loot_types[map.GetId()] = json::serialize(loot_types);
         for (const auto& json_road : json_map.at(MapFields::roads).as_array()) {
             AddRoad(json_road, map);
         }
@@ -148,70 +167,70 @@ std::pair<model::Game, extra_data::ExtraData> LoadGame(const std::filesystem::pa
 }
 
 
-static void JsonifyMainMapInfo(const model::Map& map, json::object& json_map) {
-    json_map.emplace(json_loader::MapFields::id, *map.GetId());
-    json_map.emplace(json_loader::MapFields::name, map.GetName());
+static void WriteMainMapInfo(util::JsonWriter& writer, const model::Map& map) {
+    writer.Key(json_loader::MapFields::id).Value(*map.GetId());
+    writer.Key(json_loader::MapFields::name).Value(map.GetName());
 }
 
-static void JsonifyRoads(const model::Map& map, json::object& json_map) {
-    json::array json_roads;
+static void WriteRoads(util::JsonWriter& writer, const model::Map& map) {
+    writer.Key(json_loader::MapFields::roads).StartArray();
     for (const auto& road : map.GetRoads()) {
-        json::object json_road;
+        writer.StartObject();
         geom::Point start = road.GetStart();
-        json_road.emplace(json_loader::RoadFields::x0, start.x);
-        json_road.emplace(json_loader::RoadFields::y0, start.y);
+        writer.Key(json_loader::RoadFields::x0).Value(start.x);
+        writer.Key(json_loader::RoadFields::y0).Value(start.y);
         geom::Point end = road.GetEnd();
         if (road.IsHorizontal()) {
-            json_road.emplace(json_loader::RoadFields::x1, end.x);
+            writer.Key(json_loader::RoadFields::x1).Value(end.x);
         } else {
-            json_road.emplace(json_loader::RoadFields::y1, end.y);
+            writer.Key(json_loader::RoadFields::y1).Value(end.y);
         }
-        json_roads.push_back(std::move(json_road));
+        writer.EndObject();
     }
-    json_map.emplace(json_loader::MapFields::roads, json_roads);
+    writer.EndArray();
 }
 
-static void JsonifyBuildings(const model::Map& map, json::object& json_map) {
-    json::array json_offices;
+static void WriteOffices(util::JsonWriter& writer, const model::Map& map) {
+    writer.Key(json_loader::MapFields::offices).StartArray();
     for (const auto& office : map.GetOffices()) {
-        json::object json_office;
-        json_office.emplace(json_loader::OfficeFields::id, *office.GetId());
+        writer.StartObject();
+        writer.Key(json_loader::OfficeFields::id).Value(*office.GetId());
         geom::Point position = office.GetPosition();
-        json_office.emplace(json_loader::OfficeFields::x, position.x);
-        json_office.emplace(json_loader::OfficeFields::y, position.y);
+        writer.Key(json_loader::OfficeFields::x).Value(position.x);
+        writer.Key(json_loader::OfficeFields::y).Value(position.y);
         model::Offset offset = office.GetOffset();
-        json_office.emplace(json_loader::OfficeFields::offsetX, offset.dx);
-        json_office.emplace(json_loader::OfficeFields::offsetY, offset.dy);
-        json_offices.push_back(std::move(json_office));
+        writer.Key(json_loader::OfficeFields::offsetX).Value(offset.dx);
+        writer.Key(json_loader::OfficeFields::offsetY).Value(offset.dy);
+        writer.EndObject();
     }
-    json_map.emplace(json_loader::MapFields::offices, json_offices);
+    writer.EndArray();
 }
 
-static void JsonifyOffices(const model::Map& map, json::object& json_map) {
-    json::array json_buildings;
+static void WriteBuildings(util::JsonWriter& writer, const model::Map& map) {
+    writer.Key(json_loader::MapFields::buildings).StartArray();
     for (const auto& building : map.GetBuildings()) {
-        json::object json_building;
+        writer.StartObject();
         model::Rectangle rect = building.GetBounds();
-        json_building.emplace(json_loader::BuildingFields::x, rect.position.x);
-        json_building.emplace(json_loader::BuildingFields::y, rect.position.y);
-        json_building.emplace(json_loader::BuildingFields::w, rect.size.width);
-        json_building.emplace(json_loader::BuildingFields::h, rect.size.height);
-        json_buildings.push_back(std::move(json_building));
+        writer.Key(json_loader::BuildingFields::x).Value(rect.position.x);
+        writer.Key(json_loader::BuildingFields::y).Value(rect.position.y);
+        writer.Key(json_loader::BuildingFields::w).Value(rect.size.width);
+        writer.Key(json_loader::BuildingFields::h).Value(rect.size.height);
+        writer.EndObject();
     }
-    json_map.emplace(json_loader::MapFields::buildings, json_buildings);
+    writer.EndArray();
 }
 
-json::object MapAsJsonObject(const model::Map& map, const extra_data::ExtraData& extra_data, bool short_info /* = false */) {
-    json::object json_map;
-    JsonifyMainMapInfo(map, json_map);
-    if (short_info) {
-        return json_map;
+void WriteMap(util::JsonWriter& writer, const model::Map& map, const extra_data::ExtraData& extra_data, bool short_info /* = false */) {
+    writer.StartObject();
+    WriteMainMapInfo(writer, map);
+    if (!short_info) {
+        writer.Key(json_loader::Fields::lootTypes).RawValue(extra_data.map_id_to_loot_types.at(map.GetId()));
+        // Порядок полей: дороги, здания, офисы
+        WriteRoads(writer, map);
+        WriteBuildings(writer, map);
+        WriteOffices(writer, map);
     }
-    json_map.emplace(json_loader::Fields::lootTypes, extra_data.map_id_to_loot_types.at(map.GetId()));
-    JsonifyRoads(map, json_map);
-    JsonifyOffices(map, json_map);
-    JsonifyBuildings(map, json_map);
-    return json_map;
+    writer.EndObject();
 }
 
 }  // namespace json_loader
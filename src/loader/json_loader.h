@@ -7,6 +7,7 @@
 #include <map>
 
 #include "../model/model.h"
+#include "../util/json_writer.h"
 #include "extra_data.h"
 
 namespace json_loader {
@@ -21,6 +22,7 @@ struct Fields {
     static constexpr std::string_view lootTypes = "lootTypes"sv;
     static constexpr std::string_view defaultBagCapacity = "defaultBagCapacity"sv;
     static constexpr std::string_view dogRetirementTime = "dogRetirementTime"sv;
+    static constexpr std::string_view maxPlayersPerSession = "maxPlayersPerSession"sv;
 };
 
 struct MapFields {
@@ -74,7 +76,8 @@ struct LootTypesFields {
 
 boost::json::value SetJsonDataError(std::string_view code, std::string_view message);
 
-boost::json::object MapAsJsonObject(const model::Map& map, const extra_data::ExtraData& extra_data, bool short_info = false);
+// Записывает карту в формате ответа API; short_info - только идентификатор и название
+void WriteMap(util::JsonWriter& writer, const model::Map& map, const extra_data::ExtraData& extra_data, bool short_info = false);
 
 
 std::pair<model::Game, extra_data::ExtraData> LoadGame(const std::filesystem::path& json_path);
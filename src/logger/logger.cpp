@@ -50,6 +50,10 @@ void LogStop(const std::exception& ex) {
     info(CreateLogMessage(ServerStopLogData(EXIT_FAILURE, ex.what())),  LogMsg::SERVER_STOP);
 }
 
+void LogStateCache(size_t hits, size_t misses) {
+    info(CreateLogMessage(CacheLogData(hits, misses)), LogMsg::STATE_CACHE);
+}
+
 void LogStop(int code){
     info(CreateLogMessage(ServerStopLogData(code)), LogMsg::SERVER_STOP);    
 }
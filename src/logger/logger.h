@@ -12,6 +12,7 @@
 #include <boost/log/utility/manipulators/add_value.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
 #include <boost/beast/http.hpp>
 
 #include <boost/system.hpp>
@@ -22,6 +23,8 @@
 
 #include <string_view>
 
+#include "../util/util.h"
+
 namespace Logger {
 
 using namespace std::literals;
@@ -39,6 +42,7 @@ struct LogMsg {
     static constexpr std::string_view REQ_RECEIVED  = "request received"sv;
     static constexpr std::string_view RESP_SENT     = "response sent"sv;
     static constexpr std::string_view ERROR         = "error"sv;
+    static constexpr std::string_view STATE_CACHE   = "state cache"sv;
 };
 
 
@@ -65,6 +69,7 @@ void LogStart(const net::ip::address& address, net::ip::port_type port);
 void LogError(beast::error_code ec, std::string_view what);
 void LogStop(int code);
 void LogStop(const std::exception& ex);
+void LogStateCache(size_t hits, size_t misses);
 
 struct ServerAddressLogData {
     ServerAddressLogData(std::string addr, uint32_t prt): 
@@ -75,15 +80,16 @@ struct ServerAddressLogData {
 };
 BOOST_DESCRIBE_STRUCT(ServerAddressLogData, (),(address,port) )
 
+// URI и метод указывают в запрос: запись сериализуется до того, как запрос передаётся дальше
 struct RequestLogData {
-    RequestLogData(std::string ip_addr, std::string url, std::string method):
+    RequestLogData(std::string ip_addr, std::string_view url, std::string_view method):
             ip(ip_addr),
             URI(url),
             method(method) {};
 
     std::string ip;
-    std::string URI;
-    std::string method;
+    std::string_view URI;
+    std::string_view method;
 };
 BOOST_DESCRIBE_STRUCT(RequestLogData, (), (ip,URI,method) )
 
@@ -124,6 +130,15 @@ struct ServerStopLogData {
 };
 BOOST_DESCRIBE_STRUCT(ServerStopLogData, (), (code,exception) )
 
+struct CacheLogData {
+    CacheLogData(uint64_t hits, uint64_t misses):
+        hits(hits), misses(misses) {};
+
+    uint64_t hits;
+    uint64_t misses;
+};
+BOOST_DESCRIBE_STRUCT(CacheLogData, (), (hits,misses) )
+
 template<class RequestHandler>
 class LoggingRequestHandler {
 public:
@@ -135,18 +150,33 @@ public:
          Send&& send) {
         LogRequest(req, endpoint);
         auto start = std::chrono::steady_clock::now();
-        decorated_(endpoint, std::move(req), [send, start, &endpoint](auto&& response){
+        // Ответ может быть отправлен после возврата отсюда, поэтому адрес копируется
+        decorated_(endpoint, std::move(req), [send, start, endpoint](auto&& response){
             LogResponse(response, start, endpoint);
             send(response);
         });
     }
 
+    template <typename Request>
+    bool IsUpgradeRequest(const Request& req) {
+        return decorated_.IsUpgradeRequest(req);
+    }
+
+    template <typename Body, typename Allocator>
+    void Upgrade(const net::ip::tcp::endpoint& endpoint, beast::tcp_stream&& stream,
+                 http::request<Body, http::basic_fields<Allocator>>&& req) {
+        LogRequest(req, endpoint);
+        decorated_.Upgrade(endpoint, std::move(stream), std::move(req));
+    }
+
 private:
     template <typename Body, typename Allocator>
     static void LogRequest(const http::request<Body, http::basic_fields<Allocator>>& req, const net::ip::tcp::endpoint& endpoint) {
+        // WebSocket получает токен игрока параметром authToken, в журнал он не попадает
+        const std::string uri = util::MaskQueryParameter(req.target(), "authToken"sv);
         info(CreateLogMessage(RequestLogData(
                         endpoint.address().to_string(),
-                        req.target(),
+                        uri,
                         req.method_string())),
                         LogMsg::REQ_RECEIVED
                     );
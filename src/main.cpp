@@ -2,6 +2,7 @@
 
 #include <boost/program_options.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <boost/asio/strand.hpp>
 
@@ -36,6 +37,7 @@ struct Args {
     bool has_state_file_path;
     size_t save_state_period;
     bool has_save_state_period;    
+    unsigned tick_threads = 1;
 }; 
 
 // Запускает функцию fn на num_threads потоках, включая текущий
@@ -68,7 +70,8 @@ void RunWorkers(unsigned num_threads, const Fn& fn) {
         ("www-root,w", po::value(&args.www_root)->value_name("dir"s), "set static files root")
         ("randomize-spawn-points", "spawn dogs at random positions")
         ("state-file,s", po::value(&args.state_file_path)->value_name("file"s), "set game state file path")
-        ("save-state-period,p", po::value<size_t>(&args.save_state_period)->value_name("milliseconds"s), "set game state save period");
+        ("save-state-period,p", po::value<size_t>(&args.save_state_period)->value_name("milliseconds"s), "set game state save period")
+        ("tick-threads", po::value(&args.tick_threads)->value_name("count"s), "set number of threads ticking game sessions");
 
     // variables_map хранит значения опций после разбора
     po::variables_map vm;
@@ -125,6 +128,7 @@ int main(int argc, const char* argv[]) {
         // 1. Загружаем карту из файла и построить модель игры
         auto [game, extra_data] = json_loader::LoadGame(args.config_file);
         game.SetRandomSpawn(args.randomize_spawn_points);
+        game.SetTickThreads(args.tick_threads);
 
         // 1.1 Создаем БД postgres
         postgres::DatabasePostgres db{/*std::thread::hardware_concurrency()*/1,GetDbURLFromEnv()};
@@ -161,27 +165,31 @@ int main(int argc, const char* argv[]) {
         // strand для выполнения запросов к API
         auto api_strand = net::make_strand(ioc);
 
-        // Настраиваем вызов метода Service::Tick каждые 50 миллисекунд внутри strand
+        // Поток симуляции: тики и команды игроков выполняются в нём и не ждут HTTP-запросов
+        net::io_context simulation_ioc(1);
+        auto simulation_work = net::make_work_guard(simulation_ioc);
+
+        // Настраиваем вызов метода Service::Tick с периодом tick_period в потоке симуляции
         if (args.is_tick_period){
             service.OnTimeTicker();
-            auto ticker = std::make_shared<Ticker>(api_strand, std::chrono::milliseconds{args.tick_period},
+            auto ticker = std::make_shared<Ticker>(net::make_strand(simulation_ioc), std::chrono::milliseconds{args.tick_period},
                 [&service](std::chrono::milliseconds delta) { service.Tick(delta); }
             );
             ticker->Start();
         }
 
         fs::path static_files_root{args.www_root};
+        // Рассылка состояния игры по WebSocket после каждого тика
+        http_handler::StateBroadcaster state_broadcaster(service);
+        // Ожидающие следующего тика запросы /game/state?wait=1
+        http_handler::TickWaiters tick_waiters(service);
+        // События тиков для наблюдателей: /api/v1/game/events
+        http_handler::EventBroadcaster event_broadcaster(service);
         // Создаём обработчик запросов в куче, управляемый shared_ptr
-        auto handler = std::make_shared<http_handler::RequestHandler>(api_handler, api_strand, std::move(static_files_root));
+        auto handler = std::make_shared<http_handler::RequestHandler>(api_handler, state_broadcaster, event_broadcaster,
+                                                                      tick_waiters, api_strand, std::move(static_files_root));
         // Оборачиваем его в логирующий декоратор
-        Logger::LoggingRequestHandler logging_handler(
-            [handler](auto&& endpoint, auto&& req, auto&& send) {
-                // Обрабатываем запрос
-                (*handler)(
-                    std::forward<decltype(req)>(req),
-                    std::forward<decltype(send)>(send));
-                }
-        );
+        Logger::LoggingRequestHandler logging_handler(http_handler::SharedRequestHandler{handler});
 
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         const auto address = net::ip::make_address("0.0.0.0");
@@ -191,12 +199,23 @@ int main(int argc, const char* argv[]) {
         // Эта надпись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы
         Logger::LogStart(address, port);
 
-        // 6. Запускаем обработку асинхронных операций
+        // 6. Запускаем поток симуляции и обработку асинхронных операций
+        std::thread simulation_thread([&simulation_ioc] {
+            simulation_ioc.run();
+        });
         RunWorkers(std::max(1u, num_threads), [&ioc] {
             ioc.run();
         });
 
-        // 7. Сериализуем данные
+        // 7. Останавливаем симуляцию после HTTP-потоков: присоединение к игре ждёт ближайшего тика
+        simulation_work.reset();
+        simulation_ioc.stop();
+        simulation_thread.join();
+
+        const auto& state_cache = api_handler.GetStateCacheStats();
+        Logger::LogStateCache(state_cache.hits, state_cache.misses);
+
+        // 8. Сериализуем данные
         serializator.Serialize();        
     } catch (const std::exception& ex) {
         Logger::LogStop(ex);
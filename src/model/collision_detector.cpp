@@ -1,5 +1,12 @@
 #include "collision_detector.h"
 #include <cassert>
+#include <cmath>
+#include <tuple>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLLISION_DETECTOR_X86
+#include <immintrin.h>
+#endif
 
 namespace collision_detector {
 
@@ -23,40 +30,279 @@ CollectionResult TryCollectPoint(geom::Vec2D a, geom::Vec2D b, geom::Vec2D c) {
 }
 
 
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
-    std::vector<GatheringEvent> detected_events;
-
-    static auto eq_pt = [](geom::Vec2D p1, geom::Vec2D p2) {
-        return p1.x == p2.x && p1.y == p2.y;
-    };
-
-    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
-        for (size_t g = 0; g < provider.GatherersCount(); ++g) {
-            Item item = provider.GetItem(i);
-            Gatherer gatherer = provider.GetGatherer(g);
-
-            if (eq_pt(gatherer.start_pos, gatherer.end_pos)) {
-                continue;
-            }
-            
-            auto collect_result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
-
-            if (collect_result.IsCollected(gatherer.width + item.width)) {
-                GatheringEvent evt{.item_id = i,
-                                   .gatherer_id = g,
-                                   .sq_distance = collect_result.sq_distance,
-                                   .time = collect_result.proj_ratio};
-                detected_events.push_back(evt);
-            }
+namespace {
+
+// Запас на погрешность вычисления квадрата расстояния в TryCollectPoint
+constexpr double GRID_MARGIN = 1e-6;
+
+bool IsSamePoint(geom::Vec2D p1, geom::Vec2D p2) {
+    return p1.x == p2.x && p1.y == p2.y;
+}
+
+size_t BatchItemId(const ItemsBatch& items, size_t k) {
+    return items.ids ? items.ids[k] : k;
+}
+
+// Ядра возвращают индекс первого необработанного предмета, хвост досчитывается скалярно.
+// Арифметика повторяет TryCollectPoint операция в операцию, поэтому результаты совпадают.
+size_t CollectBatchScalar(const Gatherer& gatherer, size_t gatherer_id, const ItemsBatch& items,
+                          size_t from, std::vector<GatheringEvent>& events) {
+    for (size_t k = from; k < items.size; ++k) {
+        auto collect_result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, {items.x[k], items.y[k]});
+        if (collect_result.IsCollected(gatherer.width + items.width[k])) {
+            events.push_back({.item_id = BatchItemId(items, k),
+                              .gatherer_id = gatherer_id,
+                              .sq_distance = collect_result.sq_distance,
+                              .time = collect_result.proj_ratio});
         }
     }
+    return items.size;
+}
+
+#ifdef COLLISION_DETECTOR_X86
+
+template <size_t Lanes>
+void PushLanes(int mask, const double (&sq_distance)[Lanes], const double (&proj_ratio)[Lanes],
+               const ItemsBatch& items, size_t k, size_t gatherer_id, std::vector<GatheringEvent>& events) {
+    for (size_t lane = 0; lane < Lanes; ++lane) {
+        if (mask & (1 << lane)) {
+            events.push_back({.item_id = BatchItemId(items, k + lane),
+                              .gatherer_id = gatherer_id,
+                              .sq_distance = sq_distance[lane],
+                              .time = proj_ratio[lane]});
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+size_t CollectBatchSse2(const Gatherer& gatherer, size_t gatherer_id, const ItemsBatch& items,
+                        std::vector<GatheringEvent>& events) {
+    const double v_x = gatherer.end_pos.x - gatherer.start_pos.x;
+    const double v_y = gatherer.end_pos.y - gatherer.start_pos.y;
+    const __m128d a_x = _mm_set1_pd(gatherer.start_pos.x);
+    const __m128d a_y = _mm_set1_pd(gatherer.start_pos.y);
+    const __m128d vv_x = _mm_set1_pd(v_x);
+    const __m128d vv_y = _mm_set1_pd(v_y);
+    const __m128d v_len2 = _mm_set1_pd(v_x * v_x + v_y * v_y);
+    const __m128d g_width = _mm_set1_pd(gatherer.width);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.);
+
+    size_t k = 0;
+    for (; k + 2 <= items.size; k += 2) {
+        const __m128d u_x = _mm_sub_pd(_mm_loadu_pd(items.x + k), a_x);
+        const __m128d u_y = _mm_sub_pd(_mm_loadu_pd(items.y + k), a_y);
+        const __m128d u_dot_v = _mm_add_pd(_mm_mul_pd(u_x, vv_x), _mm_mul_pd(u_y, vv_y));
+        const __m128d u_len2 = _mm_add_pd(_mm_mul_pd(u_x, u_x), _mm_mul_pd(u_y, u_y));
+        const __m128d proj_ratio = _mm_div_pd(u_dot_v, v_len2);
+        const __m128d sq_distance = _mm_sub_pd(u_len2, _mm_div_pd(_mm_mul_pd(u_dot_v, u_dot_v), v_len2));
+        const __m128d radius = _mm_add_pd(g_width, _mm_loadu_pd(items.width + k));
+
+        const __m128d collected = _mm_and_pd(
+            _mm_and_pd(_mm_cmpge_pd(proj_ratio, zero), _mm_cmple_pd(proj_ratio, one)),
+            _mm_cmple_pd(sq_distance, _mm_mul_pd(radius, radius)));
+        if (const int mask = _mm_movemask_pd(collected)) {
+            double sq[2], proj[2];
+            _mm_storeu_pd(sq, sq_distance);
+            _mm_storeu_pd(proj, proj_ratio);
+            PushLanes(mask, sq, proj, items, k, gatherer_id, events);
+        }
+    }
+    return k;
+}
+
+__attribute__((target("avx2")))
+size_t CollectBatchAvx2(const Gatherer& gatherer, size_t gatherer_id, const ItemsBatch& items,
+                        std::vector<GatheringEvent>& events) {
+    const double v_x = gatherer.end_pos.x - gatherer.start_pos.x;
+    const double v_y = gatherer.end_pos.y - gatherer.start_pos.y;
+    const __m256d a_x = _mm256_set1_pd(gatherer.start_pos.x);
+    const __m256d a_y = _mm256_set1_pd(gatherer.start_pos.y);
+    const __m256d vv_x = _mm256_set1_pd(v_x);
+    const __m256d vv_y = _mm256_set1_pd(v_y);
+    const __m256d v_len2 = _mm256_set1_pd(v_x * v_x + v_y * v_y);
+    const __m256d g_width = _mm256_set1_pd(gatherer.width);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.);
+
+    size_t k = 0;
+    for (; k + 4 <= items.size; k += 4) {
+        const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(items.x + k), a_x);
+        const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(items.y + k), a_y);
+        const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(u_x, vv_x), _mm256_mul_pd(u_y, vv_y));
+        const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+        const __m256d proj_ratio = _mm256_div_pd(u_dot_v, v_len2);
+        const __m256d sq_distance = _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len2));
+        const __m256d radius = _mm256_add_pd(g_width, _mm256_loadu_pd(items.width + k));
+
+        const __m256d collected = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(proj_ratio, zero, _CMP_GE_OQ), _mm256_cmp_pd(proj_ratio, one, _CMP_LE_OQ)),
+            _mm256_cmp_pd(sq_distance, _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+        if (const int mask = _mm256_movemask_pd(collected)) {
+            double sq[4], proj[4];
+            _mm256_storeu_pd(sq, sq_distance);
+            _mm256_storeu_pd(proj, proj_ratio);
+            PushLanes(mask, sq, proj, items, k, gatherer_id, events);
+        }
+    }
+    return k;
+}
+
+#endif  // COLLISION_DETECTOR_X86
+
+}  // namespace
+
+void CollectBatch(const Gatherer& gatherer, size_t gatherer_id, const ItemsBatch& items,
+                  std::vector<GatheringEvent>& events) {
+    if (IsSamePoint(gatherer.start_pos, gatherer.end_pos)) {
+        return;
+    }
+    size_t processed = 0;
+#ifdef COLLISION_DETECTOR_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    static const bool has_sse2 = __builtin_cpu_supports("sse2");
+    if (has_avx2) {
+        processed = CollectBatchAvx2(gatherer, gatherer_id, items, events);
+    } else if (has_sse2) {
+        processed = CollectBatchSse2(gatherer, gatherer_id, items, events);
+    }
+#endif
+    CollectBatchScalar(gatherer, gatherer_id, items, processed, events);
+}
+
+namespace detail {
 
-    std::sort(detected_events.begin(), detected_events.end(),
+void TryGather(const Item& item, size_t item_id, const Gatherer& gatherer, size_t gatherer_id,
+               std::vector<GatheringEvent>& events) {
+    if (IsSamePoint(gatherer.start_pos, gatherer.end_pos)) {
+        return;
+    }
+    auto collect_result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
+    if (collect_result.IsCollected(gatherer.width + item.width)) {
+        events.push_back({.item_id = item_id,
+                          .gatherer_id = gatherer_id,
+                          .sq_distance = collect_result.sq_distance,
+                          .time = collect_result.proj_ratio});
+    }
+}
+
+void SortByTime(std::vector<GatheringEvent>& events) {
+    // События с одинаковым временем упорядочены по предмету и собирателю,
+    // поэтому порядок не зависит от того, как события были найдены
+    std::sort(events.begin(), events.end(),
               [](const GatheringEvent& e_l, const GatheringEvent& e_r) {
-                  return e_l.time < e_r.time;
+                  return std::tie(e_l.time, e_l.item_id, e_l.gatherer_id)
+                       < std::tie(e_r.time, e_r.item_id, e_r.gatherer_id);
               });
+}
+
+/* ItemGrid */
+
+void ItemGrid::Build() {
+    const size_t count = xs_.size();
+    max_item_width_ = 0.;
+    min_x_ = max_x_ = xs_.front();
+    min_y_ = max_y_ = ys_.front();
+    for (size_t i = 0; i < count; ++i) {
+        min_x_ = std::min(min_x_, xs_[i]);
+        min_y_ = std::min(min_y_, ys_[i]);
+        max_x_ = std::max(max_x_, xs_[i]);
+        max_y_ = std::max(max_y_, ys_[i]);
+        max_item_width_ = std::max(max_item_width_, widths_[i]);
+    }
+
+    const double width = max_x_ - min_x_;
+    const double height = max_y_ - min_y_;
+    const double n = static_cast<double>(count);
+    // Ячеек не больше 3n + 1 при любой форме облака предметов
+    cell_size_ = std::max({std::sqrt(width * height / n), width / n, height / n});
+    if (cell_size_ <= 0.) {
+        cell_size_ = 1.;
+    }
+    cols_ = static_cast<size_t>(width / cell_size_) + 1;
+    rows_ = static_cast<size_t>(height / cell_size_) + 1;
+
+    cell_begin_.assign(cols_ * rows_ + 1, 0);
+    item_cell_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        item_cell_[i] = CellIndex(Col(xs_[i]), Row(ys_[i]));
+        ++cell_begin_[item_cell_[i] + 1];
+    }
+    for (size_t c = 1; c < cell_begin_.size(); ++c) {
+        cell_begin_[c] += cell_begin_[c - 1];
+    }
+
+    sorted_xs_.resize(count);
+    sorted_ys_.resize(count);
+    sorted_widths_.resize(count);
+    ids_.resize(count);
+    cell_fill_.assign(cell_begin_.begin(), cell_begin_.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t k = cell_fill_[item_cell_[i]]++;
+        sorted_xs_[k] = xs_[i];
+        sorted_ys_[k] = ys_[i];
+        sorted_widths_[k] = widths_[i];
+        ids_[k] = i;
+    }
+    xs_.swap(sorted_xs_);
+    ys_.swap(sorted_ys_);
+    widths_.swap(sorted_widths_);
+}
+
+void ItemGrid::Collect(const Gatherer& gatherer, size_t gatherer_id, std::vector<GatheringEvent>& events) const {
+    const double reach = gatherer.width + max_item_width_ + GRID_MARGIN;
+    const double x0 = std::min(gatherer.start_pos.x, gatherer.end_pos.x) - reach;
+    const double x1 = std::max(gatherer.start_pos.x, gatherer.end_pos.x) + reach;
+    const double y0 = std::min(gatherer.start_pos.y, gatherer.end_pos.y) - reach;
+    const double y1 = std::max(gatherer.start_pos.y, gatherer.end_pos.y) + reach;
+    if (x1 < min_x_ || y1 < min_y_ || x0 > max_x_ || y0 > max_y_) {
+        return;
+    }
+    const size_t col_begin = Col(x0);
+    const size_t col_end = Col(x1);
+    const size_t row_begin = Row(y0);
+    const size_t row_end = Row(y1);
+    for (size_t row = row_begin; row <= row_end; ++row) {
+        const size_t begin = cell_begin_[CellIndex(col_begin, row)];
+        const size_t end = cell_begin_[CellIndex(col_end, row) + 1];
+        if (begin == end) {
+            continue;
+        }
+        CollectBatch(gatherer, gatherer_id,
+                     ItemsBatch{.x = xs_.data() + begin,
+                                .y = ys_.data() + begin,
+                                .width = widths_.data() + begin,
+                                .ids = ids_.data() + begin,
+                                .size = end - begin},
+                     events);
+    }
+}
+
+// Координата приводится к номеру ячейки с прижатием к границам сетки
+static size_t ToCell(double value, double origin, double cell_size, size_t count) {
+    const double pos = (value - origin) / cell_size;
+    if (pos <= 0.) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>(pos), count - 1);
+}
+
+size_t ItemGrid::Col(double x) const {
+    return ToCell(x, min_x_, cell_size_, cols_);
+}
+
+size_t ItemGrid::Row(double y) const {
+    return ToCell(y, min_y_, cell_size_, rows_);
+}
+
+}  // namespace detail
+
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
+    return FindGatherEvents<ItemGathererProvider>(provider);
+}
 
-    return detected_events;
+std::vector<GatheringEvent> FindGatherEventsBruteForce(const ItemGathererProvider& provider) {
+    return FindGatherEventsBruteForce<ItemGathererProvider>(provider);
 }
 
 
@@ -3,6 +3,8 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <concepts>
+#include <span>
 #include <vector>
 
 namespace collision_detector {
@@ -52,12 +54,12 @@ struct GatheringEvent {
     double time;
 };
 
-class VectorItemGathererProvider : public ItemGathererProvider {
+class VectorItemGathererProvider final : public ItemGathererProvider {
 public:
-    VectorItemGathererProvider(const std::vector<collision_detector::Item> & items,
-                               const std::vector<collision_detector::Gatherer> & gatherers)
-        : items_(items)
-        , gatherers_(gatherers) {
+    VectorItemGathererProvider(std::vector<collision_detector::Item> items,
+                               std::vector<collision_detector::Gatherer> gatherers)
+        : items_(std::move(items))
+        , gatherers_(std::move(gatherers)) {
     }
 
     
@@ -75,12 +77,222 @@ public:
     }
 
 private:
-    const std::vector<collision_detector::Item> items_;
-    const std::vector<collision_detector::Gatherer> gatherers_;
+    std::vector<collision_detector::Item> items_;
+    std::vector<collision_detector::Gatherer> gatherers_;
+};
+
+// Поставщик предметов и собирателей, известный на этапе компиляции.
+// ItemGathererProvider тоже ему удовлетворяет, но платит виртуальным вызовом за каждый элемент.
+template <typename Provider>
+concept ItemGathererSource = requires(const Provider& provider, size_t idx) {
+    { provider.ItemsCount() } -> std::convertible_to<size_t>;
+    { provider.GetItem(idx) } -> std::convertible_to<Item>;
+    { provider.GatherersCount() } -> std::convertible_to<size_t>;
+    { provider.GetGatherer(idx) } -> std::convertible_to<Gatherer>;
+};
+
+// Поставщик поверх чужих массивов: ничего не копирует и не имеет виртуальных методов.
+// Массивы должны жить дольше поставщика.
+class SpanItemGathererProvider {
+public:
+    SpanItemGathererProvider(std::span<const Item> items, std::span<const Gatherer> gatherers) noexcept
+        : items_(items)
+        , gatherers_(gatherers) {
+    }
+
+    size_t ItemsCount() const noexcept {
+        return items_.size();
+    }
+    const Item& GetItem(size_t idx) const noexcept {
+        return items_[idx];
+    }
+    size_t GatherersCount() const noexcept {
+        return gatherers_.size();
+    }
+    const Gatherer& GetGatherer(size_t idx) const noexcept {
+        return gatherers_[idx];
+    }
+
+private:
+    std::span<const Item> items_;
+    std::span<const Gatherer> gatherers_;
+};
+
+// Предметы в виде структуры массивов (SoA).
+// ids - идентификаторы предметов для событий; если не заданы, используется индекс в пакете
+struct ItemsBatch {
+    const double* x = nullptr;
+    const double* y = nullptr;
+    const double* width = nullptr;
+    const size_t* ids = nullptr;
+    size_t size = 0;
+};
+
+// Проверяет отрезок собирателя сразу против всего пакета предметов и добавляет
+// найденные события в events (без сортировки). Даёт те же события, что и TryCollectPoint.
+// Пакет обрабатывается векторными ядрами AVX2/SSE2, если процессор их поддерживает.
+// Неподвижный собиратель ничего не собирает.
+void CollectBatch(const Gatherer& gatherer, size_t gatherer_id, const ItemsBatch& items,
+                  std::vector<GatheringEvent>& events);
+
+namespace detail {
+
+// Если пар предмет-собиратель меньше, сетка не окупает своё построение
+constexpr size_t BRUTE_FORCE_PAIRS_LIMIT = 256;
+
+// Проверяет одну пару и при сборе добавляет событие
+void TryGather(const Item& item, size_t item_id, const Gatherer& gatherer, size_t gatherer_id,
+               std::vector<GatheringEvent>& events);
+
+// Сортирует события по времени, при равном времени - по предмету и собирателю.
+// Результат не зависит от того, в каком порядке события были найдены.
+void SortByTime(std::vector<GatheringEvent>& events);
+
+/*
+ *  Равномерная сетка над предметами.
+ *  Размер ячейки подбирается так, чтобы ячеек было порядка количества предметов.
+ *  Предметы хранятся структурой массивов, упорядоченной по ячейкам (counting sort),
+ *  поэтому ячейки одной строки сетки лежат в памяти подряд и проверяются одним пакетом.
+ */
+class ItemGrid {
+public:
+    ItemGrid() = default;
+
+    template <ItemGathererSource Provider>
+    explicit ItemGrid(const Provider& provider) {
+        Assign(provider);
+    }
+
+    // Перестраивает сетку по предметам поставщика, сохраняя ёмкость буферов
+    template <ItemGathererSource Provider>
+    void Assign(const Provider& provider) {
+        const size_t count = provider.ItemsCount();
+        xs_.clear();
+        ys_.clear();
+        widths_.clear();
+        for (size_t i = 0; i < count; ++i) {
+            const Item& item = provider.GetItem(i);
+            xs_.push_back(item.position.x);
+            ys_.push_back(item.position.y);
+            widths_.push_back(item.width);
+        }
+        Build();
+    }
+
+    // Проверяет собирателя против предметов из ячеек, покрытых его отрезком,
+    // расширенным на максимальный радиус сбора
+    void Collect(const Gatherer& gatherer, size_t gatherer_id, std::vector<GatheringEvent>& events) const;
+
+private:
+    // Раскладывает заполненные xs_, ys_, widths_ по ячейкам
+    void Build();
+
+    size_t Col(double x) const;
+    size_t Row(double y) const;
+    size_t CellIndex(size_t col, size_t row) const {
+        return row * cols_ + col;
+    }
+
+    double min_x_ = 0.;
+    double min_y_ = 0.;
+    double max_x_ = 0.;
+    double max_y_ = 0.;
+    double max_item_width_ = 0.;
+    double cell_size_ = 1.;
+    size_t cols_ = 1;
+    size_t rows_ = 1;
+    std::vector<size_t> cell_begin_;
+
+    std::vector<double> xs_;
+    std::vector<double> ys_;
+    std::vector<double> widths_;
+    std::vector<size_t> ids_;
+
+    // Промежуточные буферы построения
+    std::vector<size_t> item_cell_;
+    std::vector<size_t> cell_fill_;
+    std::vector<double> sorted_xs_;
+    std::vector<double> sorted_ys_;
+    std::vector<double> sorted_widths_;
 };
 
-// Эту функцию вам нужно будет реализовать в соответствующем задании.
-// При проверке ваших тестов она не нужна - функция будет линковаться снаружи.
+// Проверяет все пары предмет-собиратель
+template <ItemGathererSource Provider>
+void CollectBruteForce(const Provider& provider, std::vector<GatheringEvent>& events) {
+    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+        const Item& item = provider.GetItem(i);
+        for (size_t g = 0; g < provider.GatherersCount(); ++g) {
+            TryGather(item, i, provider.GetGatherer(g), g, events);
+        }
+    }
+}
+
+// Добавляет найденные события сбора в events и сортирует его по времени
+template <ItemGathererSource Provider>
+void FindGatherEventsInto(const Provider& provider, ItemGrid& grid, std::vector<GatheringEvent>& events) {
+    const size_t items_count = provider.ItemsCount();
+    const size_t gatherers_count = provider.GatherersCount();
+    if (items_count == 0 || gatherers_count == 0) {
+        return;
+    }
+    if (items_count * gatherers_count <= BRUTE_FORCE_PAIRS_LIMIT) {
+        CollectBruteForce(provider, events);
+    } else {
+        grid.Assign(provider);
+        for (size_t g = 0; g < gatherers_count; ++g) {
+            grid.Collect(provider.GetGatherer(g), g, events);
+        }
+    }
+    SortByTime(events);
+}
+
+}  // namespace detail
+
+// Полный перебор всех пар предмет-собиратель.
+template <ItemGathererSource Provider>
+std::vector<GatheringEvent> FindGatherEventsBruteForce(const Provider& provider) {
+    std::vector<GatheringEvent> detected_events;
+    detail::CollectBruteForce(provider, detected_events);
+    detail::SortByTime(detected_events);
+    return detected_events;
+}
+
+// Находит все события сбора, отсортированные по времени.
+// Предметы раскладываются по ячейкам равномерной сетки, и каждый собиратель
+// проверяется только с предметами из ячеек, которые покрывает его отрезок.
+// Для поставщиков без виртуальных методов вызовы подставляются на этапе компиляции.
+template <ItemGathererSource Provider>
+std::vector<GatheringEvent> FindGatherEvents(const Provider& provider) {
+    detail::ItemGrid grid;
+    std::vector<GatheringEvent> detected_events;
+    detail::FindGatherEventsInto(provider, grid, detected_events);
+    return detected_events;
+}
+
+/*
+ *  Поиск событий сбора с переиспользуемыми буферами.
+ *  Сетка и список событий сохраняют ёмкость между вызовами,
+ *  поэтому после прогрева повторный поиск не выделяет память.
+ */
+class GatherEventsFinder {
+public:
+    // Возвращённая ссылка действительна до следующего вызова Find
+    template <ItemGathererSource Provider>
+    const std::vector<GatheringEvent>& Find(const Provider& provider) {
+        events_.clear();
+        detail::FindGatherEventsInto(provider, grid_, events_);
+        return events_;
+    }
+
+private:
+    detail::ItemGrid grid_;
+    std::vector<GatheringEvent> events_;
+};
+
+// Версии для виртуального интерфейса
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
 
+// Результат совпадает с FindGatherEvents, используется для сравнения в тестах и бенчмарках.
+std::vector<GatheringEvent> FindGatherEventsBruteForce(const ItemGathererProvider& provider);
+
 }  // namespace collision_detector
\ No newline at end of file
@@ -1,13 +1,45 @@
 #include "model.h"
 
 #include <stdexcept>
+#include <numeric>
 #include <random>
+#include <tuple>
+#include <utility>
 
 namespace model {
 using namespace std::literals;
 
+/* RoadIndex */
+
+void RoadIndex::Add(const Road& road, size_t road_index) {
+    if (road.IsHorizontal()) {
+        Insert(horizontal_, {road.GetStart().y, road.GetRangeX().first, road.GetRangeX().second, road_index});
+    } else {
+        Insert(vertical_, {road.GetStart().x, road.GetRangeY().first, road.GetRangeY().second, road_index});
+    }
+}
+
+void RoadIndex::Insert(Segments& segments, Segment segment) {
+    auto pos = std::upper_bound(segments.begin(), segments.end(), segment,
+        [](const Segment& lhs, const Segment& rhs) {
+            return std::tie(lhs.line, lhs.from) < std::tie(rhs.line, rhs.from);
+        });
+    segments.insert(pos, segment);
+}
+
 /* Map */
 
+void Map::AddRoad(const Road& road) {
+    const size_t index = roads_.size();
+    roads_.emplace_back(road);
+    try {
+        road_index_.Add(road, index);
+    } catch (...) {
+        roads_.pop_back();
+        throw;
+    }
+}
+
 void Map::AddOffice(Office office) {
     if (warehouse_id_to_index_.contains(office.GetId())) {
         throw std::invalid_argument("Duplicate warehouse");
@@ -82,12 +114,40 @@ const Map* Game::FindMap(const Map::Id& id) const noexcept {
 }
 
 void Game::OnTick(std::chrono::milliseconds time_delta){
+    tick_sessions_.clear();
+    for (auto& session : sessions_) {
+        tick_sessions_.push_back(&session);
+    }
+    // Порядок сигналов не должен зависеть от порядка создания сеансов
+    std::sort(tick_sessions_.begin(), tick_sessions_.end(), [](const GameSession* lhs, const GameSession* rhs) {
+        return *lhs->GetId() < *rhs->GetId();
+    });
+
     // Отправляем время по всем сессиям
-    for (auto& [map, session] : map_id_to_session_) {
-        session.OnTick(time_delta);
+    if (tick_pool_) {
+        tick_pool_->ParallelFor(tick_sessions_.size(), [this, time_delta](size_t index) {
+            tick_sessions_[index]->Advance(time_delta);
+        });
+    } else {
+        for (GameSession* session : tick_sessions_) {
+            session->Advance(time_delta);
+        }
+    }
+    for (GameSession* session : tick_sessions_) {
+        session->RetireDogs();
     }
 }
 
+void Game::ClearEvents() noexcept {
+    for (GameSession& session : sessions_) {
+        session.ClearEvents();
+    }
+}
+
+void Game::SetTickThreads(unsigned threads) {
+    tick_pool_ = threads > 1 ? std::make_unique<util::WorkStealingPool>(threads) : nullptr;
+}
+
 
 /* Dog */
 
@@ -126,12 +186,18 @@ const Dog::Direction Dog::GetDirection() const noexcept{
 }
 
 void Dog::SetSpeed(double speed) {
-    speed_.x = (direction_ == Direction::NORTH || direction_ == Direction::SOUTH )
+    speed_ = SpeedVector(direction_, speed);
+}
+
+geom::Vec2D Dog::SpeedVector(Direction dir, double speed) noexcept {
+    geom::Vec2D result;
+    result.x = (dir == Direction::NORTH || dir == Direction::SOUTH )
                 ? 0.
-                : (direction_ == Direction::EAST ? speed : -speed);
-    speed_.y = (direction_ == Direction::WEST || direction_ == Direction::EAST )
+                : (dir == Direction::EAST ? speed : -speed);
+    result.y = (dir == Direction::WEST || dir == Direction::EAST )
                 ? 0.
-                : (direction_ == Direction::SOUTH ? speed : -speed);
+                : (dir == Direction::SOUTH ? speed : -speed);
+    return result;
 }
 
 
@@ -180,12 +246,15 @@ void Dog::AddLoot(LootObject loot){
 }
 
 void Dog::DropBag(){
-    scores_ += std::accumulate(bag_.begin(),bag_.end(),0,
-        [this](size_t lhs, const LootObject& rhs) {
+    scores_ += BagWorth(bag_);
+    bag_.clear();
+}
+
+size_t Dog::BagWorth(const Bag& bag) noexcept {
+    return std::accumulate(bag.begin(), bag.end(), size_t{0},
+        [](size_t lhs, const LootObject& rhs) {
             return lhs + rhs.GetWorth();
         });
-
-    bag_.clear();
 }
 
 size_t Dog::GetScores() const noexcept{
@@ -196,6 +265,113 @@ void Dog::SetScores(size_t scores){
     scores_ += scores;
 }
 
+/* DogSlotMap */
+
+DogHandle DogSlotMap::Insert(const Dog& dog) {
+    const auto pos = static_cast<uint32_t>(ids_.size());
+    uint32_t slot = free_slot_;
+    if (slot == NO_SLOT) {
+        slot = static_cast<uint32_t>(slots_.size());
+        slots_.push_back({pos, 0});
+    } else {
+        free_slot_ = slots_[slot].pos;
+        slots_[slot].pos = pos;
+    }
+
+    try {
+        ids_.push_back(dog.GetId());
+        coords_.push_back(dog.GetCoordinates());
+        prev_coords_.push_back(dog.GetPrevCoordinates());
+        speeds_.push_back(dog.GetSpeed());
+        directions_.push_back(dog.GetDirection());
+        holding_times_.push_back(dog.GetHoldingPeriod());
+        times_in_game_.push_back(dog.GetTimeInGame());
+        cold_.push_back({dog.GetName(), dog.GetBag(), dog.GetScores()});
+        pos_to_slot_.push_back(slot);
+    } catch (...) {
+        // Откатываем массивы к общей длине и возвращаем слот в список свободных
+        auto truncate = [pos](auto& values) {
+            values.erase(values.begin() + std::min<size_t>(pos, values.size()), values.end());
+        };
+        truncate(ids_);
+        truncate(coords_);
+        truncate(prev_coords_);
+        truncate(speeds_);
+        truncate(directions_);
+        truncate(holding_times_);
+        truncate(times_in_game_);
+        truncate(cold_);
+        truncate(pos_to_slot_);
+        slots_[slot].pos = free_slot_;
+        free_slot_ = slot;
+        throw;
+    }
+    return {slot, slots_[slot].generation};
+}
+
+void DogSlotMap::Erase(DogHandle handle) {
+    const size_t pos = PositionOf(handle);
+    const size_t last = ids_.size() - 1;
+    if (pos != last) {
+        ids_[pos] = ids_[last];
+        coords_[pos] = coords_[last];
+        prev_coords_[pos] = prev_coords_[last];
+        speeds_[pos] = speeds_[last];
+        directions_[pos] = directions_[last];
+        holding_times_[pos] = holding_times_[last];
+        times_in_game_[pos] = times_in_game_[last];
+        cold_[pos] = std::move(cold_[last]);
+        pos_to_slot_[pos] = pos_to_slot_[last];
+        slots_[pos_to_slot_[pos]].pos = static_cast<uint32_t>(pos);
+    }
+    ids_.pop_back();
+    coords_.pop_back();
+    prev_coords_.pop_back();
+    speeds_.pop_back();
+    directions_.pop_back();
+    holding_times_.pop_back();
+    times_in_game_.pop_back();
+    cold_.pop_back();
+    pos_to_slot_.pop_back();
+
+    Slot& slot = slots_[handle.slot];
+    ++slot.generation;
+    slot.pos = free_slot_;
+    free_slot_ = handle.slot;
+}
+
+bool DogSlotMap::Contains(DogHandle handle) const noexcept {
+    return handle.slot < slots_.size()
+        && slots_[handle.slot].generation == handle.generation
+        && slots_[handle.slot].pos < pos_to_slot_.size()
+        && pos_to_slot_[slots_[handle.slot].pos] == handle.slot;
+}
+
+size_t DogSlotMap::PositionOf(DogHandle handle) const {
+    if (!Contains(handle)) {
+        throw std::out_of_range("Dog not found");
+    }
+    return slots_[handle.slot].pos;
+}
+
+DogHandle DogSlotMap::HandleAt(size_t pos) const noexcept {
+    const uint32_t slot = pos_to_slot_[pos];
+    return {slot, slots_[slot].generation};
+}
+
+/* ConstDogRef */
+
+Dog ConstDogRef::ToDog() const {
+    // Как и при восстановлении из файла: предыдущие координаты задаются конструктором
+    Dog dog{GetId(), GetName(), GetPrevCoordinates(), GetDirection(), GetSpeed()};
+    dog.SetCoordinates(GetCoordinates());
+    dog.SetScores(GetScores());
+    for (const auto& loot : GetBag()) {
+        dog.AddLoot(loot);
+    }
+    return dog;
+}
+
 /* LootObject */
 
 LootObject::LootObject(Id id, size_t type, size_t worth) noexcept
@@ -220,19 +396,35 @@ size_t LootObject::GetWorth() const noexcept {
 /* Game */
 
 GameSession* Game::GetGameSessionByMapId(const Map::Id& id) {
-    if (auto session = map_id_to_session_.find(id); session != map_id_to_session_.end()) {
-        return &session->second;
+    auto map = map_id_to_index_.find(id);
+    if (map == map_id_to_index_.end()) {
+        return nullptr;
     }
-    if (auto map = map_id_to_index_.find(id); map != map_id_to_index_.end()) {
-        GameSession session(
-            &maps_[map->second],
-            last_session_index_++,
-            random_spawn_,
-            loot_generator_params_,
-            dog_retirement_time_,
-            do_on_retire_
-        );
-        return &(map_id_to_session_.emplace(id, std::move(session)).first->second);
+    GameSession* best = nullptr;
+    if (auto sessions = map_id_to_sessions_.find(id); sessions != map_id_to_sessions_.end()) {
+        for (GameSession* session : sessions->second) {
+            const size_t players = session->GetDogs().Size();
+            if (session_players_limit_ != 0 && players >= session_players_limit_) {
+                continue;
+            }
+            if (!best || players < best->GetDogs().Size()) {
+                best = session;
+            }
+        }
+    }
+    if (!best) {
+        best = &CreateGameSession(maps_[map->second], last_session_index_);
+    }
+    return best;
+}
+
+GameSession* Game::FindGameSession(const Map::Id& id, GameSession::Id session_id) noexcept {
+    if (auto sessions = map_id_to_sessions_.find(id); sessions != map_id_to_sessions_.end()) {
+        for (GameSession* session : sessions->second) {
+            if (session->GetId() == session_id) {
+                return session;
+            }
+        }
     }
     return nullptr;
 }
@@ -240,23 +432,44 @@ GameSession* Game::GetGameSessionByMapId(const Map::Id& id) {
 GameSession* Game::AddGameSession(const Map::Id& id, size_t index,
         size_t dog_start_id, size_t loot_object_start_id) {
     if (auto map = map_id_to_index_.find(id); map != map_id_to_index_.end()) {
-        GameSession session(
-            &maps_[map->second],
-            index,
-            random_spawn_,
-            loot_generator_params_,
-            dog_retirement_time_,
-            do_on_retire_,
-            dog_start_id,
-            loot_object_start_id
-        );
-        return &(map_id_to_session_.emplace(id, std::move(session)).first->second);
+        if (FindGameSession(id, GameSession::Id{index})) {
+            throw std::runtime_error("Game session already exists");
+        }
+        return &CreateGameSession(maps_[map->second], index, dog_start_id, loot_object_start_id);
     } else {
         throw std::runtime_error("Map not found");
     }
     return nullptr;
 }
 
+GameSession& Game::CreateGameSession(const Map& map, size_t index,
+        size_t dog_start_id, size_t loot_object_start_id) {
+    auto& sessions = map_id_to_sessions_[map.GetId()];
+    sessions.reserve(sessions.size() + 1);
+    GameSession& session = sessions_.emplace_back(
+        &map,
+        index,
+        random_spawn_,
+        loot_generator_params_,
+        dog_retirement_time_,
+        do_on_retire_,
+        dog_start_id,
+        loot_object_start_id
+    );
+    sessions.push_back(&session);
+    // Номера новых сеансов не должны совпадать с номерами восстановленных
+    last_session_index_ = std::max(last_session_index_, index + 1);
+    return session;
+}
+
+void Game::SetSessionPlayersLimit(size_t limit) {
+    session_players_limit_ = limit;
+}
+
+const Game::Sessions& Game::GetGameSessions() const noexcept {
+    return sessions_;
+}
+
 void Game::SetRandomSpawn(bool isRandom){
     random_spawn_ = isRandom;
 }
@@ -272,8 +485,8 @@ void Game::SetDogRetirementTime(size_t dog_retirement_time) {
 
 Game::GameState Game::GetGameState() const {
     GameState state;
-    state.reserve(map_id_to_session_.size());
-    for (const auto& [id, session] : map_id_to_session_) {
+    state.reserve(sessions_.size());
+    for (const auto& session : sessions_) {
         state.emplace_back(session.GetDynamicStateContent());
     }
     return state;
@@ -298,64 +511,91 @@ GameSession::GameSession(const Map* map, size_t index,
             , objects_spawned_{loot_object_start_id}
             , dogs_join_{dog_start_id}
             , road_count_(map->GetRoads().size()) {
-
-    for (const auto& road : map_->GetRoads()) {
-        for (int x = road.GetRangeX().first; x <= road.GetRangeX().second; ++x) {
-            for (int y = road.GetRangeY().first; y <= road.GetRangeY().second; ++y) {
-                coords_to_roads_[x].emplace(y, &road);
-            }
-        }
-    }
 }
 
 const GameSession::Id& GameSession::GetId() const noexcept {
     return id_;
 }
 
-const GameSession::LootObjectIdToObject& GameSession::GetLootObjects() const {
-    return loot_obj_id_to_obj_;
+const GameSession::LootObjects& GameSession::GetLootObjects() const {
+    return loot_objects_;
 }
 
 geom::Vec2D GameSession::GetLootCoordsById(LootObject::Id id) const {
-    return loot_obj_id_to_coords_.at(id);
+    return loot_objects_[loot_obj_id_to_index_.at(id)].position;
 }
 
 
-GameSession::DogPtr GameSession::NewDog(std::string name){
+DogHandle GameSession::NewDog(std::string name){
     size_t index = dogs_join_++;
-    return AddDog({Dog::Id{index}, std::move(name),GetDogSpawnPoint()});    
+    SessionEvent event{.type = SessionEvent::Type::JOIN, .dog = Dog::Id{index}, .name = name};
+    DogHandle handle = AddDog({Dog::Id{index}, std::move(name),GetDogSpawnPoint()});
+    events_.push_back(std::move(event));
+    return handle;
 }
 
-GameSession::DogPtr GameSession::AddDog(Dog dog) {
-    auto dog_it = dogs_.emplace(dogs_.end(), std::make_unique<Dog>(std::move(dog)));
-    auto [it, inserted] = dog_id_to_dog_.emplace((*dog_it)->GetId(), dog_it);
+DogHandle GameSession::AddDog(const Dog& dog) {
+    auto [it, inserted] = dog_id_to_handle_.emplace(dog.GetId(), DogHandle{});
     if (!inserted) {
         throw std::runtime_error("Dog already exists");
     }
-    return *dog_it;
+    try {
+        it->second = dogs_.Insert(dog);
+    } catch (...) {
+        dog_id_to_handle_.erase(it);
+        throw;
+    }
+    return it->second;
 }
 
-GameSession::DogPtr GameSession::GetDogById(Dog::Id id) const {
-    if (auto it = dog_id_to_dog_.find(id); it != dog_id_to_dog_.end()) {
-        return *(it->second);
+void GameSession::RemoveDog(DogHandle handle) {
+    const Dog::Id dog_id = GetDog(handle).GetId();
+    std::erase_if(events_, [dog_id](const SessionEvent& event) {
+        return event.type == SessionEvent::Type::JOIN && event.dog == dog_id;
+    });
+    dog_id_to_handle_.erase(dog_id);
+    dogs_.Erase(handle);
+}
+
+std::optional<DogHandle> GameSession::GetDogById(Dog::Id id) const {
+    if (auto it = dog_id_to_handle_.find(id); it != dog_id_to_handle_.end()) {
+        return it->second;
     }
-    return nullptr;
+    return std::nullopt;
 }
 
-const std::list<GameSession::DogPtr>& GameSession::GetDogs() const {
+DogRef GameSession::GetDog(DogHandle handle) {
+    return dogs_.At(dogs_.PositionOf(handle));
+}
+
+ConstDogRef GameSession::GetDog(DogHandle handle) const {
+    return dogs_.At(dogs_.PositionOf(handle));
+}
+
+const DogSlotMap& GameSession::GetDogs() const {
     return dogs_;
 }
 
 void GameSession::AddLoot(LootObject obj, geom::Vec2D coords) {
-    if (loot_obj_id_to_obj_.contains(obj.GetId())) {
+    InsertLootObject(std::move(obj), coords);
+}
+
+void GameSession::InsertLootObject(LootObject obj, geom::Vec2D coords) {
+    const size_t index = loot_objects_.size();
+    auto [it, inserted] = loot_obj_id_to_index_.emplace(obj.GetId(), index);
+    if (!inserted) {
         throw std::runtime_error("Loot object already exists");
     }
-    loot_obj_id_to_coords_.emplace(obj.GetId(), coords);
-    loot_obj_id_to_obj_.emplace(obj.GetId(), obj);
+    try {
+        loot_objects_.push_back({std::move(obj), coords});
+    } catch (...) {
+        loot_obj_id_to_index_.erase(it);
+        throw;
+    }
 }
 
 geom::Vec2D GameSession::GetRandomPointOnRandomRoad() const{
-    static std::random_device random_device_;
+    static thread_local std::random_device random_device_;
     // Выбираем рандомную дорогу
     std::uniform_int_distribution<size_t> road_d(0, road_count_ - 1);
     size_t road_index = road_d(random_device_);
@@ -382,23 +622,19 @@ geom::Vec2D GameSession::GetDogSpawnPoint(){
 
 void GameSession::SpawnLootObject() {
     size_t index = objects_spawned_++;
-    static std::random_device rd;
+    static thread_local std::random_device rd;
     size_t type = std::uniform_int_distribution<size_t>{0, map_->CountLootWorth() - 1}(rd);
-    auto [it, inserted] = loot_obj_id_to_obj_.emplace(
-        LootObject::Id{index},
-        LootObject(LootObject::Id{index}, type, map_->GetLootWorth(type))
+    InsertLootObject(
+        LootObject(LootObject::Id{index}, type, map_->GetLootWorth(type)),
+        GetRandomPointOnRandomRoad()
     );
-    if (!inserted) {
-        throw std::runtime_error("Loot object already exists");
-    }
-    loot_obj_id_to_coords_[it->first] = GetRandomPointOnRandomRoad();
 }
 
 void GameSession::SpawnLoot(std::chrono::milliseconds tick) {
     int objects_count = loot_generator_.Generate(
         tick,
-        loot_obj_id_to_obj_.size(),
-        dogs_.size()
+        loot_objects_.size(),
+        dogs_.Size() - dogs_to_retire_.size()
     );
     while (objects_count--) {
         SpawnLootObject();
@@ -406,26 +642,41 @@ void GameSession::SpawnLoot(std::chrono::milliseconds tick) {
 }
 
 void GameSession::OnTick(std::chrono::milliseconds tick){
-    for (auto dog : dogs_) {
-        Move(*dog, tick);
-        if (dog->IsStoped() && dog->GetHoldingPeriod() >= dog_retirement_time_) {
-            dogs_to_retire_.push_back(dog->GetId());
-        }        
-    }
+    Advance(tick);
     RetireDogs();
+}
+
+void GameSession::Advance(std::chrono::milliseconds tick){
+    for (DogRef dog : dogs_.All()) {
+        Move(dog, tick);
+        if (dog.IsStoped() && dog.GetHoldingPeriod() >= dog_retirement_time_) {
+            dogs_to_retire_.push_back(dog.GetHandle());
+        }
+    }
     HandleCollisions();
-    SpawnLoot(tick);    
+    SpawnLoot(tick);
 }
 
 void GameSession::RetireDogs() {
-    for (Dog::Id dog_id : dogs_to_retire_) {
-        do_on_retire_(dog_id, map_->GetId());
-        auto nh = dog_id_to_dog_.extract(dog_id);
-        dogs_.erase(nh.mapped());
+    for (DogHandle handle : dogs_to_retire_) {
+        const Dog::Id dog_id = GetDog(handle).GetId();
+        events_.push_back({.type = SessionEvent::Type::RETIRE, .dog = dog_id});
+        do_on_retire_(dog_id, *this);
+        dog_id_to_handle_.erase(dog_id);
+        dogs_.Erase(handle);
     }
     dogs_to_retire_.clear();
 }
 
+void GameSession::TakeEvents(Events& out) noexcept {
+    out.clear();
+    out.swap(events_);
+}
+
+void GameSession::ClearEvents() noexcept {
+    events_.clear();
+}
+
 static geom::Dimension RoundRoadCoord(double coord) {
     static constexpr double mid = 0.5;
     return (coord - std::floor(coord) < mid) ? std::floor(coord) : std::ceil(coord);
@@ -453,78 +704,87 @@ static double PossibleMoveDist(const geom::Vec2D& from, const Road& road, Dog::D
 void GameSession::HandleCollisions() {
     using namespace collision_detector;
 
-    std::vector<collision_detector::Gatherer> gatherers;
-    std::vector<collision_detector::Item> items;
+    auto& scratch = collision_scratch_;
+    scratch.gatherers.clear();
+    scratch.items.clear();
+    scratch.item_loot_ids.clear();
 
     // add gatherer
-    std::unordered_map<size_t, DogPtr> gatherer_id_to_dog;
-    for (const auto & dog : dogs_) {
-        gatherers.emplace_back(collision_detector::Gatherer{dog->GetPrevCoordinates(), dog->GetCoordinates(), Dog::COLLISION_RADIUS});
-        gatherer_id_to_dog[gatherers.size() - 1] = dog;
+    for (ConstDogRef dog : std::as_const(dogs_).All()) {
+        scratch.gatherers.push_back(Gatherer{dog.GetPrevCoordinates(), dog.GetCoordinates(), Dog::COLLISION_RADIUS});
+    }
+    // Собаки, уходящие на покой, стоят на месте и ничего не собирают
+    for (DogHandle handle : dogs_to_retire_) {
+        Gatherer& gatherer = scratch.gatherers[dogs_.PositionOf(handle)];
+        gatherer.start_pos = gatherer.end_pos;
     }
 
-
-    // add item
-    enum class ItemType {
-        LOOT,
-        OFFICE
-     };
-    std::unordered_map<size_t, ItemType> item_id_to_type;
-    std::unordered_map<size_t, LootObject::Id> item_id_to_loot_id;  
-
-    for (auto& [_, loot_obj] : loot_obj_id_to_obj_) {
-        items.emplace_back(collision_detector::Item{loot_obj_id_to_coords_.at(loot_obj.GetId()), LootObject::COLLISION_RADIUS});
-        auto id = items.size() - 1;
-        item_id_to_type[id] = ItemType::LOOT;
-        item_id_to_loot_id.emplace(id, loot_obj.GetId());
+    // add item: loot objects go first, offices follow them
+    // Подбор трофея меняет позиции в loot_objects_, поэтому события сопоставляются по идентификаторам
+    for (const auto& [obj, position] : loot_objects_) {
+        scratch.items.push_back(Item{position, LootObject::COLLISION_RADIUS});
+        scratch.item_loot_ids.push_back(obj.GetId());
     }
     for (const auto& office : map_->GetOffices()) {
         geom::Vec2D pos(
             static_cast<double>(office.GetPosition().x),
             static_cast<double>(office.GetPosition().y)
         );
-        items.emplace_back(collision_detector::Item{pos, Office::COLLISION_RADIUS});
-        auto id = items.size() - 1;        
-        item_id_to_type[id] = ItemType::OFFICE;
+        scratch.items.push_back(Item{pos, Office::COLLISION_RADIUS});
     }
 
-    // create provider
-    VectorItemGathererProvider g_provider{std::move(items),std::move(gatherers)}; 
-
-    auto events = FindGatherEvents(g_provider);
+    const auto& events = scratch.finder.Find(SpanItemGathererProvider{scratch.items, scratch.gatherers});
     for (const GatheringEvent& event : events) {
-        if (item_id_to_type.at(event.item_id) == ItemType::LOOT) {
-            HandleLootCollection(gatherer_id_to_dog.at(event.gatherer_id), item_id_to_loot_id.at(event.item_id));
-        } else if (item_id_to_type.at(event.item_id) == ItemType::OFFICE) {
-            HandleLootDrop(gatherer_id_to_dog.at(event.gatherer_id));
+        // Обработка событий не добавляет и не удаляет собак, поэтому позиции не меняются
+        DogRef dog = dogs_.At(event.gatherer_id);
+        if (event.item_id < scratch.item_loot_ids.size()) {
+            HandleLootCollection(dog, scratch.item_loot_ids[event.item_id]);
+        } else {
+            HandleLootDrop(dog);
         }
     }
-
 }
 
-void GameSession::HandleLootCollection(DogPtr dog, LootObject::Id id) {
-    if (dog->LootCountInBag() >= map_->GetDogBagCapacity()) {
+void GameSession::HandleLootCollection(DogRef dog, LootObject::Id id) {
+    if (dog.LootCountInBag() >= map_->GetDogBagCapacity()) {
         return;
     }
     if (auto loot_obj = ExtractLootObject(id)) {
-        dog->AddLoot(std::move(*loot_obj));
+        events_.push_back({.type = SessionEvent::Type::LOOT_COLLECTED, .dog = dog.GetId(),
+                           .loot = id, .loot_type = loot_obj->GetType()});
+        dog.AddLoot(std::move(*loot_obj));
     }
 }
 
-void GameSession::HandleLootDrop(DogPtr dog) {
-    dog->DropBag();
+void GameSession::HandleLootDrop(DogRef dog) {
+    if (dog.LootCountInBag() == 0) {
+        return;
+    }
+    const size_t items = dog.LootCountInBag();
+    const size_t scores_before = dog.GetScores();
+    dog.DropBag();
+    events_.push_back({.type = SessionEvent::Type::LOOT_DROPPED, .dog = dog.GetId(),
+                       .items = items, .score_change = dog.GetScores() - scores_before});
 }
 
 std::optional<LootObject> GameSession::ExtractLootObject(LootObject::Id id) {
-    if (loot_obj_id_to_obj_.contains(id)) {
-        auto nh = loot_obj_id_to_obj_.extract(id);
-        loot_obj_id_to_coords_.erase(id);
-        return std::move(nh.mapped());        
+    auto it = loot_obj_id_to_index_.find(id);
+    if (it == loot_obj_id_to_index_.end()) {
+        return std::nullopt;
     }
-    return std::nullopt;
+    const size_t index = it->second;
+    loot_obj_id_to_index_.erase(it);
+
+    LootObject obj = std::move(loot_objects_[index].object);
+    if (index + 1 != loot_objects_.size()) {
+        loot_objects_[index] = std::move(loot_objects_.back());
+        loot_obj_id_to_index_[loot_objects_[index].object.GetId()] = index;
+    }
+    loot_objects_.pop_back();
+    return obj;
 }
 
-void GameSession::Move(Dog& dog, std::chrono::milliseconds time_delta) const {
+void GameSession::Move(DogRef dog, std::chrono::milliseconds time_delta) const {
     size_t tick = time_delta.count();
     dog.AddTick(tick);
     if (dog.IsStoped()) {
@@ -533,15 +793,14 @@ void GameSession::Move(Dog& dog, std::chrono::milliseconds time_delta) const {
     geom::Vec2D dp{dog.GetSpeed().x * tick / 1000,dog.GetSpeed().y * tick / 1000};
     const auto direction = dog.GetDirection();
     auto road_coords = RoundRoadCoords(dog.GetCoordinates());
-    auto roads = coords_to_roads_.at(road_coords.x).equal_range(road_coords.y);
-    
+
     double best_dist = 0;
-    for (auto it = roads.first; it != roads.second; ++it) {
-        double dist = PossibleMoveDist(dog.GetCoordinates(), *it->second, direction);
+    map_->ForEachRoadAt(road_coords, [&](const Road& road) {
+        double dist = PossibleMoveDist(dog.GetCoordinates(), road, direction);
         if (std::abs(dist) > std::abs(best_dist)) {
             best_dist = dist;
         }
-    }
+    });
     bool border = (direction == Dog::Direction::WEST || direction == Dog::Direction::EAST)
         ? std::abs(best_dist) <= std::abs(dp.x)
         : std::abs(best_dist) <= std::abs(dp.y);
@@ -561,15 +820,14 @@ void GameSession::Move(Dog& dog, std::chrono::milliseconds time_delta) const {
 
 GameSession::DynamicStateContent GameSession::GetDynamicStateContent() const {
     DynamicStateContent::LootObjects loot_objects;
-    loot_objects.reserve(loot_obj_id_to_obj_.size());
-    for (const auto& [_, obj] : loot_obj_id_to_obj_) {
-        loot_objects.emplace_back(obj, loot_obj_id_to_coords_.at(obj.GetId()));
+    loot_objects.reserve(loot_objects_.size());
+    for (const auto& [obj, position] : loot_objects_) {
+        loot_objects.emplace_back(obj, position);
     }
     std::list<Dog> dog_objects;
-    for (const auto& dog : dogs_) {
-        if (dog)
-            dog_objects.emplace_back(*dog);
-    }   
+    for (ConstDogRef dog : dogs_.All()) {
+        dog_objects.emplace_back(dog.ToDog());
+    }
     return DynamicStateContent{
         .map_id = map_->GetId(),
         .session_id = id_,
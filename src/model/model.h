@@ -1,16 +1,22 @@
 #pragma once
 #include <string>
 #include <unordered_map>
+#include <deque>
 #include <vector>
 #include <list>
 #include <memory>
 #include <chrono>
 #include <optional>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <ranges>
 
 #include "geom.h"
 #include "loot_generator.h"
 #include "collision_detector.h"
 #include "../util/tagged.h"
+#include "../util/thread_pool.h"
 
 #include <boost/signals2.hpp>
 
@@ -112,6 +118,49 @@ private:
     Rect abs_dimentions_;
 };
 
+// Индекс дорог карты: находит дороги, проходящие через целочисленную точку.
+// Горизонтальные дороги упорядочены по (y, x_min), вертикальные - по (x, y_min),
+// поиск выполняется двоичным поиском без хеширования. Хранятся индексы дорог,
+// поэтому индекс остаётся верным при копировании и перемещении карты.
+class RoadIndex {
+public:
+    void Add(const Road& road, size_t road_index);
+
+    // Вызывает fn(road_index) для каждой дороги, покрывающей точку point
+    template <typename Fn>
+    void ForEachRoadAt(geom::Point point, Fn&& fn) const {
+        ForEachOnLine(horizontal_, point.y, point.x, fn);
+        ForEachOnLine(vertical_, point.x, point.y, fn);
+    }
+
+private:
+    struct Segment {
+        geom::Coord line;  // y горизонтальной или x вертикальной дороги
+        geom::Coord from;
+        geom::Coord to;
+        size_t road_index;
+    };
+    using Segments = std::vector<Segment>;
+
+    static void Insert(Segments& segments, Segment segment);
+
+    template <typename Fn>
+    static void ForEachOnLine(const Segments& segments, geom::Coord line, geom::Coord pos, Fn& fn) {
+        auto it = std::lower_bound(segments.begin(), segments.end(), line,
+            [](const Segment& segment, geom::Coord value) {
+                return segment.line < value;
+            });
+        for (; it != segments.end() && it->line == line && it->from <= pos; ++it) {
+            if (pos <= it->to) {
+                fn(it->road_index);
+            }
+        }
+    }
+
+    Segments horizontal_;
+    Segments vertical_;
+};
+
 class Building {
 public:
     explicit Building(Rectangle bounds) noexcept
@@ -187,8 +236,14 @@ public:
         return offices_;
     }
 
-    void AddRoad(const Road& road) {
-        roads_.emplace_back(road);
+    void AddRoad(const Road& road);
+
+    // Вызывает fn(const Road&) для каждой дороги, проходящей через точку point
+    template <typename Fn>
+    void ForEachRoadAt(geom::Point point, Fn&& fn) const {
+        road_index_.ForEachRoadAt(point, [this, &fn](size_t index) {
+            fn(roads_[index]);
+        });
     }
 
     void AddBuilding(const Building& building) {
@@ -213,6 +268,7 @@ private:
     Id id_;
     std::string name_;
     Roads roads_;
+    RoadIndex road_index_;
     Buildings buildings_;
 
     double dogSpeed_;
@@ -295,6 +351,11 @@ public:
     size_t GetScores() const noexcept;
     void   SetScores(size_t score);
 
+    // Вектор скорости для направления dir и модуля скорости speed
+    static geom::Vec2D SpeedVector(Direction dir, double speed) noexcept;
+    // Суммарная ценность трофеев в рюкзаке
+    static size_t BagWorth(const Bag& bag) noexcept;
+
 private:
     Id id_{0u};
     std::string name_;    
@@ -307,15 +368,277 @@ private:
 
     size_t scores_ = 0;
     size_t holding_time_ = 0;
-    size_t time_in_game_ = 0;    
+    size_t time_in_game_ = 0;
+};
+
+// Дескриптор собаки в игровом сеансе: номер слота и его поколение.
+// Слот удалённой собаки переиспользуется с новым поколением,
+// поэтому старый дескриптор становится недействительным, а не указывает на чужую собаку.
+struct DogHandle {
+    uint32_t slot = 0;
+    uint32_t generation = 0;
+
+    auto operator<=>(const DogHandle&) const = default;
+};
+
+class DogSlotMap;
+
+// Ссылка на собаку в DogSlotMap на чтение.
+// Действительна до ближайшего добавления или удаления собак.
+class ConstDogRef {
+public:
+    ConstDogRef(const DogSlotMap& dogs, size_t pos) noexcept
+        : dogs_{&dogs}
+        , pos_{pos} {
+    }
+
+    DogHandle GetHandle() const noexcept;
+    size_t GetPosition() const noexcept {
+        return pos_;
+    }
+
+    const Dog::Id& GetId() const noexcept;
+    const std::string& GetName() const noexcept;
+    const geom::Vec2D& GetCoordinates() const noexcept;
+    const geom::Vec2D& GetPrevCoordinates() const noexcept;
+    const geom::Vec2D& GetSpeed() const noexcept;
+    Dog::Direction GetDirection() const noexcept;
+    bool IsStoped() const noexcept;
+    size_t GetHoldingPeriod() const noexcept;
+    size_t GetTimeInGame() const noexcept;
+    const Dog::Bag& GetBag() const noexcept;
+    size_t LootCountInBag() const noexcept;
+    size_t GetScores() const noexcept;
+
+    // Копия собаки в виде самостоятельного объекта (для сериализации)
+    Dog ToDog() const;
+
+protected:
+    const DogSlotMap* dogs_;
+    size_t pos_;
+};
+
+// Ссылка на собаку в DogSlotMap с теми же операциями, что и у Dog
+class DogRef : public ConstDogRef {
+public:
+    DogRef(DogSlotMap& dogs, size_t pos) noexcept
+        : ConstDogRef{dogs, pos} {
+    }
+
+    void SetSpeed(double speed) const noexcept;
+    void SetDirection(Dog::Direction dir) const noexcept;
+    void SetCoordinates(geom::Vec2D coord) const noexcept;
+    void Stop() const noexcept;
+    void AddTick(size_t tick) const noexcept;
+    void AddLoot(LootObject loot) const;
+    void DropBag() const noexcept;
+    void SetScores(size_t scores) const noexcept;
+
+private:
+    DogSlotMap& Dogs() const noexcept {
+        return const_cast<DogSlotMap&>(*dogs_);
+    }
+};
+
+/*
+ *  Хранилище собак игрового сеанса (slot map).
+ *  Собаки лежат плотно, структурой массивов: поля, нужные на каждом тике (координаты,
+ *  скорость, направление, время простоя), - в отдельных непрерывных массивах,
+ *  редко используемые (имя, рюкзак, очки) - отдельно от них.
+ *  Удалённую собаку заменяет последняя, а таблица слотов сохраняет дескрипторы действительными.
+ */
+class DogSlotMap {
+public:
+    DogHandle Insert(const Dog& dog);
+    // Дескриптор должен быть действительным
+    void Erase(DogHandle handle);
+
+    bool Contains(DogHandle handle) const noexcept;
+    // Позиция собаки в плотных массивах. Бросает std::out_of_range для недействительного дескриптора
+    size_t PositionOf(DogHandle handle) const;
+    DogHandle HandleAt(size_t pos) const noexcept;
+
+    size_t Size() const noexcept {
+        return ids_.size();
+    }
+
+    bool Empty() const noexcept {
+        return ids_.empty();
+    }
+
+    DogRef At(size_t pos) noexcept {
+        return {*this, pos};
+    }
+
+    ConstDogRef At(size_t pos) const noexcept {
+        return {*this, pos};
+    }
+
+    // Все собаки в порядке хранения
+    auto All() noexcept {
+        return std::views::iota(size_t{0}, Size()) | std::views::transform([this](size_t pos) {
+            return At(pos);
+        });
+    }
+
+    auto All() const noexcept {
+        return std::views::iota(size_t{0}, Size()) | std::views::transform([this](size_t pos) {
+            return At(pos);
+        });
+    }
+
+private:
+    friend class ConstDogRef;
+    friend class DogRef;
+
+    static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+    // Для занятого слота pos - позиция собаки, для свободного - следующий свободный слот
+    struct Slot {
+        uint32_t pos;
+        uint32_t generation;
+    };
+
+    struct ColdData {
+        std::string name;
+        Dog::Bag bag;
+        size_t scores;
+    };
+
+    std::vector<Slot> slots_;
+    uint32_t free_slot_ = NO_SLOT;
+    std::vector<uint32_t> pos_to_slot_;
+
+    std::vector<Dog::Id> ids_;
+    std::vector<geom::Vec2D> coords_;
+    std::vector<geom::Vec2D> prev_coords_;
+    std::vector<geom::Vec2D> speeds_;
+    std::vector<Dog::Direction> directions_;
+    std::vector<size_t> holding_times_;
+    std::vector<size_t> times_in_game_;
+
+    std::vector<ColdData> cold_;
 };
 
-using DogRetire = boost::signals2::signal<void(model::Dog::Id dog, const model::Map::Id& map)>;
+inline DogHandle ConstDogRef::GetHandle() const noexcept {
+    return dogs_->HandleAt(pos_);
+}
+
+inline const Dog::Id& ConstDogRef::GetId() const noexcept {
+    return dogs_->ids_[pos_];
+}
+
+inline const std::string& ConstDogRef::GetName() const noexcept {
+    return dogs_->cold_[pos_].name;
+}
+
+inline const geom::Vec2D& ConstDogRef::GetCoordinates() const noexcept {
+    return dogs_->coords_[pos_];
+}
+
+inline const geom::Vec2D& ConstDogRef::GetPrevCoordinates() const noexcept {
+    return dogs_->prev_coords_[pos_];
+}
+
+inline const geom::Vec2D& ConstDogRef::GetSpeed() const noexcept {
+    return dogs_->speeds_[pos_];
+}
+
+inline Dog::Direction ConstDogRef::GetDirection() const noexcept {
+    return dogs_->directions_[pos_];
+}
+
+inline bool ConstDogRef::IsStoped() const noexcept {
+    return GetSpeed().x == 0. && GetSpeed().y == 0.;
+}
+
+inline size_t ConstDogRef::GetHoldingPeriod() const noexcept {
+    return dogs_->holding_times_[pos_];
+}
+
+inline size_t ConstDogRef::GetTimeInGame() const noexcept {
+    return dogs_->times_in_game_[pos_];
+}
+
+inline const Dog::Bag& ConstDogRef::GetBag() const noexcept {
+    return dogs_->cold_[pos_].bag;
+}
+
+inline size_t ConstDogRef::LootCountInBag() const noexcept {
+    return GetBag().size();
+}
+
+inline size_t ConstDogRef::GetScores() const noexcept {
+    return dogs_->cold_[pos_].scores;
+}
+
+inline void DogRef::SetSpeed(double speed) const noexcept {
+    Dogs().speeds_[pos_] = Dog::SpeedVector(GetDirection(), speed);
+}
+
+inline void DogRef::SetDirection(Dog::Direction dir) const noexcept {
+    Dogs().directions_[pos_] = dir;
+}
+
+inline void DogRef::SetCoordinates(geom::Vec2D coord) const noexcept {
+    Dogs().prev_coords_[pos_] = GetCoordinates();
+    Dogs().coords_[pos_] = coord;
+}
+
+inline void DogRef::Stop() const noexcept {
+    Dogs().speeds_[pos_] = {0., 0.};
+}
+
+inline void DogRef::AddTick(size_t tick) const noexcept {
+    Dogs().times_in_game_[pos_] += tick;
+    if (IsStoped()) {
+        Dogs().holding_times_[pos_] += tick;
+    }
+}
+
+inline void DogRef::AddLoot(LootObject loot) const {
+    Dogs().cold_[pos_].bag.emplace_back(std::move(loot));
+}
+
+inline void DogRef::DropBag() const noexcept {
+    auto& cold = Dogs().cold_[pos_];
+    cold.scores += Dog::BagWorth(cold.bag);
+    cold.bag.clear();
+}
+
+inline void DogRef::SetScores(size_t scores) const noexcept {
+    Dogs().cold_[pos_].scores += scores;
+}
+
+class GameSession;
+
+// Собака dog уходит на покой из сеанса session. Сигнал приходит, пока собака ещё в сеансе
+using DogRetire = boost::signals2::signal<void(model::Dog::Id dog, const model::GameSession& session)>;
+
+// Событие сеанса для наблюдателей. Сеансы продвигаются параллельно,
+// поэтому события копятся в самом сеансе и забираются после тика
+struct SessionEvent {
+    enum class Type {
+        JOIN,
+        LOOT_COLLECTED,
+        LOOT_DROPPED,
+        RETIRE
+    };
+    Type type;
+    Dog::Id dog;
+    // JOIN: имя собаки
+    std::string name;
+    // LOOT_COLLECTED: подобранный предмет
+    LootObject::Id loot{0};
+    size_t loot_type = 0;
+    // LOOT_DROPPED: сколько предметов сдано в офис и сколько очков они принесли
+    size_t items = 0;
+    size_t score_change = 0;
+};
 
 class GameSession {
 public:
     using Id = util::Tagged<size_t, GameSession>;
-    using DogPtr = std::shared_ptr<Dog>;
 
     GameSession(const Map* map, size_t index, bool random_spawn, const loot_gen::LootGeneratorParams& loot_gen_params,
         const size_t dog_retirement_time, DogRetire& do_on_retire_,
@@ -323,21 +646,46 @@ public:
 
     const Id& GetId() const noexcept;
 
-    DogPtr NewDog(std::string name);
-    DogPtr AddDog(Dog dog);
-    DogPtr GetDogById(Dog::Id id) const;    
-    const std::list<DogPtr>& GetDogs() const;
+    DogHandle NewDog(std::string name);
+    DogHandle AddDog(const Dog& dog);
+    // Откат NewDog, если игрока не удалось создать: собака удаляется без ухода на покой,
+    // а её событие входа, ещё не забранное наблюдателями, отбрасывается
+    void RemoveDog(DogHandle handle);
+    std::optional<DogHandle> GetDogById(Dog::Id id) const;
+    // Дескриптор должен быть действительным, иначе бросается std::out_of_range
+    DogRef GetDog(DogHandle handle);
+    ConstDogRef GetDog(DogHandle handle) const;
+    const DogSlotMap& GetDogs() const;
 
     void AddLoot(LootObject obj, geom::Vec2D coords);
 
     const Map& GetMap() const {return *map_;}
 
+    // Полный тик сеанса: Advance, затем RetireDogs
     void OnTick(std::chrono::milliseconds tick);
+    // Продвигает сеанс на tick, не затрагивая ничего за его пределами: собаки,
+    // которым пора на покой, только отмечаются и больше ничего не собирают.
+    // Разные сеансы можно продвигать параллельно.
+    void Advance(std::chrono::milliseconds tick);
+    // Отправляет на покой собак, отмеченных в Advance, и оповещает подписчиков DogRetire
+    void RetireDogs();
+
+    using Events = std::vector<SessionEvent>;
+    // Переносит в out события, накопленные с прошлого вызова. Очищенный прежний буфер out
+    // становится буфером сеанса, поэтому оба сохраняют ёмкость и тик не выделяет под события память
+    void TakeEvents(Events& out) noexcept;
+    // Отбрасывает накопленные события, сохраняя ёмкость буфера
+    void ClearEvents() noexcept;
 
     geom::Vec2D GetLootCoordsById(LootObject::Id id) const;
 
-    using LootObjectIdToObject = std::unordered_map<LootObject::Id, LootObject, util::TaggedHasher<LootObject::Id>>;
-    const LootObjectIdToObject& GetLootObjects() const;
+    struct LootEntry {
+        LootObject object;
+        geom::Vec2D position;
+    };
+    // Трофеи лежат в одном плотном массиве; порядок меняется при подборе трофеев
+    using LootObjects = std::vector<LootEntry>;
+    const LootObjects& GetLootObjects() const;
 
     struct DynamicStateContent {
         using LootObjects = std::vector<std::pair<LootObject, geom::Vec2D>>;
@@ -356,20 +704,19 @@ private:
     geom::Vec2D GetRandomPointOnRandomRoad() const;
     geom::Vec2D GetDogSpawnPoint();
 
-    void Move(Dog& dog, std::chrono::milliseconds time_delta) const;
+    void Move(DogRef dog, std::chrono::milliseconds time_delta) const;
 
     void SpawnLoot(std::chrono::milliseconds tick);
     void SpawnLootObject();
 
     void HandleCollisions();
 
-    void HandleLootCollection(DogPtr dog, LootObject::Id);
-    void HandleLootDrop(DogPtr dog);
+    void HandleLootCollection(DogRef dog, LootObject::Id);
+    void HandleLootDrop(DogRef dog);
 
+    void InsertLootObject(LootObject obj, geom::Vec2D coords);
     std::optional<LootObject> ExtractLootObject(LootObject::Id id);
 
-    void RetireDogs();
-
 private:
     const Map* map_;
     Id id_;
@@ -383,20 +730,30 @@ private:
     
     size_t dog_retirement_time_;
     DogRetire& do_on_retire_;
-    std::vector<Dog::Id> dogs_to_retire_;
-    
-    using DogIdToDog = std::unordered_map<Dog::Id, std::list<DogPtr>::iterator, util::TaggedHasher<Dog::Id>>;
-    DogIdToDog dog_id_to_dog_;
+    std::vector<DogHandle> dogs_to_retire_;
 
-    std::list<DogPtr> dogs_;
+    Events events_;
 
-    using CoordsToRoad = std::unordered_map<geom::Dimension, std::unordered_multimap<geom::Dimension, const model::Road*>>;
-    CoordsToRoad coords_to_roads_;
+    using DogIdToHandle = std::unordered_map<Dog::Id, DogHandle, util::TaggedHasher<Dog::Id>>;
+    DogIdToHandle dog_id_to_handle_;
 
-    LootObjectIdToObject loot_obj_id_to_obj_;
+    DogSlotMap dogs_;
 
-    using LootObjectIdToCoords = std::unordered_map<LootObject::Id, geom::Vec2D, util::TaggedHasher<LootObject::Id>>;
-    LootObjectIdToCoords loot_obj_id_to_coords_;
+    // Удаление переносит последний трофей на место удалённого, индекс хранит позиции в loot_objects_
+    using LootObjectIdToIndex = std::unordered_map<LootObject::Id, size_t, util::TaggedHasher<LootObject::Id>>;
+    LootObjectIdToIndex loot_obj_id_to_index_;
+    LootObjects loot_objects_;
+
+    // Буферы стадии столкновений. Индекс собирателя совпадает с позицией собаки в dogs_,
+    // предметы - сначала трофеи, затем офисы. Буферы сохраняют ёмкость между тиками,
+    // поэтому установившийся тик не выделяет память.
+    struct CollisionScratch {
+        std::vector<collision_detector::Gatherer> gatherers;
+        std::vector<collision_detector::Item> items;
+        std::vector<LootObject::Id> item_loot_ids;
+        collision_detector::GatherEventsFinder finder;
+    };
+    CollisionScratch collision_scratch_;
 };
 
 class Game {
@@ -405,12 +762,38 @@ public:
     void AddMap(Map map);
     const Maps& GetMaps() const noexcept;
     const Map* FindMap(const Map::Id& id) const noexcept;
+    // Сеанс на карте id для нового игрока: наименее загруженный из сеансов, где есть места.
+    // Если мест нет ни в одном сеансе карты, создаётся новый сеанс
     GameSession* GetGameSessionByMapId(const Map::Id& id);
+    GameSession* FindGameSession(const Map::Id& id, GameSession::Id session_id) noexcept;
     GameSession* AddGameSession(const Map::Id& id, size_t index,
             size_t dog_start_id = 0, size_t loot_object_start_id = 0);
 
+    // Наибольшее число игроков в одном сеансе, 0 - без ограничения
+    void SetSessionPlayersLimit(size_t limit);
+
+    using Sessions = std::deque<GameSession>;
+    const Sessions& GetGameSessions() const noexcept;
+
+    // Сеансы продвигаются параллельно, затем в порядке их номеров
+    // последовательно рассылаются сигналы DogRetire
     void OnTick(std::chrono::milliseconds time_delta);
 
+    // Забирает события всех сеансов: для каждого сеанса fn(const GameSession&) возвращает
+    // буфер GameSession::Events&, в который переносятся его события
+    template <typename Fn>
+    void TakeEvents(Fn&& fn) {
+        for (GameSession& session : sessions_) {
+            session.TakeEvents(fn(std::as_const(session)));
+        }
+    }
+
+    // Отбрасывает события всех сеансов, когда их некому передать
+    void ClearEvents() noexcept;
+
+    // threads - число потоков, которыми продвигаются сеансы (включая вызывающий OnTick)
+    void SetTickThreads(unsigned threads);
+
     void SetRandomSpawn(bool isRandom);
     void SetLootGeneratorParams(double period, double probability);
     void SetDogRetirementTime(size_t dog_retirement_time);
@@ -423,20 +806,29 @@ public:
     }
 
 private:
+    GameSession& CreateGameSession(const Map& map, size_t index,
+            size_t dog_start_id = 0, size_t loot_object_start_id = 0);
+
     using MapIdHasher = util::TaggedHasher<Map::Id>;
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
-    using MapIdToSession = std::unordered_map<Map::Id, GameSession, MapIdHasher>;
+    using MapIdToSessions = std::unordered_map<Map::Id, std::vector<GameSession*>, MapIdHasher>;
 
     std::vector<Map> maps_;
     MapIdToIndex map_id_to_index_;
-    MapIdToSession map_id_to_session_;
+    // deque не перемещает сеансы при добавлении, поэтому указатели на них остаются верными
+    Sessions sessions_;
+    MapIdToSessions map_id_to_sessions_;
 
     size_t last_session_index_ = 0;
+    size_t session_players_limit_ = 0;
 
     bool random_spawn_ = false;
     loot_gen::LootGeneratorParams loot_generator_params_;
     size_t dog_retirement_time_;
     DogRetire do_on_retire_;
+
+    std::unique_ptr<util::WorkStealingPool> tick_pool_;
+    std::vector<GameSession*> tick_sessions_;
 };
 
 }  // namespace model
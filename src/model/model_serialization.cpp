@@ -123,8 +123,8 @@ void ServiceSerializator::Restore() {
             session_state.dogs_join,
             session_state.objects_spawned
         );
-        for (model::Dog& dog : session_state.dogs) {
-            session->AddDog(std::move(dog));
+        for (const model::Dog& dog : session_state.dogs) {
+            session->AddDog(dog);
         }
         for (auto& [obj, coords] : session_state.loot_objects) {
             session->AddLoot(obj, coords);
@@ -132,7 +132,8 @@ void ServiceSerializator::Restore() {
     }
     for (auto& player_state : players_state) {
         service_.AddPlayer(std::move(player_state.token), player_state.map_id, player_state.session_id, player_state.dog_id);
-    }    
+    }
+    service_.PublishSnapshot();
 }
 
 }
\ No newline at end of file
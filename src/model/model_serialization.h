@@ -52,7 +52,12 @@ namespace service{
 
 template <typename Archive>
 void serialize(Archive& ar, PlayerDynamicStateContent& content, [[maybe_unused]] const unsigned version) {
-    ar & *content.token;
+    // Токен хранится строкой, как до перехода на 128-битные значения: старые сохранения читаются
+    std::string token = content.token.ToString();
+    ar & token;
+    if constexpr (Archive::is_loading::value) {
+        content.token = Token::FromString(token).value();
+    }
     ar & *content.map_id;
     ar & *content.session_id;
     ar & *content.dog_id;
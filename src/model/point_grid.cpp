@@ -0,0 +1,91 @@
+#include "point_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace geom {
+
+PointGrid::PointGrid(std::span<const Vec2D> points) {
+    const size_t count = points.size();
+    if (count == 0) {
+        return;
+    }
+    min_x_ = max_x_ = points.front().x;
+    min_y_ = max_y_ = points.front().y;
+    for (const Vec2D& point : points) {
+        min_x_ = std::min(min_x_, point.x);
+        min_y_ = std::min(min_y_, point.y);
+        max_x_ = std::max(max_x_, point.x);
+        max_y_ = std::max(max_y_, point.y);
+    }
+
+    const double width = max_x_ - min_x_;
+    const double height = max_y_ - min_y_;
+    const double n = static_cast<double>(count);
+    // Ячеек не больше 3n + 1 при любой форме облака точек
+    cell_size_ = std::max({std::sqrt(width * height / n), width / n, height / n});
+    if (cell_size_ <= 0.) {
+        cell_size_ = 1.;
+    }
+    cols_ = static_cast<size_t>(width / cell_size_) + 1;
+    rows_ = static_cast<size_t>(height / cell_size_) + 1;
+
+    std::vector<size_t> point_cell(count);
+    cell_begin_.assign(cols_ * rows_ + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        point_cell[i] = CellIndex(Col(points[i].x), Row(points[i].y));
+        ++cell_begin_[point_cell[i] + 1];
+    }
+    for (size_t c = 1; c < cell_begin_.size(); ++c) {
+        cell_begin_[c] += cell_begin_[c - 1];
+    }
+
+    ids_.resize(count);
+    points_.resize(count);
+    std::vector<size_t> cell_fill(cell_begin_.begin(), cell_begin_.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t k = cell_fill[point_cell[i]]++;
+        ids_[k] = i;
+        points_[k] = points[i];
+    }
+}
+
+void PointGrid::FindInBox(Vec2D min, Vec2D max, std::vector<size_t>& out) const {
+    if (ids_.empty() || max.x < min_x_ || max.y < min_y_ || min.x > max_x_ || min.y > max_y_) {
+        return;
+    }
+    const size_t first = out.size();
+    const size_t col_begin = Col(min.x);
+    const size_t col_end = Col(max.x);
+    for (size_t row = Row(min.y), row_end = Row(max.y); row <= row_end; ++row) {
+        // Ячейки одной строки сетки лежат подряд
+        const size_t begin = cell_begin_[CellIndex(col_begin, row)];
+        const size_t end = cell_begin_[CellIndex(col_end, row) + 1];
+        for (size_t k = begin; k < end; ++k) {
+            const Vec2D& point = points_[k];
+            if (point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y) {
+                out.push_back(ids_[k]);
+            }
+        }
+    }
+    std::sort(out.begin() + first, out.end());
+}
+
+// Координата приводится к номеру ячейки с прижатием к границам сетки
+static size_t ToCell(double value, double origin, double cell_size, size_t count) {
+    const double pos = (value - origin) / cell_size;
+    if (pos <= 0.) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>(pos), count - 1);
+}
+
+size_t PointGrid::Col(double x) const {
+    return ToCell(x, min_x_, cell_size_, cols_);
+}
+
+size_t PointGrid::Row(double y) const {
+    return ToCell(y, min_y_, cell_size_, rows_);
+}
+
+}  // namespace geom
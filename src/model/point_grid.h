@@ -0,0 +1,46 @@
+#pragma once
+
+#include "geom.h"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace geom {
+
+/*
+ *  Равномерная сетка над неподвижным набором точек для запросов по прямоугольнику.
+ *  Размер ячейки подбирается так, чтобы ячеек было порядка количества точек;
+ *  номера точек упорядочены по ячейкам (counting sort), и запрос просматривает
+ *  только ячейки, которые пересекает прямоугольник.
+ */
+class PointGrid {
+public:
+    PointGrid() = default;
+    explicit PointGrid(std::span<const Vec2D> points);
+
+    // Добавляет в out номера точек, лежащих в прямоугольнике [min, max] (границы включаются).
+    // Номера возвращаются по возрастанию, то есть в порядке исходного массива
+    void FindInBox(Vec2D min, Vec2D max, std::vector<size_t>& out) const;
+
+private:
+    size_t Col(double x) const;
+    size_t Row(double y) const;
+    size_t CellIndex(size_t col, size_t row) const {
+        return row * cols_ + col;
+    }
+
+    double min_x_ = 0.;
+    double min_y_ = 0.;
+    double max_x_ = 0.;
+    double max_y_ = 0.;
+    double cell_size_ = 1.;
+    size_t cols_ = 1;
+    size_t rows_ = 1;
+    std::vector<size_t> cell_begin_;
+    // Номера и координаты точек, упорядоченные по ячейкам
+    std::vector<size_t> ids_;
+    std::vector<Vec2D> points_;
+};
+
+}  // namespace geom
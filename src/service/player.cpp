@@ -1,16 +1,10 @@
 #include "player.h"
 
-#include <sstream>
-#include <iomanip>
-
 namespace detail {
 
 // TokenGenerator
-std::string TokenGenerator::operator()() {
-    std::ostringstream ss;
-    ss << std::hex << std::setw(16) << std::setfill('f') << generator1_()
-        << std::setw(16) << std::setfill('a') << generator2_();
-    return ss.str();
+util::Uint128 TokenGenerator::operator()() {
+    return {generator1_(), generator2_()};
 }
 
 } //namespace detail
@@ -20,12 +14,21 @@ std::string TokenGenerator::operator()() {
 namespace service {
 
 // Player
-Player::Player(std::shared_ptr<model::Dog> dog, model::GameSession* session)
+Player::Player(model::DogHandle dog, model::Dog::Id dog_id, model::GameSession* session) noexcept
     : dog_{dog}
+    , dog_id_{dog_id}
     , session_{session} {}
 
-model::Dog& Player::GetDog() const noexcept {
-    return *dog_;
+model::DogRef Player::GetDog() const {
+    return session_->GetDog(dog_);
+}
+
+model::DogHandle Player::GetDogHandle() const noexcept {
+    return dog_;
+}
+
+model::Dog::Id Player::GetDogId() const noexcept {
+    return dog_id_;
 }
 
 model::GameSession& Player::GetGameSession() const noexcept {
@@ -34,10 +37,11 @@ model::GameSession& Player::GetGameSession() const noexcept {
 
 
 // Players
-std::shared_ptr<Player> Players::AddPlayer(std::shared_ptr<model::Dog> dog, model::GameSession* session) {
+std::shared_ptr<Player> Players::AddPlayer(model::DogHandle dog, model::GameSession* session) {
+    const model::Dog::Id dog_id = session->GetDog(dog).GetId();
     auto [it, inserted] = players_.emplace(
-        std::make_pair(dog->GetId(), session->GetMap().GetId()),
-        std::make_shared<Player>(dog, session)
+        std::make_pair(dog_id, session->GetId()),
+        std::make_shared<Player>(dog, dog_id, session)
     );
     if (!inserted) {
         throw std::runtime_error("Dog already exists");
@@ -45,62 +49,65 @@ std::shared_ptr<Player> Players::AddPlayer(std::shared_ptr<model::Dog> dog, mode
     return it->second;
 }
 
-std::shared_ptr<Player> Players::FindByDogIdAndMapId(model::Dog::Id dog_id, const model::Map::Id& map_id) {
-    if (auto it = players_.find({dog_id, map_id}); it != players_.end()) {
+std::shared_ptr<Player> Players::FindByDogIdAndSessionId(model::Dog::Id dog_id, model::GameSession::Id session_id) {
+    if (auto it = players_.find({dog_id, session_id}); it != players_.end()) {
         return it->second;
     }
     return nullptr;
 }
 
-void Players::ErasePlayer(model::Dog::Id dog_id, const model::Map::Id& map_id) {
-    players_.erase({dog_id, map_id});
+void Players::ErasePlayer(model::Dog::Id dog_id, model::GameSession::Id session_id) {
+    players_.erase({dog_id, session_id});
 }
 
-size_t Players::Hasher::operator()(const std::pair<model::Dog::Id, model::Map::Id>& item) const {
-    return util::TaggedHasher<model::Dog::Id>{}(item.first) ^ util::TaggedHasher<model::Map::Id>{}(item.second);
+size_t Players::Hasher::operator()(const Key& item) const {
+    return util::TaggedHasher<model::Dog::Id>{}(item.first) * 37
+        ^ util::TaggedHasher<model::GameSession::Id>{}(item.second);
 }
 
 // PlayerTokens
-const Token& PlayerTokens::AddPlayer(const std::shared_ptr<Player> player) {
-    auto [it, inserted] = token_to_player_.emplace(Token{get_token_()}, player);
-    while (!inserted) {
-        std:tie(it, inserted) = token_to_player_.emplace(Token{get_token_()}, player);
+Token PlayerTokens::AddPlayer(const std::shared_ptr<Player> player) {
+    std::unique_lock lock{mutex_};
+    Token token{get_token_()};
+    while (!token_to_player_.Insert(token, player)) {
+        token = Token{get_token_()};
     }
-    player_to_token_.emplace(player, &it->first);
-    return it->first;
+    player_to_token_.emplace(player, token);
+    return token;
 }
 
 void PlayerTokens::AddPlayer(const std::shared_ptr<Player> player, Token token) {
-    
-    auto [it, inserted] = token_to_player_.emplace(std::move(token), player);
-    if (!inserted) {
+    std::unique_lock lock{mutex_};
+    if (!token_to_player_.Insert(token, player)) {
         throw std::runtime_error("Player already exists");
     }
-    player_to_token_.emplace(player, &it->first);
+    player_to_token_.emplace(player, token);
 }
 
 PlayersState PlayerTokens::GetPlayersState() const {
+    std::shared_lock lock{mutex_};
     PlayersState content;
-    for (auto [token, player] : token_to_player_) {
+    token_to_player_.ForEach([&content](const Token& token, const std::shared_ptr<Player>& player) {
         content.emplace_back(
-            std::move(token),
+            token,
             player->GetGameSession().GetMap().GetId(),
             player->GetGameSession().GetId(),
             player->GetDog().GetId()
         );
-    }
+    });
     return content;
 }
 
 void PlayerTokens::ErasePlayer(std::shared_ptr<Player> player) {
-    const Token* token = player_to_token_.at(player);
-    token_to_player_.erase(*token);
+    std::unique_lock lock{mutex_};
+    token_to_player_.Erase(player_to_token_.at(player));
     player_to_token_.erase(player);
 }
 
 std::shared_ptr<Player> PlayerTokens::FindPlayerByToken(const Token& token) const {
-    if (token_to_player_.contains(token)) {
-        return token_to_player_.at(token);
+    std::shared_lock lock{mutex_};
+    if (auto player = token_to_player_.Find(token)) {
+        return *player;
     }
     return nullptr;
 }
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "../model/model.h"
+#include "../util/flat_hash_map.h"
 #include "../util/tagged_uuid.h"
+#include "../util/token128.h"
 
 #include <random>
+#include <shared_mutex>
 #include <unordered_map>
 
 namespace detail {
@@ -12,7 +15,7 @@ struct TokenTag {};
 
 class TokenGenerator {
 public:
-    std::string operator()();
+    util::Uint128 operator()();
 private:
     std::random_device random_device_;
     std::mt19937_64 generator1_{[this] {
@@ -31,23 +34,28 @@ struct RetiredPlayerTag {};
 
 namespace service {
 
-using Token = util::Tagged<std::string, detail::TokenTag>;
+using Token = util::TaggedToken128<detail::TokenTag>;
 
 class Player {
 public:
-    explicit Player(std::shared_ptr<model::Dog> dog, model::GameSession* session);
+    Player(model::DogHandle dog, model::Dog::Id dog_id, model::GameSession* session) noexcept;
 
-    model::Dog& GetDog() const noexcept;
+    // Собака игрока хранится в его игровом сеансе
+    model::DogRef GetDog() const;
+    model::DogHandle GetDogHandle() const noexcept;
+    // Идентификатор не меняется, поэтому его можно читать без обращения к сеансу из любого потока
+    model::Dog::Id GetDogId() const noexcept;
 
     model::GameSession& GetGameSession() const noexcept;
 
 private:
-    std::shared_ptr<model::Dog> dog_ = nullptr;
+    model::DogHandle dog_;
+    model::Dog::Id dog_id_;
     model::GameSession* session_ = nullptr;
 };
 
 struct PlayerDynamicStateContent {
-    Token token{""};
+    Token token;
     model::Map::Id map_id{""};
     model::GameSession::Id session_id{0u};
     model::Dog::Id dog_id{0u};
@@ -56,31 +64,38 @@ using PlayersState = std::vector<PlayerDynamicStateContent>;
 
 class Players {
 public:
-    std::shared_ptr<Player> AddPlayer(std::shared_ptr<model::Dog> dog, model::GameSession* session);
-    std::shared_ptr<Player> FindByDogIdAndMapId(model::Dog::Id dog_id, const model::Map::Id& map_id);
+    std::shared_ptr<Player> AddPlayer(model::DogHandle dog, model::GameSession* session);
+    // Идентификаторы собак уникальны только в пределах сеанса, а на одной карте может быть несколько сеансов
+    std::shared_ptr<Player> FindByDogIdAndSessionId(model::Dog::Id dog_id, model::GameSession::Id session_id);
 
-    void ErasePlayer(model::Dog::Id dog_id, const model::Map::Id& map_id);
+    void ErasePlayer(model::Dog::Id dog_id, model::GameSession::Id session_id);
 private:
 
-    struct Hasher{size_t operator()(const std::pair<model::Dog::Id, model::Map::Id>& item) const;};
+    using Key = std::pair<model::Dog::Id, model::GameSession::Id>;
+    struct Hasher{size_t operator()(const Key& item) const;};
 
-    using DogIdAndMapIdToPlayer = std::unordered_map<std::pair<model::Dog::Id, model::Map::Id>, std::shared_ptr<Player>, Hasher>;
-    DogIdAndMapIdToPlayer players_;
+    using DogIdAndSessionIdToPlayer = std::unordered_map<Key, std::shared_ptr<Player>, Hasher>;
+    DogIdAndSessionIdToPlayer players_;
 };
 
+// Токены изменяются потоком симуляции, а ищутся из потоков HTTP-запросов,
+// поэтому доступ к ним защищён shared_mutex
 class PlayerTokens {
 public:
-    const Token& AddPlayer(const std::shared_ptr<Player> player);
+    Token AddPlayer(const std::shared_ptr<Player> player);
     void AddPlayer(const std::shared_ptr<Player> player, Token token);
     std::shared_ptr<Player> FindPlayerByToken(const Token& token) const;
 
+    // Читает собак игроков, поэтому вызывается потоком симуляции
     PlayersState GetPlayersState() const;
 
     void ErasePlayer(std::shared_ptr<Player> player);
 
 private:
-    std::unordered_map<Token, std::shared_ptr<Player>, util::TaggedHasher<Token>> token_to_player_;
-    std::unordered_map<std::shared_ptr<Player>, const Token*> player_to_token_;
+    mutable std::shared_mutex mutex_;
+    // Токен проверяется в каждом запросе к /state и /action, поэтому поиск идёт по плоской таблице
+    util::FlatHashMap<Token, std::shared_ptr<Player>, util::TaggedHasher<Token>> token_to_player_;
+    std::unordered_map<std::shared_ptr<Player>, Token> player_to_token_;
     detail::TokenGenerator get_token_;
 };
 
@@ -1,5 +1,8 @@
 #include "service.h"
 
+#include <algorithm>
+#include <unordered_set>
+
 namespace service {
 
 // UseCaseBase
@@ -22,70 +25,143 @@ repository::SaveScoresFactory& UseCaseBase::GetSaveScoresFactory(){
     return service_->db_.GetSaveScoresFactory();
 }
 
-UseCaseJoinPlayer::Result UseCaseJoinPlayer::operator()(const model::Map::Id& map_id, std::string dog_name) {
-    model::GameSession* session = GetGame().GetGameSessionByMapId(map_id);
-    if (!session) {
-        return std::nullopt;
+void UseCaseJoinPlayer::operator()(const model::Map::Id& map_id, std::string dog_name, Callback on_joined) {
+    if (!GetGame().FindMap(map_id)) {
+        return on_joined(std::nullopt, nullptr);
     }
-    auto dog = session->NewDog(std::move(dog_name));
-    auto player = GetPlayers().AddPlayer(dog, session);
-    Token token = GetPlayerTokens().AddPlayer(player);
-    return std::make_pair(std::move(token), player->GetDog().GetId());
+    service_->PostCommand([this, map_id, dog_name = std::move(dog_name), on_joined = std::move(on_joined)]() mutable {
+        try {
+            model::GameSession* session = GetGame().GetGameSessionByMapId(map_id);
+            auto dog = session->NewDog(std::move(dog_name));
+            const model::Dog::Id dog_id = session->GetDog(dog).GetId();
+            std::shared_ptr<Player> player;
+            Token token;
+            try {
+                player = GetPlayers().AddPlayer(dog, session);
+                token = GetPlayerTokens().AddPlayer(player);
+            } catch (...) {
+                // Собака без игрока и токена осталась бы в сеансе навсегда
+                if (player) {
+                    GetPlayers().ErasePlayer(dog_id, session->GetId());
+                }
+                session->RemoveDog(dog);
+                throw;
+            }
+            service_->PostReply([on_joined = std::move(on_joined),
+                                 result = Result{std::make_pair(std::move(token), dog_id)}]() mutable {
+                on_joined(std::move(result), nullptr);
+            });
+        } catch (...) {
+            // Ошибка отправляется тем же путём, что и успешный ответ
+            service_->PostReply([on_joined = std::move(on_joined), error = std::current_exception()]() mutable {
+                on_joined(std::nullopt, error);
+            });
+        }
+    });
 }
 
 UseCaseGetPlayers::Result UseCaseGetPlayers::operator()(const Token& player_token) {
-    UseCaseGetPlayers::Result result = std::nullopt;
     if (auto player = GetPlayerTokens().FindPlayerByToken(player_token)) {
-        const auto& dogs = player->GetGameSession().GetDogs();
-        result.emplace().reserve(dogs.size());
-        for (const auto& dog : dogs) {
-            result->emplace_back(dog->GetId(), dog->GetName());
+        if (auto snapshot = service_->GetSessionSnapshot(player->GetGameSession().GetId())) {
+            return Result{snapshot, &snapshot->players};
         }
     }
-    return result;
+    return nullptr;
 }
 
 UseCaseGetGameState::Result UseCaseGetGameState::operator()(const Token& player_token) {
-    UseCaseGetGameState::Result result = std::nullopt;
-
     if (auto player = GetPlayerTokens().FindPlayerByToken(player_token)) {
-        const auto& dogs = player->GetGameSession().GetDogs();
-        result.emplace().players.reserve(dogs.size());
-        for (const auto& dog : dogs) {
-            UseCaseGetGameState::PlayerState::Bag player_bag;
-            for (const auto& loot_item : dog->GetBag()) {
-                player_bag.emplace_back(*loot_item.GetId(), loot_item.GetType());
-            }
-            result->players.emplace_back( dog->GetId(), 
-                                        dog->GetCoordinates(), 
-                                        dog->GetSpeed(),
-                                        dog->GetDirection(), 
-                                        std::move(player_bag),
-                                        dog->GetScores());
+        if (auto snapshot = service_->GetSessionSnapshot(player->GetGameSession().GetId())) {
+            return Result{snapshot, &snapshot->state};
         }
-        
-        const auto& session = player->GetGameSession();
-        const auto& loot_oblects = session.GetLootObjects();
-        result->loot_objects.reserve(loot_oblects.size());
-        for (const auto& [obj_id, obj] : loot_oblects ) {
-            result->loot_objects.emplace_back(obj_id, obj.GetType(), session.GetLootCoordsById(obj_id));
+    }
+    return nullptr;
+}
+
+UseCaseGetGameState::Result UseCaseGetGameState::operator()(const Token& player_token, const Area& area) {
+    auto player = GetPlayerTokens().FindPlayerByToken(player_token);
+    if (!player) {
+        return nullptr;
+    }
+    auto snapshot = service_->GetSessionSnapshot(player->GetGameSession().GetId());
+    if (!snapshot) {
+        return nullptr;
+    }
+    const GameState& state = snapshot->state;
+    const SpatialIndex& index = state.GetSpatialIndex();
+
+    geom::Vec2D min, max;
+    std::optional<geom::Vec2D> center;
+    double sq_radius = 0.;
+    if (const auto* box = std::get_if<Box>(&area)) {
+        min = box->min;
+        max = box->max;
+    } else {
+        auto it = index.player_index.find(player->GetDogId());
+        if (it == index.player_index.end()) {
+            return Result{snapshot, &state};
         }
-    }    
+        const double radius = std::get<Radius>(area).value;
+        center = state.players[it->second].pos;
+        min = {center->x - radius, center->y - radius};
+        max = {center->x + radius, center->y + radius};
+        sq_radius = radius * radius;
+    }
+    // Прямоугольник из сетки уточняется до круга
+    auto inside = [&center, sq_radius](const geom::Vec2D& pos) {
+        if (!center) {
+            return true;
+        }
+        const double dx = pos.x - center->x;
+        const double dy = pos.y - center->y;
+        return dx * dx + dy * dy <= sq_radius;
+    };
+
+    auto result = std::make_shared<GameState>();
+    result->tick = state.tick;
+    std::vector<size_t> found;
+    index.players.FindInBox(min, max, found);
+    for (size_t i : found) {
+        if (inside(state.players[i].pos)) {
+            result->players.push_back(state.players[i]);
+        }
+    }
+    found.clear();
+    index.loot_objects.FindInBox(min, max, found);
+    for (size_t i : found) {
+        if (inside(state.loot_objects[i].pos)) {
+            result->loot_objects.push_back(state.loot_objects[i]);
+        }
+    }
     return result;
 }
 
-bool UseCaseGameAction::operator()(const Token& player_token, model::Dog::Direction dir) {
+std::optional<model::GameSession::Id> UseCaseGetPlayerSession::operator()(const Token& player_token) {
     if (auto player = GetPlayerTokens().FindPlayerByToken(player_token)) {
+        return player->GetGameSession().GetId();
+    }
+    return std::nullopt;
+}
+
+bool UseCaseGameAction::operator()(const Token& player_token, model::Dog::Direction dir) {
+    auto player = GetPlayerTokens().FindPlayerByToken(player_token);
+    if (!player) {
+        return false;
+    }
+    const auto speed = player->GetGameSession().GetMap().GetDogSpeed();
+    service_->PostCommand([player, dir, speed] {
+        // Пока команда ждала тика, собака могла уйти на покой
+        if (!player->GetGameSession().GetDogs().Contains(player->GetDogHandle())) {
+            return;
+        }
         if (dir == model::Dog::Direction::STOP){
             player->GetDog().Stop();
-            return true;
-        }        
-        const auto speed = player->GetGameSession().GetMap().GetDogSpeed();
+            return;
+        }
         player->GetDog().SetDirection(dir);
         player->GetDog().SetSpeed(speed);
-        return true;
-    }      
-    return false;
+    });
+    return true;
 }
 
 bool UseCaseTimeTick::operator()(std::chrono::milliseconds time_delta) { 
@@ -102,14 +178,14 @@ std::vector<RetiredPlayer> UseCaseRecords::operator()(int offset, int limit) {
 }
 
 
-bool UseCaseDogRetire::operator()(model::Dog::Id dog_id, const model::Map::Id& map_id) {
+bool UseCaseDogRetire::operator()(model::Dog::Id dog_id, const model::GameSession& session) {
     using namespace std::chrono;
     auto unit = GetSaveScoresFactory().CreateSaveScores();
-    auto player = GetPlayers().FindByDogIdAndMapId(dog_id, map_id);
-    model::Dog& dog = player->GetDog();
+    auto player = GetPlayers().FindByDogIdAndSessionId(dog_id, session.GetId());
+    model::DogRef dog = player->GetDog();
     unit->PlayerRepository().Save({RetiredPlayerId::New(), dog.GetName(), dog.GetScores(), dog.GetTimeInGame()});
     unit->Commit();
-    GetPlayers().ErasePlayer(dog_id, map_id);
+    GetPlayers().ErasePlayer(dog_id, session.GetId());
     GetPlayerTokens().ErasePlayer(player);
     return true;
 }
@@ -120,11 +196,13 @@ Service::Service(model::Game& game, repository::Database & db)
     , JoinPlayer{this}
     , GetPlayers{this}
     , GetGameState{this}
+    , GetPlayerSession{this}
     , GameAction{this}
     , TimeTick{this}
     , Records{this}
     , DogRetire{this} {
-    dog_retire_listener = game_.RetireListener([this](model::Dog::Id dog, const model::Map::Id& map) {this->DogRetire(dog, map);});
+    dog_retire_listener = game_.RetireListener([this](model::Dog::Id dog, const model::GameSession& session) {this->DogRetire(dog, session);});
+    PublishSnapshot();
 }
 
 const model::Game::Maps& Service::GetMaps() const noexcept{
@@ -144,27 +222,324 @@ bool Service::GetTimeTicker(){
 }
 
 void Service::Tick(std::chrono::milliseconds time_delta){
+    ExecuteCommands();
     game_.OnTick(time_delta);
+    PublishSnapshot();
+    SendReplies();
+    PublishEvents(time_delta);
 
     // Уведомляем подписчиков сигнала tick
     tick_signal_(time_delta);  
 }
 
+void Service::PublishEvents(std::chrono::milliseconds time_delta) {
+    // Без подписчиков события отбрасываются, иначе они копились бы в сеансах.
+    // Буферы событий при этом сохраняют ёмкость, и тик не выделяет под них память
+    if (tick_events_signal_.empty()) {
+        return game_.ClearEvents();
+    }
+    // Сеансы только добавляются и не меняют порядок, поэтому запись tick_events_ с тем же номером
+    // относится к тому же сеансу. Её буфер событий обменивается с буфером сеанса
+    size_t index = 0;
+    game_.TakeEvents([this, &index](const model::GameSession& session) -> model::GameSession::Events& {
+        if (index == tick_events_.size()) {
+            tick_events_.push_back({session.GetId(), session.GetMap().GetId(), 0, 0, {}});
+        }
+        SessionTickEvents& entry = tick_events_[index++];
+        entry.dogs = session.GetDogs().Size();
+        entry.loot_objects = session.GetLootObjects().size();
+        return entry.events;
+    });
+    tick_events_signal_(time_delta, tick_events_);
+}
+
+void Service::PostCommand(Command command) {
+    commands_.Push(std::move(command));
+}
+
+void Service::FlushCommands() {
+    if (time_ticker_) {
+        return;
+    }
+    // Без потока симуляции запросы и тики уже выполняются последовательно в api_strand
+    if (!ExecuteCommands()) {
+        return;
+    }
+    PublishSnapshot();
+    SendReplies();
+}
+
+void Service::PostReply(Command reply) {
+    replies_.push_back(std::move(reply));
+}
+
+bool Service::ExecuteCommands() {
+    bool executed = false;
+    while (auto command = commands_.Pop()) {
+        (*command)();
+        executed = true;
+    }
+    return executed;
+}
+
+void Service::SendReplies() {
+    for (auto& reply : replies_) {
+        reply();
+    }
+    replies_.clear();
+}
+
+namespace {
+
+using PlayerState = UseCaseGetGameState::PlayerState;
+using GameState = UseCaseGetGameState::GameState;
+using StateDelta = UseCaseGetGameState::StateDelta;
+using LazyStateDelta = UseCaseGetGameState::LazyStateDelta;
+
+using DogIdHasher = util::TaggedHasher<model::Dog::Id>;
+using LootIdHasher = util::TaggedHasher<model::LootObject::Id>;
+
+// Предметы на карте не меняются, поэтому у них сравниваются только идентификаторы
+StateDelta DiffStates(const GameState& from, const GameState& to) {
+    StateDelta delta{from.tick, to.tick};
+
+    std::unordered_map<model::Dog::Id, const PlayerState*, DogIdHasher> previous_players;
+    previous_players.reserve(from.players.size());
+    for (const auto& player : from.players) {
+        previous_players.emplace(player.id, &player);
+    }
+    for (const auto& player : to.players) {
+        auto it = previous_players.find(player.id);
+        if (it == previous_players.end() || !(*it->second == player)) {
+            delta.players.push_back(player);
+        }
+        if (it != previous_players.end()) {
+            previous_players.erase(it);
+        }
+    }
+    for (const auto& [id, player] : previous_players) {
+        delta.removed_players.push_back(id);
+    }
+
+    std::unordered_set<model::LootObject::Id, LootIdHasher> previous_loot;
+    previous_loot.reserve(from.loot_objects.size());
+    for (const auto& loot_object : from.loot_objects) {
+        previous_loot.insert(loot_object.id);
+    }
+    for (const auto& loot_object : to.loot_objects) {
+        if (!previous_loot.erase(loot_object.id)) {
+            delta.loot_objects.push_back(loot_object);
+        }
+    }
+    delta.removed_loot_objects.assign(previous_loot.begin(), previous_loot.end());
+    return delta;
+}
+
+}  // namespace
+
+LazyStateDelta::LazyStateDelta(uint64_t from_tick, uint64_t to_tick, std::shared_ptr<const GameState> from)
+    : from_tick_{from_tick}
+    , to_tick_{to_tick}
+    , from_{std::move(from)} {
+}
+
+LazyStateDelta::LazyStateDelta(StateDelta delta)
+    : from_tick_{delta.from_tick}
+    , to_tick_{delta.to_tick}
+    , delta_{std::make_shared<const StateDelta>(std::move(delta))}
+    , computed_{true} {
+}
+
+UseCaseGetGameState::StateDeltaPtr LazyStateDelta::Get(const GameState* to) const {
+    std::lock_guard lock{mutex_};
+    if (!delta_ && from_ && to) {
+        delta_ = std::make_shared<const StateDelta>(DiffStates(*from_, *to));
+        // Предыдущее состояние больше не нужно
+        from_.reset();
+        computed_.store(true, std::memory_order_release);
+    }
+    return delta_;
+}
+
+void LazyStateDelta::Release() const {
+    std::lock_guard lock{mutex_};
+    from_.reset();
+}
+
+const UseCaseGetGameState::SpatialIndex& GameState::GetSpatialIndex() const {
+    auto [index, hit] = spatial_index.Get([this] {
+        std::vector<geom::Vec2D> positions;
+        positions.reserve(std::max(players.size(), loot_objects.size()));
+        SpatialIndex result;
+        for (size_t i = 0; i < players.size(); ++i) {
+            positions.push_back(players[i].pos);
+            result.player_index.emplace(players[i].id, i);
+        }
+        result.players = geom::PointGrid{positions};
+        positions.clear();
+        for (const auto& loot_object : loot_objects) {
+            positions.push_back(loot_object.pos);
+        }
+        result.loot_objects = geom::PointGrid{positions};
+        return result;
+    });
+    // Кэш хранится в самом снимке, поэтому индекс живёт не меньше ссылки на него
+    return *index;
+}
+
+std::optional<StateDelta> GameState::ChangesSince(uint64_t since) const {
+    if (since > tick) {
+        return std::nullopt;
+    }
+    if (since == tick) {
+        return StateDelta{since, tick};
+    }
+    if (recent_deltas.empty() || since < recent_deltas.front()->FromTick()) {
+        return std::nullopt;
+    }
+    auto latest = LatestChanges();
+    if (!latest) {
+        return std::nullopt;
+    }
+    if (since == latest->from_tick) {
+        return *latest;
+    }
+
+    // Изменения объединяются от новых к старым: для каждого объекта важно только последнее
+    StateDelta result{since, tick};
+    std::unordered_set<model::Dog::Id, DogIdHasher> seen_players;
+    std::unordered_set<model::LootObject::Id, LootIdHasher> seen_loot;
+    for (auto it = recent_deltas.rbegin(); it != recent_deltas.rend() && (*it)->FromTick() >= since; ++it) {
+        // Более старые записи посчитаны или отброшены при публикации следующих тиков
+        auto computed = it == recent_deltas.rbegin() ? latest : (*it)->Get(nullptr);
+        if (!computed) {
+            return std::nullopt;
+        }
+        const StateDelta& delta = *computed;
+        for (const auto& player : delta.players) {
+            if (seen_players.insert(player.id).second) {
+                result.players.push_back(player);
+            }
+        }
+        for (const auto& id : delta.removed_players) {
+            if (seen_players.insert(id).second) {
+                result.removed_players.push_back(id);
+            }
+        }
+        for (const auto& loot_object : delta.loot_objects) {
+            if (seen_loot.insert(loot_object.id).second) {
+                result.loot_objects.push_back(loot_object);
+            }
+        }
+        for (const auto& id : delta.removed_loot_objects) {
+            if (seen_loot.insert(id).second) {
+                result.removed_loot_objects.push_back(id);
+            }
+        }
+    }
+    return result;
+}
+
+UseCaseGetGameState::StateDeltaPtr GameState::LatestChanges() const {
+    if (recent_deltas.empty()) {
+        return nullptr;
+    }
+    return recent_deltas.back()->Get(this);
+}
+
+void Service::PublishSnapshot() {
+    // snapshot_ изменяет только поток симуляции, поэтому предыдущий набор не изменится до конца публикации
+    const auto previous = snapshot_.load(std::memory_order_acquire);
+    auto snapshot = std::make_shared<SessionIdToSnapshot>();
+    for (const model::GameSession& session : game_.GetGameSessions()) {
+        SessionSnapshotPtr previous_session;
+        if (previous) {
+            if (auto it = previous->find(session.GetId()); it != previous->end()) {
+                previous_session = it->second;
+            }
+        }
+
+        auto session_snapshot = std::make_shared<SessionSnapshot>();
+        session_snapshot->state.tick = previous_session ? previous_session->state.tick + 1 : 1;
+        const auto& dogs = session.GetDogs();
+
+        session_snapshot->players.reserve(dogs.Size());
+        session_snapshot->state.players.reserve(dogs.Size());
+        for (model::ConstDogRef dog : dogs.All()) {
+            session_snapshot->players.emplace_back(dog.GetId(), dog.GetName());
+
+            UseCaseGetGameState::PlayerState::Bag player_bag;
+            player_bag.reserve(dog.LootCountInBag());
+            for (const auto& loot_item : dog.GetBag()) {
+                player_bag.emplace_back(*loot_item.GetId(), loot_item.GetType());
+            }
+            session_snapshot->state.players.emplace_back( dog.GetId(),
+                                        dog.GetCoordinates(),
+                                        dog.GetSpeed(),
+                                        dog.GetDirection(),
+                                        std::move(player_bag),
+                                        dog.GetScores());
+        }
+
+        const auto& loot_objects = session.GetLootObjects();
+        session_snapshot->state.loot_objects.reserve(loot_objects.size());
+        for (const auto& [obj, position] : loot_objects) {
+            session_snapshot->state.loot_objects.emplace_back(obj.GetId(), obj.GetType(), position);
+        }
+
+        if (previous_session) {
+            const GameState& previous_state = previous_session->state;
+            const auto& previous_deltas = previous_state.recent_deltas;
+            // Изменения прошлого тика дальше нельзя будет посчитать: дорогое сравнение нужно,
+            // только если изменения запрашивали в пределах хранимой истории, иначе запись отбрасывается
+            // и не держит состояние позапрошлого тика
+            if (!previous_deltas.empty()) {
+                const bool in_use = std::any_of(previous_deltas.begin(), previous_deltas.end(), [](const auto& delta) {
+                    return delta->IsComputed();
+                });
+                if (in_use) {
+                    previous_deltas.back()->Get(&previous_state);
+                } else {
+                    previous_deltas.back()->Release();
+                }
+            }
+            auto& deltas = session_snapshot->state.recent_deltas;
+            const size_t kept = std::min(previous_deltas.size(), DELTA_HISTORY - 1);
+            deltas.reserve(kept + 1);
+            deltas.assign(previous_deltas.end() - kept, previous_deltas.end());
+            deltas.push_back(std::make_shared<const LazyStateDelta>(previous_state.tick, session_snapshot->state.tick,
+                                                                    std::shared_ptr<const GameState>{previous_session, &previous_state}));
+        }
+        snapshot->emplace(session.GetId(), std::move(session_snapshot));
+    }
+
+    snapshot_.store(std::move(snapshot), std::memory_order_release);
+}
+
+Service::SessionSnapshotPtr Service::GetSessionSnapshot(model::GameSession::Id session_id) const {
+    if (auto snapshot = snapshot_.load(std::memory_order_acquire)) {
+        if (auto it = snapshot->find(session_id); it != snapshot->end()) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
 PlayersState Service::GetPlayersState() const {
     return player_tokens_.GetPlayersState();
 }
 
 void Service::AddPlayer(Token token, const model::Map::Id& map_id,
     model::GameSession::Id session_id, model::Dog::Id dog_id) {
-    model::GameSession* session =  game_.GetGameSessionByMapId(map_id);
-    if (!session || session->GetId() != session_id) {
+    model::GameSession* session = game_.FindGameSession(map_id, session_id);
+    if (!session) {
         throw std::runtime_error("Game session not found");
     }
     auto dog = session->GetDogById(dog_id);
     if (!dog) {
         throw std::runtime_error("Dog not found");
     }
-    auto player = players_.AddPlayer(dog, session);
+    auto player = players_.AddPlayer(*dog, session);
     player_tokens_.AddPlayer(player, std::move(token));
 }
 
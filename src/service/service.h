@@ -3,11 +3,21 @@
 
 #include "../model/model.h"
 #include "../model/geom.h"
+#include "../model/point_grid.h"
 #include "player.h"
 #include "../repository/repository.h"
+#include "../util/mpsc_queue.h"
+#include "../util/once_cache.h"
 
 #include <optional>
+#include <atomic>
 #include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <variant>
 
 #include <boost/signals2.hpp>
 
@@ -26,17 +36,25 @@ protected:
     repository::SaveScoresFactory& GetSaveScoresFactory();
 };
 
+// Присоединение выполняется потоком симуляции в начале ближайшего тика,
+// вызывающий поток его не ждёт
 class UseCaseJoinPlayer : public UseCaseBase {
     using UseCaseBase::UseCaseBase;
 public:
     using Result = std::optional<std::pair<Token, model::Dog::Id>>;
-    Result operator()(const model::Map::Id& map_id, std::string dog_name);
+    // Вызывается после публикации снимка, в котором уже есть новый игрок, или сразу,
+    // если карта не найдена. Если добавить игрока не удалось, result пуст, а error задан
+    using Callback = std::function<void(Result result, std::exception_ptr error)>;
+    // Несколько присоединений, поставленных подряд, выполняются за один тик
+    void operator()(const model::Map::Id& map_id, std::string dog_name, Callback on_joined);
 };
 
+// Читает опубликованный снимок сеанса игрока; nullptr, если игрок не найден
 class UseCaseGetPlayers : public UseCaseBase {
     using UseCaseBase::UseCaseBase;
 public:
-    using Result = std::optional<std::vector<std::pair<model::Dog::Id, std::string_view>>>;
+    using Players = std::vector<std::pair<model::Dog::Id, std::string>>;
+    using Result = std::shared_ptr<const Players>;
     Result operator()(const Token& player_token);
 };
 
@@ -46,6 +64,7 @@ public:
     struct PlayerState {
         struct LootObj {
             size_t id, type;
+            bool operator==(const LootObj&) const = default;
         };        
         model::Dog::Id id;
         geom::Vec2D pos;
@@ -54,6 +73,7 @@ public:
         using Bag = std::vector<LootObj>;
         Bag bag;       
         size_t scores;
+        bool operator==(const PlayerState&) const = default;
     };
 
     struct LootObjectState {
@@ -61,14 +81,114 @@ public:
         size_t type;
         geom::Vec2D pos;
     };
+
+    // Изменения состояния сеанса между двумя снимками
+    struct StateDelta {
+        uint64_t from_tick = 0;
+        uint64_t to_tick = 0;
+        // Добавленные и изменившиеся собаки и предметы
+        std::vector<PlayerState> players;
+        std::vector<LootObjectState> loot_objects;
+        std::vector<model::Dog::Id> removed_players;
+        std::vector<model::LootObject::Id> removed_loot_objects;
+    };
+    using StateDeltaPtr = std::shared_ptr<const StateDelta>;
+
+    struct GameState;
+
+    // Изменения одного тика. Считаются при первом запросе: до этого запись держит состояние from_tick,
+    // а состояние to_tick передаёт вызывающий. Следующая публикация либо считает запись,
+    // если изменениями пользуются, либо отбрасывает её вместе с предыдущим состоянием
+    class LazyStateDelta {
+    public:
+        LazyStateDelta(uint64_t from_tick, uint64_t to_tick, std::shared_ptr<const GameState> from);
+        // Уже посчитанные изменения
+        explicit LazyStateDelta(StateDelta delta);
+
+        LazyStateDelta(const LazyStateDelta&) = delete;
+        LazyStateDelta& operator=(const LazyStateDelta&) = delete;
+
+        uint64_t FromTick() const noexcept {
+            return from_tick_;
+        }
+        uint64_t ToTick() const noexcept {
+            return to_tick_;
+        }
+        bool IsComputed() const noexcept {
+            return computed_.load(std::memory_order_acquire);
+        }
+        // to - состояние тика to_tick, нужно только для первого вызова.
+        // nullptr, если запись отброшена до того, как её посчитали
+        StateDeltaPtr Get(const GameState* to) const;
+        // Отпускает предыдущее состояние, после этого посчитать изменения уже нельзя
+        void Release() const;
+
+    private:
+        uint64_t from_tick_;
+        uint64_t to_tick_;
+        mutable std::mutex mutex_;
+        mutable std::shared_ptr<const GameState> from_;
+        mutable StateDeltaPtr delta_;
+        mutable std::atomic_bool computed_{false};
+    };
+    using LazyStateDeltaPtr = std::shared_ptr<const LazyStateDelta>;
+
+    // Сетки над собаками и предметами снимка для запросов по области
+    struct SpatialIndex {
+        geom::PointGrid players;
+        geom::PointGrid loot_objects;
+        // Номер собаки в GameState::players по её идентификатору
+        std::unordered_map<model::Dog::Id, size_t, util::TaggedHasher<model::Dog::Id>> player_index;
+    };
+
     struct GameState {
+        // Номер снимка сеанса, растёт с каждой публикацией
+        uint64_t tick = 0;
         std::vector<PlayerState> players;
         std::vector<LootObjectState> loot_objects;
+        // Изменения за последние тики от старых к новым, последнее заканчивается на tick
+        std::vector<LazyStateDeltaPtr> recent_deltas;
+        // Сериализованное состояние. Снимок не меняется до следующего тика,
+        // поэтому оно строится при первом запросе и отдаётся всем игрокам сеанса
+        util::OnceCache<std::string> serialized;
+        // То же состояние в двоичном формате (Accept: application/x-bloodhound-bin)
+        util::OnceCache<std::string> serialized_binary;
+        // Строится при первом запросе области интереса и разделяется всеми игроками сеанса
+        util::OnceCache<SpatialIndex> spatial_index;
+
+        // Изменения с тика since по текущий. nullopt, если история не хранится так далеко
+        std::optional<StateDelta> ChangesSince(uint64_t since) const;
+        // Изменения за последний тик, считаются при первом вызове. nullptr, если их уже не посчитать
+        StateDeltaPtr LatestChanges() const;
+        const SpatialIndex& GetSpatialIndex() const;
+    };
+
+    // Область интереса: круг вокруг собаки игрока или прямоугольник на карте
+    struct Radius {
+        double value;
     };
-    using Result = std::optional<GameState>;
+    struct Box {
+        geom::Vec2D min;
+        geom::Vec2D max;
+    };
+    using Area = std::variant<Radius, Box>;
+
+    // Читает опубликованный снимок сеанса игрока; nullptr, если игрок не найден
+    using Result = std::shared_ptr<const GameState>;
     Result operator()(const Token& player_token);
+    // Только собаки и предметы в области. Результат строится для каждого запроса и не кэшируется,
+    // история изменений в него не входит. Пока собаки игрока нет в снимке, Radius даёт весь снимок
+    Result operator()(const Token& player_token, const Area& area);
+};
+
+// Сеанс, в котором играет игрок; nullopt, если игрок не найден
+class UseCaseGetPlayerSession : public UseCaseBase {
+    using UseCaseBase::UseCaseBase;
+public:
+    std::optional<model::GameSession::Id> operator()(const Token& player_token);
 };
 
+// Проверяет токен и ставит действие в очередь команд, не дожидаясь тика
 class UseCaseGameAction : public UseCaseBase {
     using UseCaseBase::UseCaseBase;
 public:
@@ -90,7 +210,7 @@ public:
 class UseCaseDogRetire : public UseCaseBase {
 public:
     using UseCaseBase::UseCaseBase;
-    bool operator()(model::Dog::Id dog, const model::Map::Id&);
+    bool operator()(model::Dog::Id dog, const model::GameSession& session);
 };
 
 // Service
@@ -113,14 +233,55 @@ public:
         return tick_signal_.connect(handler);
     }
 
+    // События сеанса за тик и его итог для наблюдателей
+    struct SessionTickEvents {
+        model::GameSession::Id session;
+        model::Map::Id map;
+        size_t dogs;
+        size_t loot_objects;
+        model::GameSession::Events events;
+    };
+    using TickEvents = std::vector<SessionTickEvents>;
+    // Подаётся потоком симуляции после публикации снимка, перед сигналом tick
+    using TickEventsSignal = boost::signals2::signal<void(std::chrono::milliseconds delta, const TickEvents& events)>;
+    [[nodiscard]] boost::signals2::connection DoOnTickEvents(const TickEventsSignal::slot_type& handler) {
+        return tick_events_signal_.connect(handler);
+    }
+
     void AddPlayer(Token token, const model::Map::Id& map_id,
         model::GameSession::Id session_id, model::Dog::Id dog_id);
 
     PlayersState GetPlayersState() const;
 
+    // Команда, изменяющая состояние игры
+    using Command = std::function<void()>;
+    // Ставит команду в очередь без блокировок. Очередь разбирает поток симуляции в начале тика,
+    // а если тики приходят через API (OnTimeTicker не вызывался) - Tick или FlushCommands
+    void PostCommand(Command command);
+    // Только без потока симуляции: выполняет накопленные команды запроса. Если хоть одна
+    // команда выполнена, снимок публикуется один раз, и её результат сразу виден в состоянии
+    void FlushCommands();
+    // Ответ на команду. Выполняется после публикации снимка, в которой уже виден результат команды
+    void PostReply(Command reply);
+
+    // Неизменяемое состояние сеанса на конец тика
+    struct SessionSnapshot {
+        UseCaseGetPlayers::Players players;
+        UseCaseGetGameState::GameState state;
+    };
+    using SessionSnapshotPtr = std::shared_ptr<const SessionSnapshot>;
+    // Сколько последних изменений хранит снимок сеанса для ответов ?since=
+    static constexpr size_t DELTA_HISTORY = 64;
+
+    // Снимает и публикует состояние всех сеансов. Вызывается потоком симуляции
+    void PublishSnapshot();
+    // Можно вызывать из любого потока
+    SessionSnapshotPtr GetSessionSnapshot(model::GameSession::Id session_id) const;
+
     UseCaseJoinPlayer   JoinPlayer;
     UseCaseGetPlayers   GetPlayers;
     UseCaseGetGameState GetGameState;
+    UseCaseGetPlayerSession GetPlayerSession;
     UseCaseGameAction   GameAction;
     UseCaseTimeTick     TimeTick;
     UseCaseRecords      Records;
@@ -135,9 +296,28 @@ private:
     PlayerTokens player_tokens_;
     repository::Database& db_;
 
-    bool time_ticker_ = false;
+    // Возвращает false, если очередь была пуста
+    bool ExecuteCommands();
+    void SendReplies();
+    // Забирает события сеансов и подаёт сигнал TickEvents, если на него кто-то подписан
+    void PublishEvents(std::chrono::milliseconds time_delta);
+
+    std::atomic_bool time_ticker_ = false;
     
     TickSignal tick_signal_;
+    TickEventsSignal tick_events_signal_;
+    // Передаётся в TickEventsSignal и используется повторно, сохраняя ёмкость буферов
+    TickEvents tick_events_;
+
+    util::MpscQueue<Command> commands_;
+    std::vector<Command> replies_;
+
+    // Снимки публикуются по схеме RCU: поток симуляции собирает новый неизменяемый набор
+    // и атомарно подменяет указатель, читатели из любых потоков не берут блокировок
+    // и держат свой набор, пока не закончат с ним работу
+    using SessionIdToSnapshot = std::unordered_map<model::GameSession::Id, SessionSnapshotPtr,
+                                                   util::TaggedHasher<model::GameSession::Id>>;
+    std::atomic<std::shared_ptr<const SessionIdToSnapshot>> snapshot_;
 
     boost::signals2::scoped_connection dog_retire_listener;
 };
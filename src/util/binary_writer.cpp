@@ -0,0 +1,36 @@
+#include "binary_writer.h"
+
+#include <bit>
+
+namespace util {
+
+BinaryWriter& BinaryWriter::VarUint(uint64_t value) {
+    while (value >= 0x80) {
+        out_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out_.push_back(static_cast<char>(value));
+    return *this;
+}
+
+BinaryWriter& BinaryWriter::VarInt(int64_t value) {
+    // zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ..., чтобы небольшие отрицательные числа занимали мало байт
+    const uint64_t bits = static_cast<uint64_t>(value);
+    return VarUint((bits << 1) ^ (value < 0 ? ~uint64_t{0} : uint64_t{0}));
+}
+
+BinaryWriter& BinaryWriter::Float32(float value) {
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    for (int shift = 0; shift < 32; shift += 8) {
+        out_.push_back(static_cast<char>((bits >> shift) & 0xFF));
+    }
+    return *this;
+}
+
+BinaryWriter& BinaryWriter::String(std::string_view value) {
+    VarUint(value.size());
+    out_.append(value);
+    return *this;
+}
+
+}  // namespace util
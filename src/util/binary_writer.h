@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+/*
+ *  Запись двоичных данных в строку. Порядок байт всегда little-endian, независимо от платформы.
+ *  Целые без знака записываются varint (по 7 бит в байте, старший бит - признак продолжения),
+ *  целые со знаком - varint после zigzag-преобразования, строки - длина varint и байты строки.
+ */
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out) noexcept
+        : out_{out} {
+    }
+
+    BinaryWriter& U8(uint8_t value) {
+        out_.push_back(static_cast<char>(value));
+        return *this;
+    }
+
+    BinaryWriter& VarUint(uint64_t value);
+    BinaryWriter& VarInt(int64_t value);
+    BinaryWriter& Float32(float value);
+    BinaryWriter& String(std::string_view value);
+
+private:
+    std::string& out_;
+};
+
+}  // namespace util
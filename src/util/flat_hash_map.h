@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Хеш-таблица с открытой адресацией и линейным пробированием.
+ *  Ключи и значения лежат в одном массиве, поэтому поиск не переходит по указателям.
+ *  Удаление сдвигает следующие элементы цепочки назад, поэтому надгробия не нужны.
+ *  Ключ и значение должны конструироваться по умолчанию.
+ *  Вставка может перестроить таблицу, поэтому указатели на значения живут до следующей вставки.
+ */
+template <typename Key, typename Value, typename Hasher = std::hash<Key>>
+class FlatHashMap {
+public:
+    size_t Size() const noexcept {
+        return size_;
+    }
+
+    // false, если ключ уже есть; значение при этом не меняется
+    bool Insert(const Key& key, Value value) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            Rehash(slots_.empty() ? MIN_CAPACITY : slots_.size() * 2);
+        }
+        size_t index = Home(key);
+        while (slots_[index].used) {
+            if (slots_[index].key == key) {
+                return false;
+            }
+            index = Next(index);
+        }
+        slots_[index] = Slot{key, std::move(value), true};
+        ++size_;
+        return true;
+    }
+
+    const Value* Find(const Key& key) const {
+        const size_t index = FindIndex(key);
+        return index == NPOS ? nullptr : &slots_[index].value;
+    }
+
+    Value* Find(const Key& key) {
+        const size_t index = FindIndex(key);
+        return index == NPOS ? nullptr : &slots_[index].value;
+    }
+
+    bool Erase(const Key& key) {
+        size_t hole = FindIndex(key);
+        if (hole == NPOS) {
+            return false;
+        }
+        // Элемент переносится в дыру, если его домашняя ячейка не лежит в (hole, index]
+        for (size_t index = Next(hole); slots_[index].used; index = Next(index)) {
+            const size_t home = Home(slots_[index].key);
+            const bool reachable = hole < index ? (hole < home && home <= index)
+                                                : (hole < home || home <= index);
+            if (!reachable) {
+                slots_[hole] = std::move(slots_[index]);
+                hole = index;
+            }
+        }
+        slots_[hole] = Slot{};
+        --size_;
+        return true;
+    }
+
+    // fn(const Key&, const Value&) для каждого элемента в порядке ячеек
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (const auto& slot : slots_) {
+            if (slot.used) {
+                fn(slot.key, slot.value);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        Key key{};
+        Value value{};
+        bool used = false;
+    };
+
+    static constexpr size_t MIN_CAPACITY = 16;
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    // Ёмкость - степень двойки, поэтому номер ячейки берётся маской
+    size_t Home(const Key& key) const {
+        return hasher_(key) & (slots_.size() - 1);
+    }
+
+    size_t Next(size_t index) const noexcept {
+        return (index + 1) & (slots_.size() - 1);
+    }
+
+    size_t FindIndex(const Key& key) const {
+        if (size_ == 0) {
+            return NPOS;
+        }
+        for (size_t index = Home(key); slots_[index].used; index = Next(index)) {
+            if (slots_[index].key == key) {
+                return index;
+            }
+        }
+        return NPOS;
+    }
+
+    void Rehash(size_t capacity) {
+        std::vector<Slot> old = std::exchange(slots_, std::vector<Slot>(capacity));
+        for (auto& slot : old) {
+            if (slot.used) {
+                size_t index = Home(slot.key);
+                while (slots_[index].used) {
+                    index = Next(index);
+                }
+                slots_[index] = std::move(slot);
+            }
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    [[no_unique_address]] Hasher hasher_;
+};
+
+}  // namespace util
@@ -0,0 +1,136 @@
+#include "json_writer.h"
+
+#include <cmath>
+
+namespace util {
+
+using namespace std::literals;
+
+JsonWriter& JsonWriter::StartObject() {
+    Separate();
+    out_.push_back('{');
+    need_comma_ = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+    out_.push_back('}');
+    need_comma_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::StartArray() {
+    Separate();
+    out_.push_back('[');
+    need_comma_ = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray() {
+    out_.push_back(']');
+    need_comma_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key) {
+    Separate();
+    WriteString(key);
+    out_.push_back(':');
+    need_comma_ = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(std::string_view value) {
+    Separate();
+    WriteString(value);
+    need_comma_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(double value) {
+    Separate();
+    WriteDouble(value);
+    need_comma_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(bool value) {
+    Separate();
+    out_.append(value ? "true"sv : "false"sv);
+    need_comma_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::RawValue(std::string_view json) {
+    Separate();
+    out_.append(json);
+    need_comma_ = true;
+    return *this;
+}
+
+void JsonWriter::WriteDouble(double value) {
+    // boost::json записывает бесконечность и NaN так, чтобы JSON оставался корректным
+    if (std::isnan(value)) {
+        out_.append("null"sv);
+        return;
+    }
+    if (std::isinf(value)) {
+        out_.append(value < 0 ? "-1e99999"sv : "1e99999"sv);
+        return;
+    }
+
+    // to_chars даёт кратчайшую запись вида 1.5e+01, boost::json - вида 1.5E1
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::scientific);
+    const char* exponent = buffer;
+    while (*exponent != 'e') {
+        ++exponent;
+    }
+    out_.append(buffer, exponent - buffer);
+    out_.push_back('E');
+
+    const char* digit = exponent + 1;
+    if (*digit == '-') {
+        out_.push_back('-');
+    }
+    ++digit;
+    while (digit + 1 < end && *digit == '0') {
+        ++digit;
+    }
+    out_.append(digit, end - digit);
+}
+
+void JsonWriter::WriteString(std::string_view value) {
+    static constexpr char hex[] = "0123456789abcdef";
+
+    out_.push_back('"');
+    // Символы, не требующие экранирования, копируются участками
+    size_t plain_start = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        const auto ch = static_cast<unsigned char>(value[i]);
+        if (ch >= 0x20 && ch != '"' && ch != '\\') {
+            continue;
+        }
+        out_.append(value.substr(plain_start, i - plain_start));
+        plain_start = i + 1;
+
+        out_.push_back('\\');
+        switch (ch) {
+        case '"':  out_.push_back('"');  break;
+        case '\\': out_.push_back('\\'); break;
+        case '\b': out_.push_back('b');  break;
+        case '\f': out_.push_back('f');  break;
+        case '\n': out_.push_back('n');  break;
+        case '\r': out_.push_back('r');  break;
+        case '\t': out_.push_back('t');  break;
+        default:
+            out_.append("u00"sv);
+            out_.push_back(hex[ch >> 4]);
+            out_.push_back(hex[ch & 0xF]);
+        }
+    }
+    out_.append(value.substr(plain_start));
+    out_.push_back('"');
+}
+
+}  // namespace util
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace util {
+
+/*
+ *  Потоковая запись JSON прямо в строку, без построения дерева boost::json::value.
+ *  Числа записываются через std::to_chars. Вывод совпадает байт в байт с boost::json::serialize:
+ *  вещественные числа записываются в кратчайшей экспоненциальной форме (1.5E1, 5E-1),
+ *  строки экранируются по тем же правилам.
+ *  Запятые между элементами расставляются автоматически, вложенность не проверяется.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) noexcept
+        : out_{out} {
+    }
+
+    JsonWriter& StartObject();
+    JsonWriter& EndObject();
+    JsonWriter& StartArray();
+    JsonWriter& EndArray();
+
+    JsonWriter& Key(std::string_view key);
+
+    // Числовой ключ записывается строкой без промежуточного std::to_string
+    template <typename T>
+        requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+    JsonWriter& Key(T key) {
+        Separate();
+        out_.push_back('"');
+        WriteInteger(key);
+        out_.append("\":");
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& Value(std::string_view value);
+    JsonWriter& Value(const char* value) {
+        return Value(std::string_view{value});
+    }
+    JsonWriter& Value(double value);
+    JsonWriter& Value(bool value);
+
+    template <typename T>
+        requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+    JsonWriter& Value(T value) {
+        Separate();
+        WriteInteger(value);
+        need_comma_ = true;
+        return *this;
+    }
+
+    // Вставляет уже сериализованный JSON
+    JsonWriter& RawValue(std::string_view json);
+
+private:
+    void Separate() {
+        if (need_comma_) {
+            out_.push_back(',');
+        }
+    }
+
+    template <typename T>
+    void WriteInteger(T value) {
+        char buffer[24];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out_.append(buffer, end - buffer);
+    }
+
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+
+    std::string& out_;
+    bool need_comma_ = false;
+};
+
+}  // namespace util
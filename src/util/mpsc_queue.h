@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace util {
+
+/*
+ *  Очередь без блокировок для многих производителей и одного потребителя (алгоритм Вьюкова).
+ *  Push можно вызывать из любых потоков одновременно, Pop - только из одного потока.
+ *  Элемент, добавление которого ещё не завершилось, может быть не виден Pop;
+ *  он будет получен следующим вызовом.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue()
+        : head_{new Node}
+        , tail_{head_.load(std::memory_order_relaxed)} {
+    }
+
+    ~MpscQueue() {
+        while (Pop()) {
+        }
+        delete tail_;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void Push(T value) {
+        Node* node = new Node;
+        node->value.emplace(std::move(value));
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T> Pop() {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        if (!next) {
+            return std::nullopt;
+        }
+        // next становится новой заглушкой, а прежняя удаляется
+        std::optional<T> value = std::move(next->value);
+        next->value.reset();
+        delete tail_;
+        tail_ = next;
+        return value;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> value;
+    };
+
+    std::atomic<Node*> head_;  // последний добавленный элемент
+    Node* tail_;               // заглушка перед первым непрочитанным элементом
+};
+
+}  // namespace util
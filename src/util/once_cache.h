@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace util {
+
+/*
+ *  Значение, которое вычисляется не более одного раза, при первом обращении,
+ *  и затем разделяется всеми читателями без копирования.
+ *  Get можно вызывать из разных потоков одновременно.
+ */
+template <typename T>
+class OnceCache {
+public:
+    OnceCache() = default;
+
+    OnceCache(const OnceCache&) = delete;
+    OnceCache& operator=(const OnceCache&) = delete;
+
+    // Возвращает значение и признак попадания: false, если значение вычислено этим вызовом
+    template <typename Fn>
+    std::pair<std::shared_ptr<const T>, bool> Get(Fn&& make) const {
+        bool hit = true;
+        std::call_once(once_, [this, &make, &hit] {
+            value_ = std::make_shared<const T>(std::forward<Fn>(make)());
+            hit = false;
+        });
+        return {value_, hit};
+    }
+
+private:
+    mutable std::once_flag once_;
+    mutable std::shared_ptr<const T> value_;
+};
+
+// Счётчики обращений к кэшу
+struct CacheStats {
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+};
+
+}  // namespace util
@@ -0,0 +1,155 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace util {
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    threads = std::max(1u, threads);
+    queues_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        queues_.emplace_back(std::make_unique<Queue>());
+    }
+    // Очередь 0 принадлежит потоку, вызывающему ParallelFor
+    workers_.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) {
+        workers_.emplace_back([this, i] {
+            WorkerLoop(i);
+        });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+unsigned WorkStealingPool::GetThreadsCount() const noexcept {
+    return static_cast<unsigned>(queues_.size());
+}
+
+void WorkStealingPool::ParallelFor(size_t count, const Task& task) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard call_lock{call_mutex_};
+
+    {
+        // task_ и pending_ записываются до раскладки задач: поток, забравший задачу
+        // из очереди (под её мьютексом), уже видит их новые значения
+        std::lock_guard lock{mutex_};
+        pending_ = count;
+        task_ = &task;
+        error_ = nullptr;
+        const size_t threads = queues_.size();
+        for (size_t worker = 0; worker < threads; ++worker) {
+            std::lock_guard queue_lock{queues_[worker]->mutex};
+            queues_[worker]->tasks.clear();
+            for (size_t index = worker; index < count; index += threads) {
+                queues_[worker]->tasks.push_back(index);
+            }
+        }
+        ++generation_;
+    }
+    work_cv_.notify_all();
+
+    Drain(0);
+
+    std::exception_ptr error;
+    {
+        std::unique_lock lock{mutex_};
+        done_cv_.wait(lock, [this] {
+            return pending_ == 0 && active_workers_ == 0;
+        });
+        task_ = nullptr;
+        error = std::exchange(error_, nullptr);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkStealingPool::WorkerLoop(size_t worker) {
+    size_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock{mutex_};
+            work_cv_.wait(lock, [this, seen_generation] {
+                return stop_ || generation_ != seen_generation;
+            });
+            if (stop_) {
+                return;
+            }
+            seen_generation = generation_;
+            ++active_workers_;
+        }
+
+        Drain(worker);
+
+        {
+            std::lock_guard lock{mutex_};
+            --active_workers_;
+        }
+        done_cv_.notify_all();
+    }
+}
+
+void WorkStealingPool::Drain(size_t worker) {
+    std::optional<size_t> index = Pop(worker);
+    if (!index) {
+        index = Steal(worker);
+    }
+    while (index) {
+        try {
+            (*task_)(*index);
+        } catch (...) {
+            std::lock_guard lock{mutex_};
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+        if (pending_.fetch_sub(1) == 1) {
+            std::lock_guard lock{mutex_};
+            done_cv_.notify_all();
+        }
+
+        index = Pop(worker);
+        if (!index) {
+            index = Steal(worker);
+        }
+    }
+}
+
+std::optional<size_t> WorkStealingPool::Pop(size_t worker) {
+    Queue& queue = *queues_[worker];
+    std::lock_guard lock{queue.mutex};
+    if (queue.tasks.empty()) {
+        return std::nullopt;
+    }
+    size_t index = queue.tasks.back();
+    queue.tasks.pop_back();
+    return index;
+}
+
+std::optional<size_t> WorkStealingPool::Steal(size_t thief) {
+    const size_t threads = queues_.size();
+    for (size_t offset = 1; offset < threads; ++offset) {
+        Queue& queue = *queues_[(thief + offset) % threads];
+        std::lock_guard lock{queue.mutex};
+        if (!queue.tasks.empty()) {
+            size_t index = queue.tasks.front();
+            queue.tasks.pop_front();
+            return index;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace util
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Пул потоков с перехватом работы (work stealing).
+ *  У каждого потока своя очередь задач: поток берёт задачи с конца своей очереди,
+ *  а освободившийся поток забирает задачи с начала чужих очередей.
+ *  Вызывающий поток тоже выполняет задачи, поэтому пул из одного потока
+ *  не создаёт рабочих потоков и выполняет всё последовательно.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void(size_t index)>;
+
+    // threads - общее число потоков, включая вызывающий ParallelFor
+    explicit WorkStealingPool(unsigned threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned GetThreadsCount() const noexcept;
+
+    // Вызывает task(i) для каждого i из [0, count) и ждёт завершения всех вызовов.
+    // Если задачи бросили исключения, после завершения пробрасывается первое из них.
+    void ParallelFor(size_t count, const Task& task);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void WorkerLoop(size_t worker);
+    // Выполняет все доступные задачи, начиная со своей очереди
+    void Drain(size_t worker);
+    std::optional<size_t> Pop(size_t worker);
+    std::optional<size_t> Steal(size_t thief);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex call_mutex_;  // ParallelFor выполняется не более чем в одном потоке
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    const Task* task_ = nullptr;
+    size_t generation_ = 0;
+    size_t active_workers_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+
+    std::atomic<size_t> pending_{0};
+};
+
+}  // namespace util
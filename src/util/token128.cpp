@@ -0,0 +1,57 @@
+#include "token128.h"
+
+#include <array>
+
+namespace util::detail {
+
+namespace {
+
+// Значение шестнадцатеричной цифры или 0xFF для остальных символов
+constexpr std::array<std::uint8_t, 256> HEX_DIGITS = [] {
+    std::array<std::uint8_t, 256> digits{};
+    digits.fill(0xFF);
+    for (int i = 0; i < 10; ++i) {
+        digits['0' + i] = static_cast<std::uint8_t>(i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        digits['a' + i] = static_cast<std::uint8_t>(10 + i);
+        digits['A' + i] = static_cast<std::uint8_t>(10 + i);
+    }
+    return digits;
+}();
+
+constexpr std::string_view HEX_CHARS = "0123456789abcdef";
+
+constexpr size_t HEX_SIZE = 32;
+
+}  // namespace
+
+std::optional<Uint128> HexToUint128(std::string_view hex) noexcept {
+    if (hex.size() != HEX_SIZE) {
+        return std::nullopt;
+    }
+    // Ошибки накапливаются в старших битах invalid: внутри цикла нет ветвлений
+    std::uint64_t halves[2] = {0, 0};
+    std::uint8_t invalid = 0;
+    for (size_t i = 0; i < HEX_SIZE; ++i) {
+        const std::uint8_t digit = HEX_DIGITS[static_cast<unsigned char>(hex[i])];
+        invalid |= digit;
+        halves[i / 16] = (halves[i / 16] << 4) | (digit & 0x0F);
+    }
+    if (invalid & 0xF0) {
+        return std::nullopt;
+    }
+    return Uint128{halves[0], halves[1]};
+}
+
+std::string Uint128ToHex(const Uint128& value) {
+    std::string hex(HEX_SIZE, '0');
+    for (size_t i = 0; i < 16; ++i) {
+        const unsigned shift = static_cast<unsigned>(60 - 4 * i);
+        hex[i] = HEX_CHARS[(value.hi >> shift) & 0x0F];
+        hex[16 + i] = HEX_CHARS[(value.lo >> shift) & 0x0F];
+    }
+    return hex;
+}
+
+}  // namespace util::detail
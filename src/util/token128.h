@@ -0,0 +1,60 @@
+#pragma once
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "tagged.h"
+
+namespace util {
+
+struct Uint128 {
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+
+    auto operator<=>(const Uint128&) const = default;
+};
+
+namespace detail {
+
+// Ровно 32 шестнадцатеричные цифры в любом регистре, старшие разряды первыми
+std::optional<Uint128> HexToUint128(std::string_view hex) noexcept;
+// 32 шестнадцатеричные цифры в нижнем регистре, с ведущими нулями
+std::string Uint128ToHex(const Uint128& value);
+
+}  // namespace detail
+
+// 128-битный идентификатор, который передаётся по сети строкой из 32 шестнадцатеричных цифр
+template <typename Tag>
+class TaggedToken128 : public Tagged<Uint128, Tag> {
+public:
+    using Base = Tagged<Uint128, Tag>;
+    using Tagged<Uint128, Tag>::Tagged;
+
+    TaggedToken128()
+        : Base{Uint128{}} {
+    }
+
+    static std::optional<TaggedToken128> FromString(std::string_view hex) noexcept {
+        if (auto value = detail::HexToUint128(hex)) {
+            return TaggedToken128{*value};
+        }
+        return std::nullopt;
+    }
+
+    std::string ToString() const {
+        return detail::Uint128ToHex(**this);
+    }
+};
+
+}  // namespace util
+
+template <>
+struct std::hash<util::Uint128> {
+    size_t operator()(const util::Uint128& value) const noexcept {
+        // Перемешивание старшей половины, чтобы хеш зависел от обеих
+        return static_cast<size_t>(value.lo ^ (value.hi * 0x9E3779B97F4A7C15ull));
+    }
+};
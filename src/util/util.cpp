@@ -1,5 +1,8 @@
 #include "util.h"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <sstream>
 
 #include <climits>
@@ -75,4 +78,117 @@ std::queue<std::string_view> SplitIntoTokens(std::string_view str, char delimete
     return words;
 }
 
+// Отделяет строку параметров: "state?since=5" -> {"state", "since=5"}
+std::pair<std::string_view, std::string_view> SplitQuery(std::string_view target) {
+    const size_t pos = target.find('?');
+    if (pos == std::string_view::npos) {
+        return {target, {}};
+    }
+    return {target.substr(0, pos), target.substr(pos + 1)};
+}
+
+// Значение параметра из строки вида a=1&b=2; nullopt, если параметра нет
+std::optional<std::string_view> FindQueryParameter(std::string_view query, std::string_view name) {
+    while (!query.empty()) {
+        const size_t end = std::min(query.find('&'), query.size());
+        std::string_view item = query.substr(0, end);
+        if (item.size() > name.size() && item.starts_with(name) && item[name.size()] == '=') {
+            return item.substr(name.size() + 1);
+        }
+        query.remove_prefix(std::min(end + 1, query.size()));
+    }
+    return std::nullopt;
+}
+
+std::string MaskQueryParameter(std::string_view target, std::string_view name) {
+    auto [path, query] = SplitQuery(target);
+    if (!FindQueryParameter(query, name)) {
+        return std::string{target};
+    }
+    std::string result{path};
+    result += '?';
+    while (!query.empty()) {
+        const size_t end = std::min(query.find('&'), query.size());
+        std::string_view item = query.substr(0, end);
+        if (item.size() > name.size() && item.starts_with(name) && item[name.size()] == '=') {
+            result += item.substr(0, name.size() + 1);
+            result += "***"sv;
+        } else {
+            result += item;
+        }
+        if (end < query.size()) {
+            result += '&';
+        }
+        query.remove_prefix(std::min(end + 1, query.size()));
+    }
+    return result;
+}
+
+static std::string_view TrimSpaces(std::string_view str) {
+    const size_t begin = str.find_first_not_of(" \t"sv);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return str.substr(begin, str.find_last_not_of(" \t"sv) - begin + 1);
+}
+
+static bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char l, char r) {
+        return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+    });
+}
+
+// Вес диапазона из его параметров; nullopt, если q задан неверно
+static std::optional<double> ParseRangeWeight(std::string_view params) {
+    while (!params.empty()) {
+        const size_t end = std::min(params.find(';'), params.size());
+        const std::string_view param = TrimSpaces(params.substr(0, end));
+        params.remove_prefix(std::min(end + 1, params.size()));
+        if (param.size() < 2 || std::tolower(static_cast<unsigned char>(param[0])) != 'q' || param[1] != '=') {
+            continue;
+        }
+        const std::string_view value = param.substr(2);
+        double q = 0.;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), q);
+        if (ec != std::errc{} || ptr != value.data() + value.size() || q < 0. || q > 1.) {
+            return std::nullopt;
+        }
+        // Параметры после q относятся к расширениям Accept
+        return q;
+    }
+    return 1.;
+}
+
+MediaTypeWeight GetAcceptWeight(std::string_view accept, std::string_view type) {
+    const std::string_view main_type = type.substr(0, type.find('/'));
+    MediaTypeWeight result;
+    // 0 - */*, 1 - тип/*, 2 - тип/подтип
+    int best_precision = -1;
+    while (!accept.empty()) {
+        const size_t end = std::min(accept.find(','), accept.size());
+        const std::string_view range = accept.substr(0, end);
+        accept.remove_prefix(std::min(end + 1, accept.size()));
+
+        const size_t params = std::min(range.find(';'), range.size());
+        const std::string_view media_range = TrimSpaces(range.substr(0, params));
+        int precision = -1;
+        if (EqualsIgnoreCase(media_range, type)) {
+            precision = 2;
+        } else if (media_range == "*/*"sv) {
+            precision = 0;
+        } else if (media_range.ends_with("/*"sv) && EqualsIgnoreCase(media_range.substr(0, media_range.size() - 2), main_type)) {
+            precision = 1;
+        }
+        if (precision <= best_precision) {
+            continue;
+        }
+        // Диапазон с неверным весом пропускается
+        if (auto q = ParseRangeWeight(range.substr(params))) {
+            best_precision = precision;
+            result = {*q, precision == 2};
+        }
+    }
+    return result;
+}
+
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <filesystem>
 #include <optional>
 #include <queue>
+#include <string>
+#include <string_view>
+#include <utility>
 
 namespace util {
 
@@ -14,4 +17,21 @@ std::optional<std::string> DecodeURI(std::string_view encoded);
 
 std::queue<std::string_view> SplitIntoTokens(std::string_view str, char delimeter);
 
+// Отделяет строку параметров: "state?since=5" -> {"state", "since=5"}
+std::pair<std::string_view, std::string_view> SplitQuery(std::string_view target);
+
+// Значение параметра из строки вида a=1&b=2; nullopt, если параметра нет
+std::optional<std::string_view> FindQueryParameter(std::string_view query, std::string_view name);
+
+// Копия target, в которой значения параметра name заменены на "***": "ws?authToken=abc" -> "ws?authToken=***"
+std::string MaskQueryParameter(std::string_view target, std::string_view name);
+
+// Вес типа type ("тип/подтип") в заголовке Accept по самому точному подходящему диапазону (RFC 7231, 5.3.2).
+// q = 0 - тип не допускается, exact - тип назван явно, а не через '*'
+struct MediaTypeWeight {
+    double q = 0.;
+    bool exact = false;
+};
+MediaTypeWeight GetAcceptWeight(std::string_view accept, std::string_view type);
+
 }
\ No newline at end of file
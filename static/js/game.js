@@ -165,9 +165,12 @@ class GameState {
     this.disappearingLoot = {};
     this.player_elems = {};
 
+    this.stateSocket = undefined;
+
     this._updateState(function() {
       self.stateLoaded = true;
       self._startGame();
+      self._openStateSocket();
     });
     this._syncPlayers(function() {
       self.playersLoaded = true;
@@ -183,7 +186,9 @@ class GameState {
     if (!this.started)
       return false;
 
-    if ((this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress) {
+    // Пока открыт WebSocket, состояние приходит от сервера само
+    const socketOpen = this.stateSocket !== undefined && this.stateSocket.readyState === WebSocket.OPEN;
+    if (!socketOpen && (this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress) {
       this.requestInstantUpdate = false;
       this._updateState(function() {
         self._applyDesiredState();
@@ -424,6 +429,38 @@ class GameState {
     })
   }
 
+  _openStateSocket() {
+    if (typeof WebSocket === 'undefined')
+      return;
+
+    let self = this;
+    const protocol = window.location.protocol === 'https:' ? 'wss://' : 'ws://';
+    const socket = new WebSocket(protocol + window.location.host + '/api/v1/game/ws?authToken=' + Cookies.get('authToken'));
+    socket.onmessage = function(event) {
+      self._applyStateFrame(JSON.parse(event.data));
+    };
+    socket.onclose = function() {
+      // Возвращаемся к опросу /game/state
+      self.stateSocket = undefined;
+    };
+    this.stateSocket = socket;
+  }
+
+  _applyStateFrame(frame) {
+    if (frame.full) {
+      this.desiredState = {players: frame.players, lostObjects: frame.lostObjects};
+    }
+    else {
+      let players = Object.assign({}, this.desiredState.players, frame.players);
+      let lostObjects = Object.assign({}, this.desiredState.lostObjects, frame.lostObjects);
+      frame.removedPlayers.forEach(id => delete players[id]);
+      frame.removedLostObjects.forEach(id => delete lostObjects[id]);
+      this.desiredState = {players: players, lostObjects: lostObjects};
+    }
+    this.stateTime = performance.now();
+    this._applyDesiredState();
+  }
+
   _interpolateRotation(old_pos, new_pos) {
     const pi = Math.PI;
     const rot_speed = pi / 300;
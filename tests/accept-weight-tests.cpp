@@ -0,0 +1,49 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/util.h"
+
+using namespace std::literals;
+
+namespace {
+
+constexpr std::string_view BINARY = "application/x-bloodhound-bin"sv;
+
+}  // namespace
+
+SCENARIO("Accept header weights") {
+    GIVEN("a media range naming the type") {
+        THEN("its weight is taken from q, 1 by default") {
+            auto weight = util::GetAcceptWeight("application/x-bloodhound-bin"sv, BINARY);
+            CHECK(weight.q == 1.);
+            CHECK(weight.exact);
+            CHECK(util::GetAcceptWeight("text/html, application/x-bloodhound-bin;q=0.5"sv, BINARY).q == 0.5);
+            CHECK(util::GetAcceptWeight(" Application/X-Bloodhound-Bin ; Q=0.25 ; ext=1"sv, BINARY).q == 0.25);
+        }
+        THEN("q=0 excludes the type") {
+            CHECK(util::GetAcceptWeight("application/x-bloodhound-bin;q=0"sv, BINARY).q == 0.);
+            CHECK(util::GetAcceptWeight("application/x-bloodhound-bin; q=0.000, */*"sv, BINARY).q == 0.);
+        }
+        THEN("a range with an invalid weight is ignored") {
+            CHECK(util::GetAcceptWeight("application/x-bloodhound-bin;q=high"sv, BINARY).q == 0.);
+            CHECK(util::GetAcceptWeight("application/x-bloodhound-bin;q=2, application/*;q=0.3"sv, BINARY).q == 0.3);
+        }
+    }
+
+    GIVEN("wildcard ranges") {
+        THEN("the most specific range wins regardless of order") {
+            auto weight = util::GetAcceptWeight("*/*;q=0.1, application/*;q=0.2"sv, BINARY);
+            CHECK(weight.q == 0.2);
+            CHECK_FALSE(weight.exact);
+            CHECK(util::GetAcceptWeight("application/x-bloodhound-bin;q=0.9, application/*"sv, BINARY).q == 0.9);
+            CHECK(util::GetAcceptWeight("*/*"sv, BINARY).q == 1.);
+        }
+    }
+
+    GIVEN("ranges that do not match") {
+        THEN("the weight is 0") {
+            CHECK(util::GetAcceptWeight(""sv, BINARY).q == 0.);
+            CHECK(util::GetAcceptWeight("application/json, text/*"sv, BINARY).q == 0.);
+            CHECK(util::GetAcceptWeight("application/x-bloodhound-binary"sv, BINARY).q == 0.);
+        }
+    }
+}
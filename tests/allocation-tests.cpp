@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/model/model.h"
+
+// Подсчёт выделений памяти в куче: глобальные operator new заменяются на счётчик поверх malloc
+namespace {
+
+std::atomic<size_t> allocations_count{0};
+
+void* CountedAlloc(std::size_t size) {
+    ++allocations_count;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    return CountedAlloc(size);
+}
+
+void* operator new[](std::size_t size) {
+    return CountedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+using namespace std::literals;
+using namespace model;
+
+SCENARIO("Steady-state tick does not allocate") {
+    GIVEN("a session with 1000 running dogs and 1000 loot objects") {
+        constexpr size_t count = 1000;
+        constexpr double spacing = 10.;
+
+        Map map(Map::Id{"map"s}, "Map"s);
+        map.SetDogSpeed(1.).SetDogBagCapacity(3);
+        map.AddLootWorth(10);
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, static_cast<geom::Coord>(count * spacing * 2)});
+        map.AddOffice({Office::Id{"office"s}, {5, 100}, {0, 0}});
+
+        DogRetire on_retire;
+        GameSession session(&map, 0, false, {5s, 1.0}, 1'000'000, on_retire);
+        for (size_t i = 0; i < count; ++i) {
+            auto dog = session.GetDog(session.AddDog(Dog{Dog::Id{i}, "dog"s + std::to_string(i), {i * spacing, 0.}}));
+            dog.SetDirection(Dog::Direction::EAST);
+            dog.SetSpeed(map.GetDogSpeed());
+            // Трофеи лежат в стороне от дороги, поэтому их количество не меняется
+            session.AddLoot(LootObject{LootObject::Id{i}, 0, 10}, {i * spacing + spacing / 2, 50.});
+        }
+
+        // Прогрев: буферы стадии столкновений набирают ёмкость
+        for (int i = 0; i < 3; ++i) {
+            session.OnTick(10ms);
+        }
+
+        WHEN("the session ticks") {
+            const size_t before = allocations_count.load();
+            for (int i = 0; i < 10; ++i) {
+                session.OnTick(10ms);
+            }
+            const size_t allocations = allocations_count.load() - before;
+
+            THEN("no heap allocations are made") {
+                CHECK(allocations == 0);
+                CHECK(session.GetDogs().Size() == count);
+                CHECK(session.GetLootObjects().size() == count);
+                CHECK(session.GetDogs().At(0).GetCoordinates().x > 0.);
+            }
+        }
+    }
+}
+
+SCENARIO("Tick with gathering events does not allocate") {
+    GIVEN("dogs running over loot and offices on their road") {
+        constexpr size_t count = 200;
+        constexpr int lane = 100;
+        constexpr int loot_per_lane = 60;
+        constexpr int office_period = 5;
+
+        // Собака проходит единицу пути за тик: каждый тик она подбирает трофей,
+        // а каждые office_period тиков сдаёт рюкзак на базе
+        Map map(Map::Id{"map"s}, "Map"s);
+        map.SetDogSpeed(100.).SetDogBagCapacity(10);
+        map.AddLootWorth(10);
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, static_cast<geom::Coord>(count * lane)});
+        for (size_t i = 0; i < count; ++i) {
+            for (int x = office_period - 1; x < loot_per_lane; x += office_period) {
+                const auto id = "office"s + std::to_string(i) + "_"s + std::to_string(x);
+                map.AddOffice({Office::Id{id}, {static_cast<geom::Coord>(i * lane + x), 0}, {0, 0}});
+            }
+        }
+
+        DogRetire on_retire;
+        GameSession session(&map, 0, false, {5s, 1.0}, 1'000'000, on_retire);
+        size_t loot_id = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto dog = session.GetDog(session.AddDog(Dog{Dog::Id{i}, "dog"s + std::to_string(i), {double(i * lane), 0.}}));
+            dog.SetDirection(Dog::Direction::EAST);
+            dog.SetSpeed(map.GetDogSpeed());
+            for (int x = 0; x < loot_per_lane; ++x) {
+                session.AddLoot(LootObject{LootObject::Id{loot_id++}, 0, 10}, {i * lane + x + 0.5, 0.});
+            }
+        }
+
+        // Прогрев: буферы столкновений, событий и рюкзаков набирают ёмкость.
+        // События без подписчиков отбрасываются так же, как в Service::PublishEvents
+        auto tick = [&session] {
+            session.OnTick(10ms);
+            session.ClearEvents();
+        };
+        for (int i = 0; i < 20; ++i) {
+            tick();
+        }
+
+        WHEN("the session ticks") {
+            const size_t loot_before = session.GetLootObjects().size();
+            const size_t score_before = session.GetDogs().At(0).GetScores();
+            const size_t before = allocations_count.load();
+            for (int i = 0; i < 20; ++i) {
+                tick();
+            }
+            const size_t allocations = allocations_count.load() - before;
+
+            THEN("loot is collected and dropped without heap allocations") {
+                CHECK(allocations == 0);
+                // Каждая собака подбирает по трофею за тик
+                CHECK(loot_before - session.GetLootObjects().size() == 20 * count);
+                CHECK(session.GetDogs().At(0).GetScores() > score_before);
+            }
+        }
+
+        WHEN("a subscriber takes the events after every tick") {
+            // Как Service::PublishEvents: буфер подписчика обменивается с буфером сеанса
+            GameSession::Events taken;
+            size_t collected = 0;
+            auto take = [&session, &taken, &collected] {
+                session.OnTick(10ms);
+                session.TakeEvents(taken);
+                collected += std::count_if(taken.begin(), taken.end(), [](const SessionEvent& event) {
+                    return event.type == SessionEvent::Type::LOOT_COLLECTED;
+                });
+            };
+            // Оба буфера по очереди принимают и тики со сдачей рюкзаков, и без неё
+            for (int i = 0; i < 2 * office_period; ++i) {
+                take();
+            }
+            collected = 0;
+
+            const size_t before = allocations_count.load();
+            for (int i = 0; i < 15; ++i) {
+                take();
+            }
+            const size_t allocations = allocations_count.load() - before;
+
+            THEN("the events reach the subscriber without heap allocations") {
+                CHECK(allocations == 0);
+                CHECK(collected == 15 * count);
+            }
+        }
+    }
+}
@@ -0,0 +1,200 @@
+#include <charconv>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/handler/api_router.h"
+#include "../src/util/util.h"
+
+/*
+ *  Разбор цели запроса к API: прежний разбор (SplitIntoTokens в очередь, цепочки сравнений,
+ *  find и stoi для параметров рекордов) против MatchApiRoute.
+ *  Смесь запросов повторяет типичную нагрузку: в основном состояние игры и действия игроков.
+ *  Результаты обоих способов сравниваются для каждого запроса.
+ */
+
+namespace {
+
+using namespace std::literals;
+using namespace http_handler;
+using Clock = std::chrono::steady_clock;
+
+// То, что обработчик получает из цели запроса
+struct Resolved {
+    std::optional<ApiRoute> route;
+    std::string_view map_id;
+    std::optional<std::string_view> since;
+    int start = 0;
+    int max_items = 0;
+
+    bool operator==(const Resolved&) const = default;
+};
+
+int ExtractParameterValue(std::string_view api_token, std::string_view parameter) {
+    size_t start = api_token.find(parameter);
+    if (start == std::string::npos) {
+        return 0;
+    }
+    start += parameter.size();
+    if (start == api_token.size() || api_token[start] != '=') {
+        throw std::runtime_error("Value not found");
+    }
+    size_t end = api_token.find_first_of('&', start);
+    if (end == std::string::npos) {
+        end = api_token.size();
+    }
+    return std::stoi(std::string{api_token.substr(start + 1, end - start)});
+}
+
+// Прежний разбор из ApiHandler::HandleRequest, HandleMapsRequest и HandleGameRequest
+Resolved ResolveTokens(std::string_view target) {
+    Resolved result;
+    auto tokens = util::SplitIntoTokens(target, '/');
+    if (tokens.empty() || tokens.front() != "api"sv) {
+        return result;
+    }
+    tokens.pop();
+    if (tokens.empty() || tokens.front() != "v1"sv) {
+        return result;
+    }
+    tokens.pop();
+    if (tokens.empty()) {
+        return result;
+    }
+    auto token = tokens.front(); tokens.pop();
+    if (token == "maps"sv) {
+        if (tokens.empty()) {
+            result.route = ApiRoute::AllMaps;
+        } else {
+            result.map_id = tokens.front(); tokens.pop();
+            if (tokens.empty()) {
+                result.route = ApiRoute::SingleMap;
+            }
+        }
+        return result;
+    }
+    if (token != "game"sv || tokens.empty()) {
+        return result;
+    }
+    auto api_token = tokens.front(); tokens.pop();
+    if (api_token == "join"sv && tokens.empty()) {
+        result.route = ApiRoute::Join;
+    } else if (api_token == "players"sv && tokens.empty()) {
+        result.route = ApiRoute::Players;
+    } else if (auto [path, query] = util::SplitQuery(api_token); path == "state"sv && tokens.empty()) {
+        result.route = ApiRoute::State;
+        result.since = util::FindQueryParameter(query, "since"sv);
+    } else if (api_token == "player"sv && !tokens.empty()) {
+        api_token = tokens.front(); tokens.pop();
+        if (api_token == "action"sv && tokens.empty()) {
+            result.route = ApiRoute::PlayerAction;
+        }
+    } else if (api_token == "batch"sv && tokens.empty()) {
+        result.route = ApiRoute::Batch;
+    } else if (api_token == "tick"sv && tokens.empty()) {
+        result.route = ApiRoute::Tick;
+    } else if (api_token.starts_with("records"sv)) {
+        result.route = ApiRoute::Records;
+        result.start = ExtractParameterValue(api_token, "start"sv);
+        result.max_items = ExtractParameterValue(api_token, "maxItems"sv);
+    }
+    return result;
+}
+
+Resolved ResolveRouter(std::string_view target) {
+    Resolved result;
+    auto match = MatchApiRoute(target);
+    if (!match) {
+        return result;
+    }
+    result.route = match->Route();
+    result.map_id = match->wildcard;
+    result.since = match->Parameter(QueryParameter::Since);
+    auto to_int = [](const std::optional<std::string_view>& value) {
+        int number = 0;
+        if (value) {
+            std::from_chars(value->data(), value->data() + value->size(), number);
+        }
+        return number;
+    };
+    result.start = to_int(match->Parameter(QueryParameter::Start));
+    result.max_items = to_int(match->Parameter(QueryParameter::MaxItems));
+    return result;
+}
+
+std::vector<std::string> MakeTargets(size_t count, std::mt19937& rng) {
+    // Цель запроса и её доля в нагрузке
+    const std::vector<std::pair<std::string, int>> mix{
+        {"/api/v1/game/state", 35},
+        {"/api/v1/game/state?since=1234", 10},
+        {"/api/v1/game/player/action", 30},
+        {"/api/v1/game/players", 5},
+        {"/api/v1/maps/map1", 8},
+        {"/api/v1/maps", 2},
+        {"/api/v1/game/records?start=20&maxItems=50", 5},
+        {"/api/v1/game/join", 3},
+        {"/api/v1/game/tick", 2},
+    };
+    std::vector<int> weights;
+    for (const auto& [target, weight] : mix) {
+        weights.push_back(weight);
+    }
+    std::discrete_distribution<size_t> pick{weights.begin(), weights.end()};
+
+    std::vector<std::string> targets;
+    targets.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        targets.push_back(mix[pick(rng)].first);
+    }
+    return targets;
+}
+
+template <typename Fn>
+std::chrono::duration<double, std::nano> Measure(Fn&& fn, const std::vector<std::string>& targets,
+                                                 size_t& checksum, int repeats) {
+    auto best = std::chrono::duration<double, std::nano>::max();
+    for (int i = 0; i < repeats; ++i) {
+        checksum = 0;
+        auto start = Clock::now();
+        for (const auto& target : targets) {
+            Resolved resolved = fn(target);
+            checksum += static_cast<size_t>(resolved.route.value_or(ApiRoute::AllMaps)) + resolved.map_id.size()
+                      + static_cast<size_t>(resolved.start + resolved.max_items);
+        }
+        best = std::min<std::chrono::duration<double, std::nano>>(best, Clock::now() - start);
+    }
+    return best / targets.size();
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng{2024};
+    const auto targets = MakeTargets(100'000, rng);
+
+    for (const auto& target : targets) {
+        if (ResolveTokens(target) != ResolveRouter(target)) {
+            std::cerr << "Route mismatch for "sv << target << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    size_t tokens_checksum = 0;
+    size_t router_checksum = 0;
+    auto tokens = Measure(ResolveTokens, targets, tokens_checksum, 10);
+    auto router = Measure(ResolveRouter, targets, router_checksum, 10);
+
+    std::cout << std::setw(10) << "requests" << std::setw(16) << "tokens, ns" << std::setw(16) << "router, ns"
+              << std::setw(12) << "speedup" << std::endl;
+    std::cout << std::setw(10) << targets.size() << std::setw(16) << tokens.count() << std::setw(16) << router.count()
+              << std::setw(12) << tokens / router << std::endl;
+    if (tokens_checksum != router_checksum) {
+        std::cerr << "Checksum mismatch"sv << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/handler/api_router.h"
+
+using namespace std::literals;
+using namespace http_handler;
+
+SCENARIO("API router") {
+    GIVEN("paths of every route") {
+        THEN("each path resolves to its route") {
+            CHECK(MatchApiRoute("/api/v1/maps"sv)->Route() == ApiRoute::AllMaps);
+            CHECK(MatchApiRoute("/api/v1/maps/map1"sv)->Route() == ApiRoute::SingleMap);
+            CHECK(MatchApiRoute("/api/v1/game/join"sv)->Route() == ApiRoute::Join);
+            CHECK(MatchApiRoute("/api/v1/game/players"sv)->Route() == ApiRoute::Players);
+            CHECK(MatchApiRoute("/api/v1/game/state"sv)->Route() == ApiRoute::State);
+            CHECK(MatchApiRoute("/api/v1/game/player/action"sv)->Route() == ApiRoute::PlayerAction);
+            CHECK(MatchApiRoute("/api/v1/game/batch"sv)->Route() == ApiRoute::Batch);
+            CHECK(MatchApiRoute("/api/v1/game/tick"sv)->Route() == ApiRoute::Tick);
+            CHECK(MatchApiRoute("/api/v1/game/records"sv)->Route() == ApiRoute::Records);
+            CHECK(MatchApiRoute("/api/v1/game/ws?authToken=abc"sv)->Route() == ApiRoute::StateStream);
+            CHECK(MatchApiRoute("/api/v1/game/events"sv)->Route() == ApiRoute::Events);
+        }
+        THEN("repeated and trailing slashes are ignored") {
+            CHECK(MatchApiRoute("//api/v1//maps/"sv)->Route() == ApiRoute::AllMaps);
+        }
+        THEN("the wildcard segment is captured") {
+            auto match = MatchApiRoute("/api/v1/maps/town?x=1"sv);
+            REQUIRE(match);
+            CHECK(match->wildcard == "town"sv);
+        }
+    }
+
+    GIVEN("paths outside the route table") {
+        THEN("they are not matched") {
+            CHECK_FALSE(MatchApiRoute(""sv));
+            CHECK_FALSE(MatchApiRoute("/api/v1"sv));
+            CHECK_FALSE(MatchApiRoute("/api/v2/maps"sv));
+            CHECK_FALSE(MatchApiRoute("/api/v1/maps/town/roads"sv));
+            CHECK_FALSE(MatchApiRoute("/api/v1/game/player"sv));
+            CHECK_FALSE(MatchApiRoute("/api/v1/game/recordsX"sv));
+            CHECK_FALSE(MatchApiRoute("/index.html"sv));
+        }
+    }
+
+    GIVEN("a query string") {
+        auto match = MatchApiRoute("/api/v1/game/records?maxItems=10&foo=bar&start=5&start=7&since"sv);
+        REQUIRE(match);
+        THEN("known parameters are collected, the first occurrence wins") {
+            CHECK(match->Parameter(QueryParameter::Start) == "5"sv);
+            CHECK(match->Parameter(QueryParameter::MaxItems) == "10"sv);
+            CHECK(MatchApiRoute("/api/v1/game/ws?authToken=abc"sv)->Parameter(QueryParameter::AuthToken) == "abc"sv);
+        }
+        THEN("missing parameters and parameters without a value are absent") {
+            CHECK_FALSE(match->Parameter(QueryParameter::Radius));
+            CHECK_FALSE(match->Parameter(QueryParameter::Since));
+        }
+    }
+
+    GIVEN("targets inside and outside the API") {
+        THEN("only targets whose first segment is api belong to the API") {
+            CHECK(IsApiTarget("/api"sv));
+            CHECK(IsApiTarget("//api/v1/unknown"sv));
+            CHECK(IsApiTarget("/api?x=1"sv));
+            CHECK_FALSE(IsApiTarget(""sv));
+            CHECK_FALSE(IsApiTarget("/"sv));
+            CHECK_FALSE(IsApiTarget("/apis/v1"sv));
+            CHECK_FALSE(IsApiTarget("/index.html?api"sv));
+            CHECK_FALSE(IsApiTarget("/static/api"sv));
+        }
+    }
+
+    GIVEN("a matched route") {
+        THEN("only the methods of the route are allowed") {
+            auto state = MatchApiRoute("/api/v1/game/state"sv);
+            CHECK(state->IsMethodAllowed(http::verb::get));
+            CHECK(state->IsMethodAllowed(http::verb::head));
+            CHECK_FALSE(state->IsMethodAllowed(http::verb::post));
+
+            auto join = MatchApiRoute("/api/v1/game/join"sv);
+            CHECK(join->IsMethodAllowed(http::verb::post));
+            CHECK_FALSE(join->IsMethodAllowed(http::verb::get));
+            CHECK_FALSE(join->IsMethodAllowed(http::verb::unknown));
+        }
+    }
+}
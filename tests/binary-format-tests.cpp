@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/handler/binary_format.h"
+
+using namespace std::literals;
+
+namespace {
+
+std::string Bytes(std::initializer_list<uint8_t> bytes) {
+    std::string out;
+    for (uint8_t byte : bytes) {
+        out.push_back(static_cast<char>(byte));
+    }
+    return out;
+}
+
+}  // namespace
+
+// Ожидаемые байты расписаны по полям формата из binary_format.h
+SCENARIO("Binary format") {
+    GIVEN("a game state with one dog and one lost object") {
+        service::UseCaseGetGameState::GameState state;
+        state.tick = 42;
+        state.players.push_back({model::Dog::Id{5}, {1.5, 2.}, {0., -1.}, model::Dog::Direction::WEST, {{300, 1}}, 7});
+        state.loot_objects.push_back({model::LootObject::Id{2}, 3, {0.25, 4.}});
+
+        THEN("it is encoded field by field") {
+            CHECK(http_handler::EncodeGameState(state) == Bytes({
+                'B', 'H', 1, 1,
+                1,                          // собак
+                5,                          // id
+                0x00, 0x00, 0xC0, 0x3F,     // x = 1.5
+                0x00, 0x00, 0x00, 0x40,     // y = 2
+                0x00, 0x00, 0x00, 0x00,     // vx = 0
+                0x00, 0x00, 0x80, 0xBF,     // vy = -1
+                2,                          // направление L
+                1, 0xAC, 0x02, 1,           // рюкзак: id 300, тип 1
+                7,                          // очки
+                1,                          // потерянных предметов
+                2, 3,                       // id, тип
+                0x00, 0x00, 0x80, 0x3E,     // x = 0.25
+                0x00, 0x00, 0x80, 0x40,     // y = 4
+            }));
+        }
+    }
+
+    GIVEN("a map with roads of both orientations, a building and an office") {
+        model::Map map(model::Map::Id{"m"s}, "M"s);
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+        map.AddRoad({model::Road::VERTICAL, {-3, 2}, 5});
+        map.AddBuilding(model::Building{{{1, 2}, {3, 4}}});
+        map.AddOffice({model::Office::Id{"o"s}, {5, -1}, {1, -2}});
+        extra_data::ExtraData extra_data;
+        extra_data.map_id_to_loot_types.emplace(map.GetId(), "[]"s);
+
+        THEN("it is encoded field by field") {
+            CHECK(http_handler::EncodeMap(map, extra_data) == Bytes({
+                'B', 'H', 1, 2,
+                1, 'm', 1, 'M',             // id, название
+                2, '[', ']',                // типы трофеев
+                2,                          // дорог
+                0, 0, 1, 20,                // (0, 0), горизонтальная, x1 = 10
+                5, 4, 0, 10,                // (-3, 2), вертикальная, y1 = 5
+                1,                          // зданий
+                2, 4, 6, 8,                 // x = 1, y = 2, w = 3, h = 4
+                1,                          // офисов
+                1, 'o', 10, 1, 2, 3,        // id, x = 5, y = -1, offsetX = 1, offsetY = -2
+            }));
+        }
+    }
+}
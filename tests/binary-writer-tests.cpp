@@ -0,0 +1,58 @@
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/binary_writer.h"
+
+using namespace std::literals;
+
+namespace {
+
+std::string Bytes(std::initializer_list<uint8_t> bytes) {
+    std::string out;
+    for (uint8_t byte : bytes) {
+        out.push_back(static_cast<char>(byte));
+    }
+    return out;
+}
+
+}  // namespace
+
+SCENARIO("Binary writer") {
+    std::string out;
+    util::BinaryWriter writer{out};
+
+    GIVEN("unsigned integers") {
+        THEN("they are written as little-endian varints") {
+            writer.VarUint(0).VarUint(127).VarUint(128).VarUint(300);
+            CHECK(out == Bytes({0x00, 0x7F, 0x80, 0x01, 0xAC, 0x02}));
+        }
+        THEN("the largest value takes ten bytes") {
+            writer.VarUint(std::numeric_limits<uint64_t>::max());
+            CHECK(out == Bytes({0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01}));
+        }
+    }
+
+    GIVEN("signed integers") {
+        THEN("small magnitudes of both signs stay short after zigzag") {
+            writer.VarInt(0).VarInt(-1).VarInt(1).VarInt(-2).VarInt(-64).VarInt(64);
+            CHECK(out == Bytes({0x00, 0x01, 0x02, 0x03, 0x7F, 0x80, 0x01}));
+        }
+        THEN("extreme values round-trip through zigzag") {
+            writer.VarInt(std::numeric_limits<int64_t>::min());
+            CHECK(out == Bytes({0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01}));
+        }
+    }
+
+    GIVEN("floats and strings") {
+        writer.Float32(1.5f).Float32(-2.f).String("dog"sv).U8(0xAB);
+
+        THEN("floats are IEEE 754 little-endian and strings are length-prefixed") {
+            CHECK(out == Bytes({0x00, 0x00, 0xC0, 0x3F,
+                                0x00, 0x00, 0x00, 0xC0,
+                                0x03, 'd', 'o', 'g',
+                                0xAB}));
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/model/collision_detector.h"
+
+/*
+ *  Сравнение FindGatherEvents (сетка) с полным перебором.
+ *  Сущности делятся поровну между предметами и собирателями, плотность постоянна:
+ *  сторона карты растёт как корень из количества сущностей.
+ *  Собиратели двигаются вдоль осей на расстояние, проходимое собакой за тик.
+ */
+
+namespace {
+
+using namespace std::literals;
+using Clock = std::chrono::steady_clock;
+
+constexpr double ENTITIES_PER_CELL = 0.5;
+constexpr double MAX_STEP = 0.5;
+
+collision_detector::VectorItemGathererProvider MakeProvider(size_t entities, std::mt19937& rng) {
+    const double side = std::sqrt(entities / ENTITIES_PER_CELL);
+    std::uniform_real_distribution<double> coord{0., side};
+    std::uniform_real_distribution<double> step{-MAX_STEP, MAX_STEP};
+    std::bernoulli_distribution horizontal;
+
+    std::vector<collision_detector::Item> items;
+    std::vector<collision_detector::Gatherer> gatherers;
+    for (size_t i = 0; i < entities / 2; ++i) {
+        items.push_back({{coord(rng), coord(rng)}, 0.});
+    }
+    for (size_t i = 0; i < entities - entities / 2; ++i) {
+        geom::Vec2D start{coord(rng), coord(rng)};
+        geom::Vec2D end = horizontal(rng) ? geom::Vec2D{start.x + step(rng), start.y}
+                                          : geom::Vec2D{start.x, start.y + step(rng)};
+        gatherers.push_back({start, end, 0.3});
+    }
+    return {items, gatherers};
+}
+
+template <typename Fn>
+std::chrono::duration<double, std::milli> Measure(Fn&& fn, size_t& events, int repeats) {
+    auto best = std::chrono::duration<double, std::milli>::max();
+    for (int i = 0; i < repeats; ++i) {
+        auto start = Clock::now();
+        events = fn().size();
+        best = std::min<std::chrono::duration<double, std::milli>>(best, Clock::now() - start);
+    }
+    return best;
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng{2024};
+    std::cout << std::setw(10) << "entities" << std::setw(16) << "brute, ms" << std::setw(16) << "grid, ms"
+              << std::setw(12) << "speedup" << std::setw(10) << "events" << std::endl;
+
+    for (size_t entities : {1'000u, 10'000u, 100'000u}) {
+        auto provider = MakeProvider(entities, rng);
+        // Полный перебор на 100k занимает больше минуты, поэтому меряем его один раз
+        const int brute_repeats = entities >= 100'000 ? 1 : 5;
+
+        size_t brute_events = 0;
+        size_t grid_events = 0;
+        auto brute = Measure([&] { return collision_detector::FindGatherEventsBruteForce(provider); },
+                             brute_events, brute_repeats);
+        auto grid = Measure([&] { return collision_detector::FindGatherEvents(provider); }, grid_events, 5);
+
+        std::cout << std::setw(10) << entities << std::setw(16) << brute.count() << std::setw(16) << grid.count()
+                  << std::setw(12) << brute / grid << std::setw(10) << grid_events << std::endl;
+        if (brute_events != grid_events) {
+            std::cerr << "Event count mismatch: "sv << brute_events << " vs "sv << grid_events << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+}
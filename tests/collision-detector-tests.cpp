@@ -2,6 +2,7 @@
 
 #include <cmath>
 #include <functional>
+#include <random>
 #include <sstream>
 
 #include <catch2/catch_test_macros.hpp>
@@ -162,4 +163,145 @@ SCENARIO("Collision detection") {
             CHECK(events.empty());
         }
     }       
+}
+
+SCENARIO("Grid broad phase matches brute force") {
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<double> coord{0., 50.};
+    std::uniform_real_distribution<double> step{-3., 3.};
+    std::uniform_real_distribution<double> width{0., 0.5};
+
+    for (size_t count : {5u, 40u, 300u}) {
+        std::vector<collision_detector::Item> items;
+        for (size_t i = 0; i < count; ++i) {
+            items.push_back({{coord(rng), coord(rng)}, width(rng)});
+        }
+        // Несколько предметов в одной точке и на одной линии
+        items.push_back({{10., 10.}, 0.});
+        items.push_back({{10., 10.}, 0.25});
+        items.push_back({{10., 20.}, 0.});
+
+        std::vector<collision_detector::Gatherer> gatherers;
+        for (size_t g = 0; g < count; ++g) {
+            geom::Vec2D start{coord(rng), coord(rng)};
+            gatherers.push_back({start, {start.x + step(rng), start.y + step(rng)}, width(rng)});
+        }
+        gatherers.push_back({{10., 5.}, {10., 25.}, 0.3});
+        gatherers.push_back({{-100., 10.}, {100., 10.}, 0.3});
+        gatherers.push_back({{7., 7.}, {7., 7.}, 0.3});
+
+        collision_detector::VectorItemGathererProvider provider{items, gatherers};
+        WHEN("events are searched among " + std::to_string(count) + " items and gatherers") {
+            auto expected = collision_detector::FindGatherEventsBruteForce(provider);
+            auto events = collision_detector::FindGatherEvents(provider);
+            THEN("grid finds the same events in the same order") {
+                CHECK_FALSE(expected.empty());
+                CHECK_THAT(events, EqualsRange(expected, CompareEvents()));
+            }
+        }
+    }
+}
+
+SCENARIO("Events with equal time") {
+    // Все собиратели идут одной дорогой через одну точку, где лежат все предметы:
+    // время у всех событий одинаковое
+    std::vector<collision_detector::Item> items(40, {{10., 10.}, 0.1});
+    std::vector<collision_detector::Gatherer> gatherers(40, {{0., 10.}, {20., 10.}, 0.3});
+    collision_detector::VectorItemGathererProvider provider{items, gatherers};
+
+    WHEN("events are searched by the grid and by brute force") {
+        auto expected = collision_detector::FindGatherEventsBruteForce(provider);
+        auto events = collision_detector::FindGatherEvents(provider);
+        THEN("both are ordered by item and then by gatherer") {
+            REQUIRE(expected.size() == items.size() * gatherers.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                CHECK(expected[i].item_id == i / gatherers.size());
+                CHECK(expected[i].gatherer_id == i % gatherers.size());
+            }
+            CHECK_THAT(events, EqualsRange(expected, CompareEvents()));
+        }
+    }
+}
+
+SCENARIO("Batched narrow phase") {
+    std::mt19937 rng{7};
+    std::uniform_real_distribution<double> coord{-5., 5.};
+    std::uniform_real_distribution<double> width{0., 1.};
+
+    GIVEN("items stored as structure of arrays") {
+        // Нечётный размер, чтобы задеть скалярный хвост векторных ядер
+        constexpr size_t count = 1003;
+        std::vector<double> xs, ys, widths;
+        std::vector<size_t> ids;
+        for (size_t i = 0; i < count; ++i) {
+            xs.push_back(coord(rng));
+            ys.push_back(coord(rng));
+            widths.push_back(width(rng));
+            ids.push_back(i * 10);
+        }
+        collision_detector::ItemsBatch batch{xs.data(), ys.data(), widths.data(), ids.data(), count};
+        const std::vector<collision_detector::Gatherer> gatherers{
+            {{-4., 0.}, {4., 0.}, 0.6},
+            {{1., -3.}, {1., 2.5}, 0.3},
+            {{-2., -2.}, {3., 3.}, 0.},
+        };
+
+        for (size_t g = 0; g < gatherers.size(); ++g) {
+            const auto& gatherer = gatherers[g];
+            WHEN("gatherer " + std::to_string(g) + " is tested against the batch") {
+                std::vector<collision_detector::GatheringEvent> events;
+                collision_detector::CollectBatch(gatherer, g, batch, events);
+
+                THEN("events equal the scalar TryCollectPoint results") {
+                    std::vector<collision_detector::GatheringEvent> expected;
+                    for (size_t i = 0; i < count; ++i) {
+                        auto result = collision_detector::TryCollectPoint(gatherer.start_pos, gatherer.end_pos, {xs[i], ys[i]});
+                        if (result.IsCollected(gatherer.width + widths[i])) {
+                            expected.push_back({ids[i], g, result.sq_distance, result.proj_ratio});
+                        }
+                    }
+                    CHECK_FALSE(expected.empty());
+                    CHECK_THAT(events, EqualsRange(expected, CompareEvents()));
+                }
+            }
+        }
+        WHEN("gatherer stays put") {
+            std::vector<collision_detector::GatheringEvent> events;
+            collision_detector::CollectBatch({{0., 0.}, {0., 0.}, 10.}, 0, batch, events);
+            THEN("nothing is collected") {
+                CHECK(events.empty());
+            }
+        }
+    }
+}
+
+SCENARIO("Compile-time provider") {
+    static_assert(collision_detector::ItemGathererSource<collision_detector::SpanItemGathererProvider>);
+    static_assert(collision_detector::ItemGathererSource<collision_detector::ItemGathererProvider>);
+
+    std::mt19937 rng{11};
+    std::uniform_real_distribution<double> coord{0., 30.};
+    std::uniform_real_distribution<double> step{-2., 2.};
+
+    GIVEN("items and gatherers in plain vectors") {
+        std::vector<collision_detector::Item> items;
+        std::vector<collision_detector::Gatherer> gatherers;
+        for (size_t i = 0; i < 200; ++i) {
+            items.push_back({{coord(rng), coord(rng)}, 0.});
+            geom::Vec2D start{coord(rng), coord(rng)};
+            gatherers.push_back({start, {start.x + step(rng), start.y}, 0.6});
+        }
+        WHEN("events are searched through spans and through the virtual interface") {
+            const collision_detector::SpanItemGathererProvider span_provider{items, gatherers};
+            const collision_detector::VectorItemGathererProvider vector_provider{items, gatherers};
+            const collision_detector::ItemGathererProvider& virtual_provider = vector_provider;
+
+            auto span_events = collision_detector::FindGatherEvents(span_provider);
+            auto virtual_events = collision_detector::FindGatherEvents(virtual_provider);
+            THEN("results are the same") {
+                CHECK_FALSE(span_events.empty());
+                CHECK_THAT(span_events, EqualsRange(virtual_events, CompareEvents()));
+            }
+        }
+    }
 }
\ No newline at end of file
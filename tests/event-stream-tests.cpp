@@ -0,0 +1,41 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/handler/event_stream.h"
+
+using namespace std::literals;
+
+SCENARIO("Tick events encoding") {
+    using model::SessionEvent;
+    using service::Service;
+
+    GIVEN("a tick without sessions") {
+        THEN("only the tick event is written") {
+            CHECK(http_handler::EncodeTickEvents(100ms, {}) ==
+                  "event: tick\ndata: {\"timeDelta\":100,\"sessions\":[]}\n\n"s);
+        }
+    }
+
+    GIVEN("two sessions with events of every type") {
+        Service::TickEvents events;
+        events.push_back({model::GameSession::Id{0}, model::Map::Id{"map1"s}, 2, 5, {
+            SessionEvent{.type = SessionEvent::Type::JOIN, .dog = model::Dog::Id{3}, .name = "Rex \"the dog\""s},
+            SessionEvent{.type = SessionEvent::Type::LOOT_COLLECTED, .dog = model::Dog::Id{1},
+                         .loot = model::LootObject::Id{7}, .loot_type = 2},
+        }});
+        events.push_back({model::GameSession::Id{1}, model::Map::Id{"map2"s}, 0, 1, {
+            SessionEvent{.type = SessionEvent::Type::LOOT_DROPPED, .dog = model::Dog::Id{4}, .items = 3, .score_change = 30},
+            SessionEvent{.type = SessionEvent::Type::RETIRE, .dog = model::Dog::Id{4}},
+        }});
+
+        THEN("session events follow in order and the tick event summarizes the sessions") {
+            CHECK(http_handler::EncodeTickEvents(50ms, events) ==
+                  "event: join\ndata: {\"session\":0,\"mapId\":\"map1\",\"dog\":3,\"name\":\"Rex \\\"the dog\\\"\"}\n\n"
+                  "event: lootCollected\ndata: {\"session\":0,\"mapId\":\"map1\",\"dog\":1,\"lootId\":7,\"type\":2}\n\n"
+                  "event: lootDropped\ndata: {\"session\":1,\"mapId\":\"map2\",\"dog\":4,\"items\":3,\"scoreChange\":30}\n\n"
+                  "event: retire\ndata: {\"session\":1,\"mapId\":\"map2\",\"dog\":4}\n\n"
+                  "event: tick\ndata: {\"timeDelta\":50,\"sessions\":["
+                  "{\"session\":0,\"mapId\":\"map1\",\"dogs\":2,\"lostObjects\":5},"
+                  "{\"session\":1,\"mapId\":\"map2\",\"dogs\":0,\"lostObjects\":1}]}\n\n"s);
+        }
+    }
+}
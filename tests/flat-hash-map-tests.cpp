@@ -0,0 +1,81 @@
+#include <random>
+#include <unordered_map>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/flat_hash_map.h"
+
+namespace {
+// Все ключи попадают в одну цепочку, чтобы проверить сдвиг при удалении
+struct CollidingHasher {
+    size_t operator()(int key) const {
+        return static_cast<size_t>(key) % 4 + 14;
+    }
+};
+}  // namespace
+
+SCENARIO("Flat hash map") {
+    GIVEN("an empty map") {
+        util::FlatHashMap<int, int> map;
+        THEN("nothing is found") {
+            CHECK(map.Size() == 0);
+            CHECK(map.Find(1) == nullptr);
+            CHECK_FALSE(map.Erase(1));
+        }
+
+        WHEN("a key is inserted twice") {
+            CHECK(map.Insert(1, 10));
+            CHECK_FALSE(map.Insert(1, 20));
+            THEN("the first value is kept") {
+                REQUIRE(map.Find(1));
+                CHECK(*map.Find(1) == 10);
+                CHECK(map.Size() == 1);
+            }
+        }
+    }
+
+    GIVEN("a chain that wraps around the end of the table") {
+        util::FlatHashMap<int, int, CollidingHasher> map;
+        for (int key = 0; key < 8; ++key) {
+            map.Insert(key, key * 10);
+        }
+        WHEN("keys in the middle of the chain are erased") {
+            CHECK(map.Erase(0));
+            CHECK(map.Erase(5));
+            THEN("the rest are still found") {
+                CHECK(map.Size() == 6);
+                for (int key : {1, 2, 3, 4, 6, 7}) {
+                    REQUIRE(map.Find(key));
+                    CHECK(*map.Find(key) == key * 10);
+                }
+                CHECK(map.Find(0) == nullptr);
+                CHECK(map.Find(5) == nullptr);
+            }
+        }
+    }
+
+    GIVEN("random inserts and erases") {
+        util::FlatHashMap<int, int> map;
+        std::unordered_map<int, int> expected;
+        std::mt19937 rng{42};
+        std::uniform_int_distribution<int> keys{0, 500};
+
+        for (int i = 0; i < 20000; ++i) {
+            const int key = keys(rng);
+            if (rng() % 3 == 0) {
+                CHECK(map.Erase(key) == (expected.erase(key) == 1));
+            } else {
+                CHECK(map.Insert(key, i) == expected.emplace(key, i).second);
+            }
+        }
+        THEN("the map holds the same elements as std::unordered_map") {
+            CHECK(map.Size() == expected.size());
+            size_t visited = 0;
+            map.ForEach([&](int key, int value) {
+                ++visited;
+                REQUIRE(expected.contains(key));
+                CHECK(expected.at(key) == value);
+            });
+            CHECK(visited == expected.size());
+        }
+    }
+}
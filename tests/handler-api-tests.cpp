@@ -0,0 +1,151 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/json.hpp>
+
+#include "../src/handler/handler_api.h"
+
+#include <stdexcept>
+
+using namespace std::literals;
+using namespace http_handler;
+
+namespace {
+
+// Рекорды в этих тестах не сохраняются
+class NullDatabase : public repository::Database, public repository::SaveScoresFactory {
+public:
+    repository::SaveScoresFactory& GetSaveScoresFactory() override {
+        return *this;
+    }
+    std::unique_ptr<service::SaveScores> CreateSaveScores() override {
+        throw std::logic_error{"No database in tests"};
+    }
+};
+
+http::request<http::string_body> MakePostRequest(const std::string& target, std::string body) {
+    http::request<http::string_body> req{http::verb::post, target, 11};
+    req.set(http::field::content_type, ContentType::APPLICATION_JSON);
+    req.body() = std::move(body);
+    req.prepare_payload();
+    return req;
+}
+
+http::request<http::string_body> MakeGetRequest(const std::string& target, std::string_view accept) {
+    http::request<http::string_body> req{http::verb::get, target, 11};
+    req.set(http::field::accept, accept);
+    return req;
+}
+
+// Тики приходят через API, поэтому обработчик отвечает до возврата из HandleRequest
+StringResponse Handle(const ApiHandler& handler, const http::request<http::string_body>& req) {
+    http_request::RequestData data(req);
+    ApiRequest api_req(data);
+    std::optional<ApiResponse> response;
+    handler.HandleRequest(api_req, [&response](ApiResponse&& result) {
+        response = std::move(result);
+    });
+    REQUIRE(response.has_value());
+    return std::get<StringResponse>(std::move(*response));
+}
+
+}  // namespace
+
+SCENARIO("Batch request") {
+    GIVEN("a game with one map and a joined player") {
+        model::Game game;
+        game.SetDogRetirementTime(100000);
+        game.SetLootGeneratorParams(5., 0.);
+        model::Map map(model::Map::Id{"map1"s}, "Map"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(1);
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+        game.AddMap(std::move(map));
+
+        NullDatabase db;
+        service::Service service{game, db};
+        extra_data::ExtraData extra_data;
+        ApiHandler handler{service, extra_data};
+
+        auto join = Handle(handler, MakePostRequest("/api/v1/game/join"s, R"({"userName": "Rex", "mapId": "map1"})"s));
+        REQUIRE(join.result() == http::status::ok);
+        const json::object joined = json::parse(join.body()).as_object();
+        const std::string token{joined.at("authToken").as_string()};
+        const int64_t player_id = joined.at("playerId").as_int64();
+
+        WHEN("a batch mixes moves, joins and invalid operations") {
+            json::array operations;
+            operations.push_back(json::object{{"authToken", token}, {"move", "R"}});
+            operations.push_back(json::object{{"userName", "Max"}, {"mapId", "map1"}});
+            operations.push_back(json::object{{"userName", "Bob"}, {"mapId", "unknown"}});
+            operations.push_back(json::object{{"authToken", "00000000000000000000000000000000"}, {"move", "L"}});
+            operations.push_back(json::object{{"authToken", token}, {"move", "X"}});
+            operations.push_back(42);
+            operations.push_back(json::object{{"userName", ""}, {"mapId", "map1"}});
+
+            auto response = Handle(handler, MakePostRequest("/api/v1/game/batch"s, json::serialize(operations)));
+
+            THEN("every operation gets its own status and error body") {
+                REQUIRE(response.result() == http::status::ok);
+                const json::array results = json::parse(response.body()).as_array();
+                REQUIRE(results.size() == operations.size());
+
+                CHECK(results[0].as_object().size() == 1);
+                CHECK(results[0].as_object().at("status").as_int64() == 200);
+
+                const json::object& new_player = results[1].as_object();
+                CHECK(new_player.at("status").as_int64() == 200);
+                CHECK(new_player.at("authToken").as_string().size() == 32);
+                CHECK(new_player.at("playerId").as_int64() != player_id);
+
+                auto check_error = [&results](size_t i, int64_t status, std::string_view code) {
+                    const json::object& result = results[i].as_object();
+                    CHECK(result.at("status").as_int64() == status);
+                    CHECK(result.at("error").as_object().at("code").as_string() == code);
+                };
+                check_error(2, 404, "mapNotFound"sv);
+                check_error(3, 401, "unknownToken"sv);
+                check_error(4, 400, "invalidArgument"sv);
+                check_error(5, 400, "badRequest"sv);
+                check_error(6, 400, "invalidArgument"sv);
+            }
+            THEN("the move is applied and the new player is in the published snapshot") {
+                auto state = service.GetGameState(*service::Token::FromString(token));
+                REQUIRE(state);
+                REQUIRE(state->players.size() == 2);
+                for (const auto& player : state->players) {
+                    if (*player.id == static_cast<size_t>(player_id)) {
+                        CHECK(player.speed == geom::Vec2D{1., 0.});
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Map representation is chosen by Accept") {
+    GIVEN("a game with one map") {
+        model::Game game;
+        model::Map map(model::Map::Id{"map1"s}, "Map"s);
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+        game.AddMap(std::move(map));
+
+        NullDatabase db;
+        service::Service service{game, db};
+        extra_data::ExtraData extra_data;
+        extra_data.map_id_to_loot_types.emplace(model::Map::Id{"map1"s}, "[]"s);
+        ApiHandler handler{service, extra_data};
+
+        THEN("the binary format is sent only when it is named and not excluded") {
+            auto binary = Handle(handler, MakeGetRequest("/api/v1/maps/map1"s, "application/x-bloodhound-bin, application/json;q=0.5"sv));
+            CHECK(binary[http::field::content_type] == ContentType::APPLICATION_BLOODHOUND_BIN);
+            CHECK(binary[http::field::vary] == "Accept"sv);
+
+            auto excluded = Handle(handler, MakeGetRequest("/api/v1/maps/map1"s, "application/x-bloodhound-bin;q=0, */*"sv));
+            CHECK(excluded[http::field::content_type] == ContentType::APPLICATION_JSON);
+            CHECK(excluded[http::field::vary] == "Accept"sv);
+
+            auto wildcard = Handle(handler, MakeGetRequest("/api/v1/maps/map1"s, "*/*"sv));
+            CHECK(wildcard[http::field::content_type] == ContentType::APPLICATION_JSON);
+        }
+    }
+}
@@ -0,0 +1,154 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/json.hpp>
+
+#include "../src/util/json_writer.h"
+
+/*
+ *  Сериализация состояния игры в формате ответа /api/v1/game/state:
+ *  дерево boost::json с json::serialize против потоковой записи util::JsonWriter.
+ *  Сущности делятся поровну между собаками (по два предмета в рюкзаке) и потерянными предметами.
+ *  Результаты обоих способов сравниваются побайтно.
+ */
+
+namespace {
+
+using namespace std::literals;
+using Clock = std::chrono::steady_clock;
+namespace json = boost::json;
+
+struct Dog {
+    size_t id;
+    double x, y, vx, vy;
+    std::string_view dir;
+    std::vector<std::pair<size_t, size_t>> bag;
+    size_t score;
+};
+
+struct Loot {
+    size_t id, type;
+    double x, y;
+};
+
+struct State {
+    std::vector<Dog> dogs;
+    std::vector<Loot> loot;
+};
+
+State MakeState(size_t entities, std::mt19937& rng) {
+    std::uniform_real_distribution<double> coord{0., 100.};
+    std::uniform_int_distribution<size_t> type{0, 5};
+    constexpr std::string_view dirs[] = {"U"sv, "D"sv, "L"sv, "R"sv};
+
+    State state;
+    for (size_t i = 0; i < entities / 2; ++i) {
+        state.dogs.push_back({i, coord(rng), coord(rng), 1., 0., dirs[i % 4],
+                              {{i * 2, type(rng)}, {i * 2 + 1, type(rng)}}, i * 10});
+    }
+    for (size_t i = 0; i < entities - entities / 2; ++i) {
+        state.loot.push_back({i, type(rng), coord(rng), coord(rng)});
+    }
+    return state;
+}
+
+std::string SerializeDom(const State& state) {
+    json::object players;
+    for (const auto& dog : state.dogs) {
+        json::object player;
+        player.emplace("pos"sv, json::array{dog.x, dog.y});
+        player.emplace("speed"sv, json::array{dog.vx, dog.vy});
+        player.emplace("dir"sv, dog.dir);
+        json::array bag;
+        for (auto [id, type] : dog.bag) {
+            json::object item;
+            item.emplace("id"sv, id);
+            item.emplace("type"sv, type);
+            bag.emplace_back(std::move(item));
+        }
+        player.emplace("bag"sv, std::move(bag));
+        player.emplace("score"sv, dog.score);
+        players.emplace(std::to_string(dog.id), std::move(player));
+    }
+    json::object lost_objects;
+    for (const auto& loot : state.loot) {
+        json::object object;
+        object.emplace("type"sv, loot.type);
+        object.emplace("pos"sv, json::array{loot.x, loot.y});
+        lost_objects.emplace(std::to_string(loot.id), object);
+    }
+    json::object result;
+    result.emplace("players"sv, std::move(players));
+    result.emplace("lostObjects"sv, std::move(lost_objects));
+    return json::serialize(result);
+}
+
+std::string SerializeWriter(const State& state) {
+    std::string body;
+    util::JsonWriter writer{body};
+    writer.StartObject();
+    writer.Key("players"sv).StartObject();
+    for (const auto& dog : state.dogs) {
+        writer.Key(dog.id).StartObject();
+        writer.Key("pos"sv).StartArray().Value(dog.x).Value(dog.y).EndArray();
+        writer.Key("speed"sv).StartArray().Value(dog.vx).Value(dog.vy).EndArray();
+        writer.Key("dir"sv).Value(dog.dir);
+        writer.Key("bag"sv).StartArray();
+        for (auto [id, type] : dog.bag) {
+            writer.StartObject().Key("id"sv).Value(id).Key("type"sv).Value(type).EndObject();
+        }
+        writer.EndArray();
+        writer.Key("score"sv).Value(dog.score);
+        writer.EndObject();
+    }
+    writer.EndObject();
+    writer.Key("lostObjects"sv).StartObject();
+    for (const auto& loot : state.loot) {
+        writer.Key(loot.id).StartObject();
+        writer.Key("type"sv).Value(loot.type);
+        writer.Key("pos"sv).StartArray().Value(loot.x).Value(loot.y).EndArray();
+        writer.EndObject();
+    }
+    writer.EndObject();
+    writer.EndObject();
+    return body;
+}
+
+template <typename Fn>
+std::chrono::duration<double, std::milli> Measure(Fn&& fn, std::string& result, int repeats) {
+    auto best = std::chrono::duration<double, std::milli>::max();
+    for (int i = 0; i < repeats; ++i) {
+        auto start = Clock::now();
+        result = fn();
+        best = std::min<std::chrono::duration<double, std::milli>>(best, Clock::now() - start);
+    }
+    return best;
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng{2024};
+    std::cout << std::setw(10) << "entities" << std::setw(16) << "dom, ms" << std::setw(16) << "writer, ms"
+              << std::setw(12) << "speedup" << std::setw(12) << "bytes" << std::endl;
+
+    for (size_t entities : {1'000u, 10'000u, 100'000u}) {
+        const State state = MakeState(entities, rng);
+
+        std::string dom_body;
+        std::string writer_body;
+        auto dom = Measure([&] { return SerializeDom(state); }, dom_body, 10);
+        auto writer = Measure([&] { return SerializeWriter(state); }, writer_body, 10);
+
+        std::cout << std::setw(10) << entities << std::setw(16) << dom.count() << std::setw(16) << writer.count()
+                  << std::setw(12) << dom / writer << std::setw(12) << writer_body.size() << std::endl;
+        if (dom_body != writer_body) {
+            std::cerr << "Output mismatch for "sv << entities << " entities"sv << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+}
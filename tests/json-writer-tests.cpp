@@ -0,0 +1,63 @@
+#include <limits>
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/json_writer.h"
+
+using namespace std::literals;
+
+namespace {
+
+template <typename T>
+std::string WriteValue(T value) {
+    std::string out;
+    util::JsonWriter{out}.Value(value);
+    return out;
+}
+
+}  // namespace
+
+SCENARIO("JSON writer") {
+    GIVEN("numbers") {
+        THEN("integers are written in decimal") {
+            CHECK(WriteValue(0) == "0");
+            CHECK(WriteValue(-42) == "-42");
+            CHECK(WriteValue(std::numeric_limits<size_t>::max()) == "18446744073709551615");
+        }
+        THEN("doubles use the shortest exponential form of boost::json") {
+            CHECK(WriteValue(0.) == "0E0");
+            CHECK(WriteValue(-0.) == "-0E0");
+            CHECK(WriteValue(1.) == "1E0");
+            CHECK(WriteValue(0.5) == "5E-1");
+            CHECK(WriteValue(12.34) == "1.234E1");
+            CHECK(WriteValue(-150.) == "-1.5E2");
+            CHECK(WriteValue(0.1) == "1E-1");
+            CHECK(WriteValue(1e300) == "1E300");
+            CHECK(WriteValue(2.5e-10) == "2.5E-10");
+        }
+    }
+
+    GIVEN("strings") {
+        THEN("quotes, backslashes and control characters are escaped") {
+            CHECK(WriteValue("plain") == "\"plain\"");
+            CHECK(WriteValue("a\"b\\c") == "\"a\\\"b\\\\c\"");
+            CHECK(WriteValue("\n\t\x01/") == "\"\\n\\t\\u0001/\"");
+            CHECK(WriteValue("Шарик") == "\"Шарик\"");
+        }
+    }
+
+    GIVEN("nested containers") {
+        std::string out;
+        util::JsonWriter writer{out};
+        writer.StartObject();
+        writer.Key(7u).StartObject().Key("pos"sv).StartArray().Value(1.).Value(2.5).EndArray().EndObject();
+        writer.Key("bag"sv).StartArray().StartObject().EndObject().StartObject().Key("id"sv).Value(3).EndObject().EndArray();
+        writer.Key("name"sv).Value("dog"sv);
+        writer.Key("empty"sv).StartArray().EndArray();
+        writer.EndObject();
+
+        THEN("commas and colons are placed like in boost::json") {
+            CHECK(out == R"({"7":{"pos":[1E0,2.5E0]},"bag":[{},{"id":3}],"name":"dog","empty":[]})");
+        }
+    }
+}
@@ -8,8 +8,6 @@ using namespace std::literals;
 using namespace  model;
 using namespace  loot_gen;
 
-using DogRetire = boost::signals2::signal<void(model::Dog::Id dog, const model::Map::Id& map)>;
-
 SCENARIO("Loot spawn") {
     GIVEN("Game session with 1 map with 1 road") {
         Map map(Map::Id{"id"s}, "name"s);
@@ -75,4 +73,289 @@ SCENARIO("Loot spawn") {
             }
         }  
     }
-}
\ No newline at end of file
+}
+SCENARIO("Dog movement along roads") {
+    GIVEN("a map with two crossing roads") {
+        Map map(Map::Id{"id"s}, "name"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(1);
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, 10});
+        map.AddRoad({Road::VERTICAL, {10, 10}, 0});
+        DogRetire test;
+        GameSession session(&map, 0, false, {5s, 0.}, 100000, test);
+        auto dog = session.GetDog(session.NewDog("dog"s));
+
+        WHEN("roads are looked up by point") {
+            std::vector<const Road*> at_cross, at_middle, off_road;
+            map.ForEachRoadAt({10, 0}, [&](const Road& road) { at_cross.push_back(&road); });
+            map.ForEachRoadAt({5, 0}, [&](const Road& road) { at_middle.push_back(&road); });
+            map.ForEachRoadAt({5, 5}, [&](const Road& road) { off_road.push_back(&road); });
+            THEN("every road covering the point is found once") {
+                CHECK(at_cross.size() == 2);
+                REQUIRE(at_middle.size() == 1);
+                CHECK(at_middle.front() == &map.GetRoads().front());
+                CHECK(off_road.empty());
+            }
+        }
+
+        WHEN("dog runs east past the end of the road") {
+            dog.SetDirection(Dog::Direction::EAST);
+            dog.SetSpeed(map.GetDogSpeed());
+            session.OnTick(20s);
+            THEN("it stops at the road border") {
+                CHECK(dog.GetCoordinates() == geom::Vec2D{10.4, 0.});
+                CHECK(dog.IsStoped());
+            }
+            AND_WHEN("it turns south at the crossing") {
+                dog.SetDirection(Dog::Direction::SOUTH);
+                dog.SetSpeed(map.GetDogSpeed());
+                session.OnTick(3s);
+                THEN("it moves along the vertical road") {
+                    CHECK(dog.GetCoordinates() == geom::Vec2D{10.4, 3.});
+                    CHECK_FALSE(dog.IsStoped());
+                }
+            }
+        }
+    }
+}
+SCENARIO("Dog storage keeps handles stable") {
+    GIVEN("a session with three dogs") {
+        Map map(Map::Id{"id"s}, "name"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(1);
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, 10});
+        DogRetire on_retire;
+        std::vector<Dog::Id> retired;
+        on_retire.connect([&](Dog::Id dog, const GameSession&) { retired.push_back(dog); });
+        GameSession session(&map, 0, false, {5s, 0.}, 1000, on_retire);
+        auto first = session.NewDog("first"s);
+        auto second = session.NewDog("second"s);
+        auto third = session.NewDog("third"s);
+        session.GetDog(second).SetDirection(Dog::Direction::EAST);
+        session.GetDog(second).SetSpeed(map.GetDogSpeed());
+        session.GetDog(third).SetDirection(Dog::Direction::EAST);
+        session.GetDog(third).SetSpeed(map.GetDogSpeed() / 2);
+
+        WHEN("the idle dog retires") {
+            session.OnTick(1s);
+            THEN("it is removed and the other handles still point to their dogs") {
+                REQUIRE(retired.size() == 1);
+                CHECK(*retired.front() == 0);
+                CHECK(session.GetDogs().Size() == 2);
+                CHECK_FALSE(session.GetDogs().Contains(first));
+                CHECK_FALSE(session.GetDogById(Dog::Id{0}).has_value());
+                CHECK(session.GetDog(second).GetName() == "second"s);
+                CHECK(session.GetDog(second).GetCoordinates() == geom::Vec2D{1., 0.});
+                CHECK(session.GetDog(third).GetName() == "third"s);
+                CHECK(session.GetDog(third).GetCoordinates() == geom::Vec2D{0.5, 0.});
+                CHECK(session.GetDogById(Dog::Id{2}) == third);
+                CHECK_THROWS_AS(session.GetDog(first), std::out_of_range);
+            }
+            AND_WHEN("a new dog takes the freed slot") {
+                auto fourth = session.NewDog("fourth"s);
+                THEN("the stale handle does not point to it") {
+                    CHECK(fourth.slot == first.slot);
+                    CHECK(fourth != first);
+                    CHECK_FALSE(session.GetDogs().Contains(first));
+                    CHECK(session.GetDog(fourth).GetName() == "fourth"s);
+                }
+            }
+        }
+
+        WHEN("the last join is rolled back") {
+            session.RemoveDog(third);
+            THEN("the dog disappears without retiring and without a join event") {
+                CHECK(retired.empty());
+                CHECK(session.GetDogs().Size() == 2);
+                CHECK_FALSE(session.GetDogs().Contains(third));
+                CHECK_FALSE(session.GetDogById(Dog::Id{2}).has_value());
+                GameSession::Events events;
+                session.TakeEvents(events);
+                REQUIRE(events.size() == 2);
+                CHECK(*events[0].dog == 0);
+                CHECK(*events[1].dog == 1);
+            }
+        }
+    }
+}
+SCENARIO("Loot storage") {
+    GIVEN("a session with three loot objects on a road") {
+        Map map(Map::Id{"id"s}, "name"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(1);
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, 10});
+        DogRetire test;
+        GameSession session(&map, 0, false, {5s, 0.}, 100000, test);
+        session.AddLoot(LootObject{LootObject::Id{0}, 0, 1}, {1., 0.});
+        session.AddLoot(LootObject{LootObject::Id{1}, 0, 1}, {5., 0.});
+        session.AddLoot(LootObject{LootObject::Id{2}, 0, 1}, {8., 0.});
+        CHECK_THROWS(session.AddLoot(LootObject{LootObject::Id{2}, 0, 1}, {9., 0.}));
+
+        WHEN("a dog picks up the first object") {
+            auto dog = session.GetDog(session.AddDog(Dog{Dog::Id{0}, "dog"s, {0., 0.}}));
+            dog.SetDirection(Dog::Direction::EAST);
+            dog.SetSpeed(map.GetDogSpeed());
+            session.OnTick(2s);
+            THEN("the rest stay reachable by id") {
+                REQUIRE(dog.LootCountInBag() == 1);
+                CHECK(*dog.GetBag().front().GetId() == 0);
+                CHECK(session.GetLootObjects().size() == 2);
+                CHECK(session.GetLootCoordsById(LootObject::Id{1}) == geom::Vec2D{5., 0.});
+                CHECK(session.GetLootCoordsById(LootObject::Id{2}) == geom::Vec2D{8., 0.});
+                CHECK_THROWS_AS(session.GetLootCoordsById(LootObject::Id{0}), std::out_of_range);
+            }
+        }
+    }
+}
+SCENARIO("Session events") {
+    GIVEN("a session with loot and an office on a road") {
+        Map map(Map::Id{"id"s}, "name"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(7);
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, 10});
+        map.AddOffice(Office{Office::Id{"office"s}, {6, 0}, {0, 0}});
+        DogRetire on_retire;
+        GameSession session(&map, 0, false, {5s, 0.}, 1000, on_retire);
+        session.AddLoot(LootObject{LootObject::Id{3}, 0, 7}, {2., 0.});
+
+        auto runner = session.NewDog("runner"s);
+        session.NewDog("idle"s);
+        session.GetDog(runner).SetDirection(Dog::Direction::EAST);
+        session.GetDog(runner).SetSpeed(map.GetDogSpeed());
+
+        WHEN("one dog idles and the other carries the loot to the office") {
+            session.OnTick(1s);
+            session.OnTick(4s);
+            session.OnTick(2s);
+            GameSession::Events events;
+            session.TakeEvents(events);
+
+            THEN("joins, retirement, collection and drop are recorded in order") {
+                using Type = SessionEvent::Type;
+                REQUIRE(events.size() == 5);
+                CHECK(events[0].type == Type::JOIN);
+                CHECK(events[0].name == "runner"s);
+                CHECK(events[1].type == Type::JOIN);
+                CHECK(*events[1].dog == 1);
+                CHECK(events[2].type == Type::RETIRE);
+                CHECK(*events[2].dog == 1);
+                CHECK(events[3].type == Type::LOOT_COLLECTED);
+                CHECK(*events[3].dog == 0);
+                CHECK(*events[3].loot == 3);
+                CHECK(events[4].type == Type::LOOT_DROPPED);
+                CHECK(events[4].items == 1);
+                CHECK(events[4].score_change == 7);
+            }
+            THEN("taken events are not returned again") {
+                session.TakeEvents(events);
+                CHECK(events.empty());
+            }
+        }
+    }
+}
+SCENARIO("Parallel session ticking") {
+    GIVEN("a game with several maps ticked by a thread pool") {
+        constexpr size_t maps_count = 6;
+        Game game;
+        game.SetDogRetirementTime(1000);
+        game.SetLootGeneratorParams(5., 0.);
+        game.SetTickThreads(4);
+        for (size_t i = 0; i < maps_count; ++i) {
+            Map map(Map::Id{"map"s + std::to_string(i)}, "Map"s);
+            map.SetDogSpeed(1).SetDogBagCapacity(3);
+            map.AddLootWorth(1);
+            map.AddRoad({Road::HORIZONTAL, {0, 0}, 10});
+            game.AddMap(std::move(map));
+        }
+        std::vector<std::pair<size_t, std::string>> retired;
+        auto connection = game.RetireListener([&](Dog::Id dog, const GameSession& session) {
+            retired.emplace_back(*dog, *session.GetMap().GetId());
+        });
+        std::vector<DogHandle> runners;
+        for (size_t i = 0; i < maps_count; ++i) {
+            GameSession* session = game.GetGameSessionByMapId(Map::Id{"map"s + std::to_string(i)});
+            session->NewDog("idle"s);
+            auto runner = session->NewDog("runner"s);
+            session->GetDog(runner).SetDirection(Dog::Direction::EAST);
+            session->GetDog(runner).SetSpeed(1.);
+            runners.push_back(runner);
+        }
+
+        WHEN("the game ticks") {
+            game.OnTick(1s);
+            THEN("every session is advanced and retirements are reported in session order") {
+                REQUIRE(retired.size() == maps_count);
+                for (size_t i = 0; i < maps_count; ++i) {
+                    CHECK(retired[i] == std::pair<size_t, std::string>{0, "map"s + std::to_string(i)});
+                    const GameSession* session = game.GetGameSessionByMapId(Map::Id{"map"s + std::to_string(i)});
+                    CHECK(session->GetDogs().Size() == 1);
+                    CHECK(session->GetDog(runners[i]).GetCoordinates() == geom::Vec2D{1., 0.});
+                }
+            }
+        }
+
+        WHEN("the pool is replaced by the calling thread alone") {
+            game.SetTickThreads(1);
+            game.OnTick(1s);
+            THEN("sessions are advanced the same way") {
+                REQUIRE(retired.size() == maps_count);
+                for (size_t i = 0; i < maps_count; ++i) {
+                    CHECK(retired[i] == std::pair<size_t, std::string>{0, "map"s + std::to_string(i)});
+                    const GameSession* session = game.GetGameSessionByMapId(Map::Id{"map"s + std::to_string(i)});
+                    CHECK(session->GetDog(runners[i]).GetCoordinates() == geom::Vec2D{1., 0.});
+                }
+            }
+        }
+    }
+}
+SCENARIO("Session sharding") {
+    GIVEN("a game with a per-session players limit") {
+        Game game;
+        game.SetDogRetirementTime(100000);
+        game.SetLootGeneratorParams(5., 0.);
+        game.SetSessionPlayersLimit(2);
+        Map map(Map::Id{"map"s}, "Map"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(1);
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, 10});
+        game.AddMap(std::move(map));
+        const Map::Id map_id{"map"s};
+
+        WHEN("five players join the map") {
+            std::vector<GameSession*> joined;
+            for (int i = 0; i < 5; ++i) {
+                GameSession* session = game.GetGameSessionByMapId(map_id);
+                REQUIRE(session != nullptr);
+                session->NewDog("dog"s + std::to_string(i));
+                joined.push_back(session);
+            }
+            THEN("full sessions are split into new instances") {
+                CHECK(joined[0] == joined[1]);
+                CHECK(joined[2] == joined[3]);
+                CHECK(joined[1] != joined[2]);
+                CHECK(joined[4] != joined[0]);
+                CHECK(joined[4] != joined[2]);
+                CHECK(game.GetGameState().size() == 3);
+                CHECK(game.FindGameSession(map_id, joined[4]->GetId()) == joined[4]);
+                CHECK(game.FindGameSession(Map::Id{"unknown"s}, joined[4]->GetId()) == nullptr);
+            }
+        }
+
+        WHEN("sessions are restored for the same map") {
+            game.AddGameSession(map_id, 4);
+            game.AddGameSession(map_id, 7);
+            THEN("both are kept and new sessions get fresh numbers") {
+                CHECK(game.FindGameSession(map_id, GameSession::Id{4}) != nullptr);
+                CHECK(game.FindGameSession(map_id, GameSession::Id{7}) != nullptr);
+                CHECK_THROWS(game.AddGameSession(map_id, 7));
+                std::vector<size_t> ids;
+                for (int i = 0; i < 5; ++i) {
+                    GameSession* session = game.GetGameSessionByMapId(map_id);
+                    session->NewDog("dog"s + std::to_string(i));
+                    ids.push_back(*session->GetId());
+                }
+                CHECK(ids == std::vector<size_t>{4, 7, 4, 7, 8});
+            }
+        }
+    }
+}
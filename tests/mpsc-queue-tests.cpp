@@ -0,0 +1,55 @@
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/mpsc_queue.h"
+
+SCENARIO("MPSC queue") {
+    GIVEN("an empty queue") {
+        util::MpscQueue<int> queue;
+        CHECK_FALSE(queue.Pop().has_value());
+
+        WHEN("one thread pushes values") {
+            for (int i = 0; i < 3; ++i) {
+                queue.Push(i);
+            }
+            THEN("they are popped in order") {
+                CHECK(queue.Pop() == 0);
+                CHECK(queue.Pop() == 1);
+                CHECK(queue.Pop() == 2);
+                CHECK_FALSE(queue.Pop().has_value());
+            }
+        }
+
+        WHEN("several producers push concurrently while the consumer pops") {
+            constexpr int producers = 4;
+            constexpr int per_producer = 10000;
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; ++p) {
+                threads.emplace_back([&queue, p] {
+                    for (int i = 0; i < per_producer; ++i) {
+                        queue.Push(p * per_producer + i);
+                    }
+                });
+            }
+            std::vector<int> last(producers, -1);
+            bool ordered = true;
+            int received = 0;
+            while (received < producers * per_producer) {
+                if (auto value = queue.Pop()) {
+                    const int producer = *value / per_producer;
+                    ordered = ordered && *value % per_producer == last[producer] + 1;
+                    last[producer] = *value % per_producer;
+                    ++received;
+                }
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            THEN("every value arrives once, in per-producer order") {
+                CHECK(ordered);
+                CHECK_FALSE(queue.Pop().has_value());
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/once_cache.h"
+
+SCENARIO("Once cache") {
+    GIVEN("an empty cache") {
+        util::OnceCache<std::string> cache;
+        int calls = 0;
+        auto make = [&calls] {
+            ++calls;
+            return std::string{"body"};
+        };
+
+        WHEN("the value is requested twice") {
+            auto [first, first_hit] = cache.Get(make);
+            auto [second, second_hit] = cache.Get(make);
+            THEN("it is computed once and shared without copying") {
+                CHECK(calls == 1);
+                CHECK_FALSE(first_hit);
+                CHECK(second_hit);
+                CHECK(*first == "body");
+                CHECK(first.get() == second.get());
+            }
+        }
+
+        WHEN("several threads request the value at once") {
+            constexpr int threads_count = 8;
+            std::atomic<int> misses = 0;
+            std::vector<std::thread> threads;
+            for (int i = 0; i < threads_count; ++i) {
+                threads.emplace_back([&] {
+                    if (!cache.Get(make).second) {
+                        ++misses;
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            THEN("exactly one of them computes it") {
+                CHECK(calls == 1);
+                CHECK(misses == 1);
+            }
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/model/point_grid.h"
+
+namespace {
+
+std::vector<size_t> FindBruteForce(const std::vector<geom::Vec2D>& points, geom::Vec2D min, geom::Vec2D max) {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto& point = points[i];
+        if (point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+SCENARIO("Point grid") {
+    GIVEN("an empty grid") {
+        geom::PointGrid grid;
+        THEN("nothing is found") {
+            std::vector<size_t> found;
+            grid.FindInBox({-100., -100.}, {100., 100.}, found);
+            CHECK(found.empty());
+        }
+    }
+
+    GIVEN("points on a line and in one spot") {
+        std::vector<geom::Vec2D> points{{0., 0.}, {5., 0.}, {10., 0.}, {5., 0.}};
+        geom::PointGrid grid{points};
+        THEN("box borders are inclusive and indices keep the source order") {
+            std::vector<size_t> found;
+            grid.FindInBox({5., 0.}, {10., 0.}, found);
+            CHECK(found == std::vector<size_t>{1, 2, 3});
+        }
+        THEN("a box outside the points finds nothing") {
+            std::vector<size_t> found;
+            grid.FindInBox({11., -1.}, {20., 1.}, found);
+            CHECK(found.empty());
+        }
+    }
+
+    GIVEN("random points") {
+        std::mt19937 generator{42};
+        std::uniform_real_distribution<double> coord{-50., 150.};
+        std::vector<geom::Vec2D> points;
+        for (int i = 0; i < 1000; ++i) {
+            points.emplace_back(coord(generator), coord(generator));
+        }
+        geom::PointGrid grid{points};
+
+        THEN("every box query matches the brute force") {
+            std::uniform_real_distribution<double> size{0., 60.};
+            for (int i = 0; i < 200; ++i) {
+                geom::Vec2D min{coord(generator), coord(generator)};
+                geom::Vec2D max{min.x + size(generator), min.y + size(generator)};
+                std::vector<size_t> found;
+                grid.FindInBox(min, max, found);
+                CHECK(found == FindBruteForce(points, min, max));
+            }
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/util.h"
+
+using namespace std::literals;
+
+SCENARIO("Masking a query parameter") {
+    GIVEN("targets with and without the parameter") {
+        THEN("every value of the parameter is hidden and the rest is kept") {
+            CHECK(util::MaskQueryParameter("/api/v1/game/ws?authToken=0123abcd"sv, "authToken"sv)
+                  == "/api/v1/game/ws?authToken=***"s);
+            CHECK(util::MaskQueryParameter("/ws?a=1&authToken=x&b=2&authToken=y"sv, "authToken"sv)
+                  == "/ws?a=1&authToken=***&b=2&authToken=***"s);
+            CHECK(util::MaskQueryParameter("/ws?authToken="sv, "authToken"sv) == "/ws?authToken=***"s);
+        }
+        THEN("targets without the parameter are returned as is") {
+            CHECK(util::MaskQueryParameter("/api/v1/game/ws"sv, "authToken"sv) == "/api/v1/game/ws"s);
+            CHECK(util::MaskQueryParameter("/ws?authTokenX=1&token=2"sv, "authToken"sv) == "/ws?authTokenX=1&token=2"s);
+        }
+    }
+}
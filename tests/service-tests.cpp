@@ -0,0 +1,155 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/service/service.h"
+
+#include <stdexcept>
+
+using namespace std::literals;
+
+namespace {
+
+// Рекорды в этих тестах не сохраняются
+class NullDatabase : public repository::Database, public repository::SaveScoresFactory {
+public:
+    repository::SaveScoresFactory& GetSaveScoresFactory() override {
+        return *this;
+    }
+    std::unique_ptr<service::SaveScores> CreateSaveScores() override {
+        throw std::logic_error{"No database in tests"};
+    }
+};
+
+}  // namespace
+
+SCENARIO("Commands without the simulation thread") {
+    GIVEN("a service ticked through the API") {
+        model::Game game;
+        game.SetDogRetirementTime(100000);
+        game.SetLootGeneratorParams(5., 0.);
+        model::Map map(model::Map::Id{"map1"s}, "Map"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(1);
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+        game.AddMap(std::move(map));
+
+        NullDatabase db;
+        service::Service service{game, db};
+
+        std::vector<service::UseCaseJoinPlayer::Result> joined;
+        auto on_joined = [&joined](service::UseCaseJoinPlayer::Result result, std::exception_ptr error) {
+            REQUIRE_FALSE(error);
+            joined.push_back(std::move(result));
+        };
+
+        WHEN("several players join within one request") {
+            for (int i = 0; i < 3; ++i) {
+                service.JoinPlayer(model::Map::Id{"map1"s}, "dog"s + std::to_string(i), on_joined);
+            }
+            THEN("nothing happens until the commands are flushed") {
+                CHECK(joined.empty());
+            }
+            service.FlushCommands();
+            THEN("all of them are answered after a single publication") {
+                REQUIRE(joined.size() == 3);
+                for (const auto& result : joined) {
+                    REQUIRE(result);
+                    auto state = service.GetGameState(result->first);
+                    REQUIRE(state);
+                    CHECK(state->tick == 1);
+                    CHECK(state->players.size() == 3);
+                }
+            }
+        }
+
+        WHEN("a player joins an unknown map") {
+            service.JoinPlayer(model::Map::Id{"unknown"s}, "dog"s, on_joined);
+            THEN("the answer comes at once") {
+                REQUIRE(joined.size() == 1);
+                CHECK_FALSE(joined.front());
+            }
+        }
+
+        WHEN("an action is flushed") {
+            service.JoinPlayer(model::Map::Id{"map1"s}, "dog"s, on_joined);
+            service.FlushCommands();
+            REQUIRE(joined.size() == 1);
+            const service::Token token = joined.front()->first;
+
+            REQUIRE(service.GameAction(token, model::Dog::Direction::EAST));
+            THEN("it is not visible before the flush") {
+                auto state = service.GetGameState(token);
+                CHECK(state->tick == 1);
+                CHECK(state->players.front().speed == geom::Vec2D{0., 0.});
+            }
+            service.FlushCommands();
+            THEN("it is visible right after the flush") {
+                auto state = service.GetGameState(token);
+                CHECK(state->tick == 2);
+                CHECK(state->players.front().speed == geom::Vec2D{1., 0.});
+                CHECK(state->players.front().dir == model::Dog::Direction::EAST);
+            }
+            THEN("a flush without commands publishes nothing") {
+                service.FlushCommands();
+                CHECK(service.GetGameState(token)->tick == 2);
+            }
+        }
+    }
+}
+
+SCENARIO("State changes are computed on demand") {
+    GIVEN("a service with a joined player") {
+        model::Game game;
+        game.SetDogRetirementTime(100000);
+        game.SetLootGeneratorParams(5., 0.);
+        model::Map map(model::Map::Id{"map1"s}, "Map"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(1);
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+        game.AddMap(std::move(map));
+
+        NullDatabase db;
+        service::Service service{game, db};
+
+        std::optional<service::Token> token;
+        service.JoinPlayer(model::Map::Id{"map1"s}, "dog"s, [&token](service::UseCaseJoinPlayer::Result result, std::exception_ptr) {
+            token = result->first;
+        });
+        service.FlushCommands();
+        REQUIRE(token);
+
+        WHEN("nobody asks for changes") {
+            for (int i = 0; i < 3; ++i) {
+                service.Tick(10ms);
+            }
+            auto state = service.GetGameState(*token);
+            THEN("the tick does not compare states and older changes are dropped") {
+                REQUIRE(state->recent_deltas.size() == 3);
+                for (const auto& delta : state->recent_deltas) {
+                    CHECK_FALSE(delta->IsComputed());
+                }
+                CHECK_FALSE(state->ChangesSince(state->tick - 2).has_value());
+                CHECK(state->ChangesSince(state->tick - 1).has_value());
+                CHECK(state->recent_deltas.back()->IsComputed());
+            }
+        }
+
+        WHEN("a client asks for changes every tick and then pauses") {
+            REQUIRE(service.GameAction(*token, model::Dog::Direction::EAST));
+            for (int i = 0; i < 3; ++i) {
+                service.Tick(10ms);
+                auto state = service.GetGameState(*token);
+                REQUIRE(state->ChangesSince(state->tick - 1).has_value());
+            }
+            service.Tick(10ms);
+            service.Tick(10ms);
+            auto state = service.GetGameState(*token);
+            THEN("the history stays complete") {
+                auto delta = state->ChangesSince(1);
+                REQUIRE(delta.has_value());
+                CHECK(delta->from_tick == 1);
+                CHECK(delta->to_tick == state->tick);
+                CHECK(delta->players.size() == 1);
+            }
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include <memory>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/service/service.h"
+
+using namespace service;
+
+namespace {
+
+using State = UseCaseGetGameState::GameState;
+using Delta = UseCaseGetGameState::StateDelta;
+using LazyDelta = UseCaseGetGameState::LazyStateDelta;
+using PlayerState = UseCaseGetGameState::PlayerState;
+using LootState = UseCaseGetGameState::LootObjectState;
+
+PlayerState MakePlayer(size_t id, double x) {
+    return {model::Dog::Id{id}, {x, 0.}, {}, model::Dog::Direction::NORTH, {}, 0};
+}
+
+LootState MakeLoot(size_t id) {
+    return {model::LootObject::Id{id}, 0, {}};
+}
+
+}  // namespace
+
+SCENARIO("Game state changes since a tick") {
+    GIVEN("a state at tick 13 that keeps the changes of ticks 10..13") {
+        State state;
+        state.tick = 13;
+        state.recent_deltas.push_back(std::make_shared<LazyDelta>(Delta{10, 11, {MakePlayer(1, 1.)}, {MakeLoot(5)}, {}, {}}));
+        state.recent_deltas.push_back(std::make_shared<LazyDelta>(Delta{11, 12, {MakePlayer(1, 2.), MakePlayer(2, 0.)}, {}, {}, {MakeLoot(5).id}}));
+        state.recent_deltas.push_back(std::make_shared<LazyDelta>(Delta{12, 13, {MakePlayer(2, 3.)}, {MakeLoot(6)}, {model::Dog::Id{3}}, {}}));
+
+        THEN("a client at the current tick gets no changes") {
+            auto delta = state.ChangesSince(13);
+            REQUIRE(delta.has_value());
+            CHECK(delta->players.empty());
+            CHECK(delta->removed_players.empty());
+            CHECK(delta->loot_objects.empty());
+        }
+
+        THEN("a client one tick behind gets the last change set") {
+            auto delta = state.ChangesSince(12);
+            REQUIRE(delta.has_value());
+            CHECK(delta->from_tick == 12);
+            CHECK(delta->to_tick == 13);
+            REQUIRE(delta->players.size() == 1);
+            CHECK(delta->players.front() == MakePlayer(2, 3.));
+            CHECK(delta->removed_players == std::vector{model::Dog::Id{3}});
+        }
+
+        THEN("change sets are merged and only the latest state of each object is kept") {
+            auto delta = state.ChangesSince(10);
+            REQUIRE(delta.has_value());
+            CHECK(delta->from_tick == 10);
+            CHECK(delta->to_tick == 13);
+            REQUIRE(delta->players.size() == 2);
+            CHECK(delta->players[0] == MakePlayer(2, 3.));
+            CHECK(delta->players[1] == MakePlayer(1, 2.));
+            CHECK(delta->removed_players == std::vector{model::Dog::Id{3}});
+            REQUIRE(delta->loot_objects.size() == 1);
+            CHECK(delta->loot_objects.front().id == MakeLoot(6).id);
+            CHECK(delta->removed_loot_objects == std::vector{MakeLoot(5).id});
+        }
+
+        THEN("a client that is too far behind or ahead gets nothing and needs the full state") {
+            CHECK_FALSE(state.ChangesSince(9).has_value());
+            CHECK_FALSE(state.ChangesSince(14).has_value());
+        }
+    }
+}
@@ -15,8 +15,6 @@ using namespace service;
 using namespace geom;
 using namespace Catch::Matchers;
 
-using DogRetire = boost::signals2::signal<void(model::Dog::Id dog, const model::Map::Id& map)>;
-
 namespace {
 using InputArchive = boost::archive::text_iarchive;
 using OutputArchive = boost::archive::text_oarchive;
@@ -142,13 +140,13 @@ SCENARIO_METHOD(Fixture, "Serialization") {
             model::Map map1(model::Map::Id{"Map1"}, "Moskow");
             DogRetire test;
             model::GameSession session1(&map1, 1, true, {1s, 0.5}, 100, test);
-            auto dog1 = std::make_shared<model::Dog>(model::Dog(Dog::Id{42}, "Reks"s, {42.2, 12.5}));
+            auto dog1 = session1.AddDog(model::Dog(Dog::Id{42}, "Reks"s, {42.2, 12.5}));
             auto pl1 = players.AddPlayer(dog1, &session1);
             auto pl1_token = tokens.AddPlayer(pl1);
 
             model::Map map2(model::Map::Id{"Map2"}, "Spb");
             model::GameSession session2(&map2, 0, true, {}, 100, test);
-            auto dog2 = std::make_shared<model::Dog>(model::Dog(Dog::Id{27}, "Mikki"s, {40.2, 32.5}));
+            auto dog2 = session1.AddDog(model::Dog(Dog::Id{27}, "Mikki"s, {40.2, 32.5}));
             auto pl2 = players.AddPlayer(dog2, &session1);
             auto pl2_token = tokens.AddPlayer(pl2);
 
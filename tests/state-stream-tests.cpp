@@ -0,0 +1,256 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/handler/state_stream.h"
+
+#include <chrono>
+#include <optional>
+
+using namespace std::literals;
+using namespace http_handler;
+using tcp = net::ip::tcp;
+
+namespace {
+
+using GameState = service::UseCaseGetGameState::GameState;
+using StateDelta = service::UseCaseGetGameState::StateDelta;
+using LazyStateDelta = service::UseCaseGetGameState::LazyStateDelta;
+
+// Кадр тика tick; from_tick - начало последнего изменения, если история есть
+std::shared_ptr<const StateFrame> MakeFrame(uint64_t tick, std::optional<uint64_t> from_tick) {
+    auto state = std::make_shared<GameState>();
+    state->tick = tick;
+    if (from_tick) {
+        state->recent_deltas.push_back(std::make_shared<LazyStateDelta>(StateDelta{*from_tick, tick}));
+    }
+    auto frame = std::make_shared<StateFrame>();
+    frame->state = std::move(state);
+    return frame;
+}
+
+// Клиент WebSocket и серверная StateStreamSession, соединённые через loopback в одном io_context
+class Connection {
+    // Объявлен первым: соединения должны разрушаться раньше io_context
+    net::io_context ioc_;
+
+public:
+    Connection() {
+        tcp::acceptor acceptor{ioc_, {net::ip::make_address("127.0.0.1"), 0}};
+        beast::get_lowest_layer(client_).connect(acceptor.local_endpoint());
+        beast::tcp_stream server{acceptor.accept()};
+
+        bool handshake_done = false;
+        client_.async_handshake("localhost", "/api/v1/game/ws", [&handshake_done](beast::error_code ec) {
+            REQUIRE_FALSE(ec);
+            handshake_done = true;
+        });
+        http::request<http::string_body> req;
+        beast::flat_buffer buffer;
+        bool request_read = false;
+        http::async_read(server, buffer, req, [&request_read](beast::error_code ec, std::size_t) {
+            REQUIRE_FALSE(ec);
+            request_read = true;
+        });
+        RunUntil([&request_read] {
+            return request_read;
+        });
+
+        session = std::make_shared<StateStreamSession>(std::move(server));
+        session->Accept(std::move(req));
+        RunUntil([&handshake_done] {
+            return handshake_done;
+        });
+        ReadNext();
+    }
+
+    template <typename Fn>
+    void RunUntil(Fn&& done) {
+        while (!done()) {
+            REQUIRE(ioc_.run_one_for(5s) > 0);
+        }
+    }
+
+    void WaitMessages(size_t count) {
+        RunUntil([this, count] {
+            return messages.size() >= count || read_error;
+        });
+        // Лишнее сообщение тоже должно попасть в messages
+        ioc_.poll();
+    }
+
+    void WaitClosed() {
+        RunUntil([this] {
+            return read_error.has_value();
+        });
+    }
+
+    std::shared_ptr<StateStreamSession> session;
+    std::vector<std::string> messages;
+    std::optional<beast::error_code> read_error;
+
+private:
+    void ReadNext() {
+        client_.async_read(read_buffer_, [this](beast::error_code ec, std::size_t) {
+            if (ec) {
+                read_error = ec;
+                return;
+            }
+            messages.push_back(beast::buffers_to_string(read_buffer_.data()));
+            read_buffer_.consume(read_buffer_.size());
+            ReadNext();
+        });
+    }
+
+    websocket::stream<beast::tcp_stream> client_{ioc_};
+    beast::flat_buffer read_buffer_;
+};
+
+class MemoryScores : public service::SaveScores, public service::RetiredPlayerRepository {
+public:
+    explicit MemoryScores(std::vector<service::RetiredPlayer>& saved)
+        : saved_{saved} {
+    }
+    service::RetiredPlayerRepository& PlayerRepository() override {
+        return *this;
+    }
+    void Commit() override {
+    }
+    void Save(const service::RetiredPlayer& player) override {
+        saved_.push_back(player);
+    }
+    std::vector<service::RetiredPlayer> GetSavedRetiredPlayers(int, int) override {
+        return saved_;
+    }
+
+private:
+    std::vector<service::RetiredPlayer>& saved_;
+};
+
+class MemoryDatabase : public repository::Database, public repository::SaveScoresFactory {
+public:
+    repository::SaveScoresFactory& GetSaveScoresFactory() override {
+        return *this;
+    }
+    std::unique_ptr<service::SaveScores> CreateSaveScores() override {
+        return std::make_unique<MemoryScores>(saved_);
+    }
+
+private:
+    std::vector<service::RetiredPlayer> saved_;
+};
+
+}  // namespace
+
+SCENARIO("State stream session") {
+    GIVEN("a connection that has received the first frame") {
+        Connection connection;
+        auto first = MakeFrame(1, std::nullopt);
+        connection.session->Push(first);
+        connection.WaitMessages(1);
+        REQUIRE(connection.messages.size() == 1);
+        CHECK(connection.messages[0] == *first->GetFull());
+
+        WHEN("the next frame continues the sent tick") {
+            auto next = MakeFrame(2, 1);
+            connection.session->Push(next);
+            connection.WaitMessages(2);
+            THEN("only the changes are sent") {
+                REQUIRE(connection.messages.size() == 2);
+                CHECK(connection.messages[1] == *next->GetDelta());
+            }
+        }
+
+        WHEN("the next frame does not continue the sent tick") {
+            auto next = MakeFrame(3, 2);
+            connection.session->Push(next);
+            connection.WaitMessages(2);
+            THEN("the full state is sent") {
+                REQUIRE(connection.messages.size() == 2);
+                CHECK(connection.messages[1] == *next->GetFull());
+            }
+        }
+
+        WHEN("frames arrive while a message is being written") {
+            auto second = MakeFrame(2, 1);
+            auto third = MakeFrame(3, 2);
+            auto fourth = MakeFrame(4, 3);
+            connection.session->Push(second);
+            connection.session->Push(third);
+            connection.session->Push(fourth);
+            connection.WaitMessages(3);
+            THEN("the newest frame replaces the pending one and is sent in full") {
+                REQUIRE(connection.messages.size() == 3);
+                CHECK(connection.messages[1] == *second->GetDelta());
+                CHECK(connection.messages[2] == *fourth->GetFull());
+            }
+        }
+
+        WHEN("the session is closed") {
+            connection.session->Close();
+            connection.session->Push(MakeFrame(2, 1));
+            connection.WaitClosed();
+            THEN("the client gets a close frame and no more messages") {
+                CHECK(*connection.read_error == websocket::error::closed);
+                CHECK(connection.messages.size() == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("State broadcaster") {
+    GIVEN("a service with a joined player") {
+        model::Game game;
+        game.SetDogRetirementTime(1000);
+        game.SetLootGeneratorParams(5., 0.);
+        model::Map map(model::Map::Id{"map1"s}, "Map"s);
+        map.SetDogSpeed(1).SetDogBagCapacity(3);
+        map.AddLootWorth(1);
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+        game.AddMap(std::move(map));
+
+        MemoryDatabase db;
+        service::Service service{game, db};
+        StateBroadcaster broadcaster{service};
+
+        std::optional<service::Token> token;
+        service.JoinPlayer(model::Map::Id{"map1"s}, "Rex"s, [&token](service::UseCaseJoinPlayer::Result result, std::exception_ptr) {
+            token = result->first;
+        });
+        service.FlushCommands();
+        REQUIRE(token);
+
+        WHEN("a subscribed connection is gone") {
+            net::io_context ioc;
+            auto session = std::make_shared<StateStreamSession>(beast::tcp_stream{ioc});
+            REQUIRE(broadcaster.Subscribe(*token, session));
+            // Отправка текущего состояния держит соединение, пока не выполнится
+            ioc.poll();
+            CHECK(broadcaster.SubscribersCount() == 1);
+            session.reset();
+            service.Tick(10ms);
+            THEN("it is removed on the next tick") {
+                CHECK(broadcaster.SubscribersCount() == 0);
+            }
+        }
+
+        WHEN("an unknown token subscribes") {
+            net::io_context ioc;
+            auto session = std::make_shared<StateStreamSession>(beast::tcp_stream{ioc});
+            THEN("the subscription is refused") {
+                CHECK_FALSE(broadcaster.Subscribe(service::Token{}, session));
+                CHECK(broadcaster.SubscribersCount() == 0);
+            }
+        }
+
+        WHEN("the player retires") {
+            Connection connection;
+            REQUIRE(broadcaster.Subscribe(*token, connection.session));
+            connection.WaitMessages(1);
+            service.Tick(2s);
+            THEN("the stream is closed and the subscription is dropped") {
+                connection.WaitClosed();
+                CHECK(*connection.read_error == websocket::error::closed);
+                CHECK(broadcaster.SubscribersCount() == 0);
+            }
+        }
+    }
+}
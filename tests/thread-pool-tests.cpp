@@ -0,0 +1,120 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/thread_pool.h"
+
+using namespace std::literals;
+
+SCENARIO("Work stealing pool") {
+    GIVEN("a pool of four threads") {
+        util::WorkStealingPool pool{4};
+        REQUIRE(pool.GetThreadsCount() == 4);
+
+        WHEN("tasks are run several times in a row") {
+            constexpr size_t count = 1000;
+            std::vector<std::atomic<int>> calls(count);
+            for (int round = 0; round < 5; ++round) {
+                pool.ParallelFor(count, [&calls](size_t index) {
+                    ++calls[index];
+                });
+            }
+            pool.ParallelFor(0, [](size_t) {
+                FAIL("no tasks expected");
+            });
+            THEN("every index is called once per run") {
+                for (const auto& value : calls) {
+                    CHECK(value == 5);
+                }
+            }
+        }
+
+        WHEN("tasks throw") {
+            constexpr size_t count = 100;
+            std::vector<std::atomic<int>> calls(count);
+            auto run = [&] {
+                pool.ParallelFor(count, [&calls](size_t index) {
+                    ++calls[index];
+                    if (index % 10 == 3) {
+                        throw std::runtime_error("task failed");
+                    }
+                });
+            };
+            THEN("the exception reaches the caller after all tasks have run") {
+                CHECK_THROWS_AS(run(), std::runtime_error);
+                for (const auto& value : calls) {
+                    CHECK(value == 1);
+                }
+            }
+            THEN("the pool keeps working") {
+                CHECK_THROWS(run());
+                std::atomic<size_t> done = 0;
+                pool.ParallelFor(count, [&done](size_t) {
+                    ++done;
+                });
+                CHECK(done == count);
+            }
+        }
+    }
+
+    GIVEN("a pool whose caller is stuck on a long task") {
+        // Задачи 0, 2, 4, 6 лежат в очереди вызывающего потока, 1, 3, 5, 7 - в очереди рабочего.
+        // Вызывающий поток начинает с задачи 6 и ждёт, пока рабочий украдёт у него другую задачу
+        util::WorkStealingPool pool{2};
+        const auto caller = std::this_thread::get_id();
+        std::atomic<bool> stolen = false;
+        std::vector<std::thread::id> executors(8);
+
+        WHEN("the other thread runs out of its own tasks") {
+            pool.ParallelFor(executors.size(), [&](size_t index) {
+                executors[index] = std::this_thread::get_id();
+                if (index % 2 == 0 && std::this_thread::get_id() != caller) {
+                    stolen = true;
+                }
+                if (index == 6) {
+                    const auto deadline = std::chrono::steady_clock::now() + 5s;
+                    while (!stolen && std::chrono::steady_clock::now() < deadline) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            THEN("it steals tasks from the caller's queue") {
+                CHECK(stolen);
+                CHECK(executors[6] == caller);
+            }
+        }
+    }
+
+    GIVEN("a pool of one thread") {
+        util::WorkStealingPool pool{1};
+        THEN("all tasks run on the calling thread") {
+            CHECK(pool.GetThreadsCount() == 1);
+            const auto caller = std::this_thread::get_id();
+            size_t on_caller = 0;
+            pool.ParallelFor(50, [&](size_t) {
+                on_caller += std::this_thread::get_id() == caller;
+            });
+            CHECK(on_caller == 50);
+        }
+        THEN("zero threads means one") {
+            CHECK(util::WorkStealingPool{0}.GetThreadsCount() == 1);
+        }
+    }
+
+    GIVEN("pools that are created and destroyed") {
+        THEN("destruction joins idle and used workers") {
+            for (int i = 0; i < 20; ++i) {
+                util::WorkStealingPool idle{3};
+                util::WorkStealingPool used{3};
+                std::atomic<size_t> done = 0;
+                used.ParallelFor(10, [&done](size_t) {
+                    ++done;
+                });
+                CHECK(done == 10);
+            }
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/handler/tick_waiters.h"
+
+#include <boost/asio/io_context.hpp>
+
+#include <stdexcept>
+
+using namespace std::literals;
+
+namespace {
+
+// Рекорды в этих тестах не сохраняются
+class NullDatabase : public repository::Database, public repository::SaveScoresFactory {
+public:
+    repository::SaveScoresFactory& GetSaveScoresFactory() override {
+        return *this;
+    }
+    std::unique_ptr<service::SaveScores> CreateSaveScores() override {
+        throw std::logic_error{"No database in tests"};
+    }
+};
+
+}  // namespace
+
+SCENARIO("Waiting for a tick") {
+    GIVEN("waiters on a service") {
+        model::Game game;
+        NullDatabase db;
+        service::Service service{game, db};
+        http_handler::TickWaiters waiters{service};
+        boost::asio::io_context ioc;
+        int woken = 0;
+        auto on_woken = [&woken] {
+            ++woken;
+        };
+
+        WHEN("a tick happens") {
+            waiters.AsyncWait(ioc.get_executor(), 10s, on_woken);
+            waiters.AsyncWait(ioc.get_executor(), 10s, on_woken);
+            service.Tick(10ms);
+            ioc.run_for(1s);
+            THEN("all the waiters are woken at once") {
+                CHECK(woken == 2);
+                CHECK(waiters.WaitersCount() == 0);
+            }
+        }
+
+        WHEN("waits time out without ticks") {
+            constexpr int waits = 5 * http_handler::TickWaiters::MIN_PRUNE_SIZE;
+            for (int i = 0; i < waits; ++i) {
+                waiters.AsyncWait(ioc.get_executor(), 1ms, on_woken);
+                ioc.run_for(1s);
+                ioc.restart();
+            }
+            THEN("every handler is called and the expired timers are forgotten") {
+                CHECK(woken == waits);
+                CHECK(waiters.WaitersCount() <= http_handler::TickWaiters::MIN_PRUNE_SIZE);
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/util/token128.h"
+
+using namespace std::literals;
+
+namespace {
+struct TestTag {};
+using TestToken = util::TaggedToken128<TestTag>;
+}  // namespace
+
+SCENARIO("128-bit token") {
+    GIVEN("a string of 32 hex digits") {
+        constexpr auto hex = "0123456789abcdef00000000000000ff"sv;
+
+        WHEN("it is parsed") {
+            auto token = TestToken::FromString(hex);
+            REQUIRE(token);
+            THEN("the high digits go to the high half") {
+                CHECK((**token).hi == 0x0123456789abcdefull);
+                CHECK((**token).lo == 0xffull);
+            }
+            THEN("it converts back to the same string") {
+                CHECK(token->ToString() == hex);
+            }
+        }
+
+        WHEN("the digits are in upper case") {
+            THEN("the token is the same") {
+                CHECK(TestToken::FromString("0123456789ABCDEF00000000000000FF"sv) == TestToken::FromString(hex));
+            }
+        }
+    }
+
+    GIVEN("malformed strings") {
+        THEN("they are rejected") {
+            CHECK_FALSE(TestToken::FromString(""sv));
+            CHECK_FALSE(TestToken::FromString("0123456789abcdef00000000000000f"sv));
+            CHECK_FALSE(TestToken::FromString("0123456789abcdef00000000000000fff"sv));
+            CHECK_FALSE(TestToken::FromString("0123456789abcdeg00000000000000ff"sv));
+            CHECK_FALSE(TestToken::FromString("0123456789abcdef00000000000000f "sv));
+            CHECK_FALSE(TestToken::FromString("0123456789abcdef\x00" "00000000000000ff"sv));
+        }
+    }
+
+    GIVEN("a token with leading zeros") {
+        TestToken token{util::Uint128{0, 1}};
+        THEN("the string keeps all 32 digits") {
+            CHECK(token.ToString() == "00000000000000000000000000000001"sv);
+        }
+    }
+}